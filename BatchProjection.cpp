@@ -0,0 +1,534 @@
+/**
+ * Implementation file for the batch projections
+ **/
+
+#ifndef BATCHPROJECTION_CPP_
+#define BATCHPROJECTION_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "BatchProjection.h"
+#include "ProjUtil.h"
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#define BATCH_PI 3.14159265358979323846
+#define BATCH_HALFPI (BATCH_PI*0.5)
+#define BATCH_D2R (BATCH_PI/180.0)
+#define BATCH_R2D (180.0/BATCH_PI)
+#define BATCH_EPSLN 1.0e-10
+
+//*******************************************************************
+static double adjustLon(double x) throw()
+{
+  //same as GCTP's adjust_lon
+  int counter;
+
+  for (counter = 0; (counter < 4) && (std::fabs(x) > BATCH_PI); ++counter)
+    x -= (x < 0.0) ? -2.0*BATCH_PI : 2.0*BATCH_PI;
+  return x;
+}
+
+//*******************************************************************
+static double mlfn(double e0, double e1, double e2, double e3, double phi)
+  throw()
+{
+  return e0*phi - e1*std::sin(2.0*phi) + e2*std::sin(4.0*phi)
+    - e3*std::sin(6.0*phi);
+}
+
+//*******************************************************************
+static double msfnz(double e, double sinphi, double cosphi) throw()
+{
+  const double con = e*sinphi;
+
+  return cosphi/std::sqrt(1.0 - con*con);
+}
+
+//*******************************************************************
+static double qsfnz(double e, double sinphi) throw()
+{
+  double con;
+
+  if (e < 1.0e-7)
+    return 2.0*sinphi;
+
+  con = e*sinphi;
+  return (1.0 - e*e)*(sinphi/(1.0 - con*con)
+                      - (0.5/e)*std::log((1.0 - con)/(1.0 + con)));
+}
+
+//*******************************************************************
+static double tsfnz(double e, double phi, double sinphi) throw()
+{
+  const double con = e*sinphi;
+
+  return std::tan(0.5*(BATCH_HALFPI - phi))
+    /std::pow((1.0 - con)/(1.0 + con), 0.5*e);
+}
+
+//*******************************************************************
+static bool getSpheroid(ProjLib::DATUM datum, double & a, double & es)
+  throw()
+{
+  double b;
+
+  //only the datums that are just their spheroid
+  switch (datum)
+  {
+  case ProjLib::NAD27:                           //clarke 1866
+    a = 6378206.4;
+    b = 6356583.8;
+    break;
+  case ProjLib::NAD83:                           //grs 1980
+    a = 6378137.0;
+    b = 6356752.31414;
+    break;
+  case ProjLib::WGS_84:
+    a = 6378137.0;
+    b = 6356752.314245;
+    break;
+  case ProjLib::WGS_72:
+    a = 6378135.0;
+    b = 6356750.519915;
+    break;
+  default:
+    return false;
+  }
+
+  es = 1.0 - (b*b)/(a*a);
+  return true;
+}
+
+//*******************************************************************
+static bool getUnit(ProjLib::UNIT inunit, double & unit) throw()
+{
+  switch (inunit)
+  {
+  case ProjLib::METERS:
+    unit = 1.0;
+    return true;
+  case ProjLib::US_FEET:
+    unit = 1200.0/3937.0;
+    return true;
+  case ProjLib::INTERNATIONAL_FEET:
+    unit = 0.3048;
+    return true;
+  default:
+    return false;
+  }
+}
+
+//*******************************************************************
+BatchProjection * createBatchProjection(ProjLib::Projection * proj) throw()
+{
+  ProjectionParams params;
+  double a, es, unit;
+
+  try
+  {
+    if (!proj)
+      return NULL;
+
+    if (proj->getProjectionSystem() == ProjLib::GEO)
+    {
+      if (proj->getUnit() != ProjLib::ARC_DEGREES)
+        return NULL;
+      return new (std::nothrow) GeoBatch;
+    }
+
+    switch (proj->getProjectionSystem())
+    {
+    case ProjLib::UTM:
+    case ProjLib::TM:
+    case ProjLib::ALBERS:
+    case ProjLib::LAMCC:
+      break;
+    default:
+      return NULL;
+    }
+
+    if (!getSpheroid(proj->getDatum(), a, es) ||
+        !getUnit(proj->getUnit(), unit))
+      return NULL;
+
+    params = getParams(proj);
+    switch (params.projtype)
+    {
+    case ProjLib::UTM:                           //south zones are negative
+      if (!params.zone || (std::abs(params.zone) > 60))
+        return NULL;
+      return new (std::nothrow) TMBatch(a, es, 0.9996,
+                                        6.0*std::abs(params.zone) - 183.0,
+                                        0.0, 500000.0,
+                                        (params.zone < 0) ? 10000000.0 : 0.0,
+                                        unit);
+    case ProjLib::TM:
+      return new (std::nothrow) TMBatch(a, es, params.ScaleAtNatOrigin,
+                                        params.CenterLong,
+                                        params.NatOriginLat,
+                                        params.FalseEasting,
+                                        params.FalseNorthing, unit);
+    case ProjLib::ALBERS:
+      return new (std::nothrow) AlbersBatch(a, es, params.StdParallel1,
+                                            params.StdParallel2,
+                                            params.CenterLong,
+                                            params.NatOriginLat,
+                                            params.FalseEasting,
+                                            params.FalseNorthing, unit);
+    default:
+      return new (std::nothrow) LCCBatch(a, es, params.StdParallel1,
+                                         params.StdParallel2,
+                                         params.NatOriginLong,
+                                         params.FalseOriginLat,
+                                         params.FalseEasting,
+                                         params.FalseNorthing, unit);
+    }
+  }
+  catch(...)
+  {
+    return NULL;
+  }
+}
+
+
+//*******************************************************************
+BatchProjection::BatchProjection(double inunit) throw() : unit(inunit)
+{}
+
+//*******************************************************************
+BatchProjection::~BatchProjection()
+{}
+
+
+//*******************************************************************
+GeoBatch::GeoBatch() throw() : BatchProjection(1.0)
+{}
+
+//*******************************************************************
+GeoBatch::~GeoBatch()
+{}
+
+//*******************************************************************
+void GeoBatch::toGeo(double *, double *, long int) const throw()
+{}
+
+//*******************************************************************
+void GeoBatch::fromGeo(double *, double *, long int) const throw()
+{}
+
+
+//*******************************************************************
+TMBatch::TMBatch(double ina, double ines, double inscale,
+                 double incenterlon, double inoriginlat,
+                 double infalseeast, double infalsenorth, double inunit)
+  throw()
+  : BatchProjection(inunit), a(ina), es(ines), scale(inscale),
+    centerlon(incenterlon*BATCH_D2R), falseeast(infalseeast),
+    falsenorth(infalsenorth)
+{
+  esp = es/(1.0 - es);
+  e0 = 1.0 - 0.25*es*(1.0 + es/16.0*(3.0 + 1.25*es));
+  e1 = 0.375*es*(1.0 + 0.25*es*(1.0 + 0.46875*es));
+  e2 = 0.05859375*es*es*(1.0 + 0.75*es);
+  e3 = es*es*es*(35.0/3072.0);
+  ml0 = a*mlfn(e0, e1, e2, e3, inoriginlat*BATCH_D2R);
+}
+
+//*******************************************************************
+TMBatch::~TMBatch()
+{}
+
+//*******************************************************************
+void TMBatch::toGeo(double * x, double * y, long int count) const throw()
+{
+  double con, phi, deltaphi, sinphi, cosphi, tanphi;
+  double c, cs, t, ts, n, r, d, ds;
+  long int counter;
+  int iter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    con = (ml0 + (y[counter]*unit - falsenorth)/scale)/a;
+    phi = con;
+    for (iter = 0; iter < 6; ++iter)
+    {
+      deltaphi = ((con + e1*std::sin(2.0*phi) - e2*std::sin(4.0*phi)
+                   + e3*std::sin(6.0*phi))/e0) - phi;
+      phi += deltaphi;
+      if (std::fabs(deltaphi) <= BATCH_EPSLN)
+        break;
+    }
+    if (iter == 6)                        //didn't converge
+    {
+      x[counter] = y[counter] = std::numeric_limits<double>::quiet_NaN();
+      continue;
+    }
+
+    if (std::fabs(phi) >= BATCH_HALFPI)
+    {
+      y[counter] = (phi < 0.0) ? -90.0 : 90.0;
+      x[counter] = centerlon*BATCH_R2D;
+      continue;
+    }
+
+    sinphi = std::sin(phi);
+    cosphi = std::cos(phi);
+    tanphi = sinphi/cosphi;
+    c = esp*cosphi*cosphi;
+    cs = c*c;
+    t = tanphi*tanphi;
+    ts = t*t;
+    con = 1.0 - es*sinphi*sinphi;
+    n = a/std::sqrt(con);
+    r = n*(1.0 - es)/con;
+    d = (x[counter]*unit - falseeast)/(n*scale);
+    ds = d*d;
+
+    y[counter] = (phi - (n*tanphi*ds/r)
+                  *(0.5 - ds/24.0*(5.0 + 3.0*t + 10.0*c - 4.0*cs - 9.0*esp
+                                   - ds/30.0*(61.0 + 90.0*t + 298.0*c
+                                              + 45.0*ts - 252.0*esp
+                                              - 3.0*cs))))*BATCH_R2D;
+    x[counter] = adjustLon(centerlon
+                           + (d*(1.0 - ds/6.0
+                                 *(1.0 + 2.0*t + c
+                                   - ds/20.0*(5.0 - 2.0*c + 28.0*t - 3.0*cs
+                                              + 8.0*esp + 24.0*ts))))
+                           /cosphi)*BATCH_R2D;
+  }
+}
+
+//*******************************************************************
+void TMBatch::fromGeo(double * x, double * y, long int count) const
+  throw()
+{
+  double lat, deltalon, sinphi, cosphi, al, als, c, t, tq, n, ml;
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    lat = y[counter]*BATCH_D2R;
+    deltalon = adjustLon(x[counter]*BATCH_D2R - centerlon);
+    sinphi = std::sin(lat);
+    cosphi = std::cos(lat);
+
+    al = cosphi*deltalon;
+    als = al*al;
+    c = esp*cosphi*cosphi;
+    tq = std::tan(lat);
+    t = tq*tq;
+    n = a/std::sqrt(1.0 - es*sinphi*sinphi);
+    ml = a*mlfn(e0, e1, e2, e3, lat);
+
+    x[counter] = (scale*n*al*(1.0 + als/6.0*(1.0 - t + c + als/20.0
+                                             *(5.0 - 18.0*t + t*t + 72.0*c
+                                               - 58.0*esp)))
+                  + falseeast)/unit;
+    y[counter] = (scale*(ml - ml0 + n*tq*(als*(0.5 + als/24.0
+                                               *(5.0 - t + 9.0*c + 4.0*c*c
+                                                 + als/30.0
+                                                 *(61.0 - 58.0*t + t*t
+                                                   + 600.0*c
+                                                   - 330.0*esp)))))
+                  + falsenorth)/unit;
+  }
+}
+
+
+//*******************************************************************
+AlbersBatch::AlbersBatch(double ina, double ines, double inlat1,
+                         double inlat2, double incenterlon,
+                         double inoriginlat, double infalseeast,
+                         double infalsenorth, double inunit) throw()
+  : BatchProjection(inunit), a(ina), es(ines), e(std::sqrt(ines)),
+    centerlon(incenterlon*BATCH_D2R), falseeast(infalseeast),
+    falsenorth(infalsenorth)
+{
+  const double lat1 = inlat1*BATCH_D2R, lat2 = inlat2*BATCH_D2R;
+  const double ms1 = msfnz(e, std::sin(lat1), std::cos(lat1));
+  const double ms2 = msfnz(e, std::sin(lat2), std::cos(lat2));
+  const double qs0 = qsfnz(e, std::sin(inoriginlat*BATCH_D2R));
+  const double qs1 = qsfnz(e, std::sin(lat1));
+  const double qs2 = qsfnz(e, std::sin(lat2));
+
+  if (std::fabs(lat1 - lat2) > BATCH_EPSLN)
+    ns0 = (ms1*ms1 - ms2*ms2)/(qs2 - qs1);
+  else
+    ns0 = std::sin(lat1);
+  c = ms1*ms1 + ns0*qs1;
+  rh = a*std::sqrt(c - ns0*qs0)/ns0;
+}
+
+//*******************************************************************
+AlbersBatch::~AlbersBatch()
+{}
+
+//*******************************************************************
+void AlbersBatch::toGeo(double * x, double * y, long int count) const
+  throw()
+{
+  const double sign = (ns0 >= 0.0) ? 1.0 : -1.0;
+  const double edge = 1.0 - 0.5*(1.0 - es)*std::log((1.0 - e)/(1.0 + e))/e;
+  double px, py, rh1, theta, con, qs, phi, dphi, sinphi, cosphi;
+  long int counter;
+  int iter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    px = x[counter]*unit - falseeast;
+    py = rh - y[counter]*unit + falsenorth;
+    rh1 = sign*std::sqrt(px*px + py*py);
+    theta = (rh1 != 0.0) ? std::atan2(sign*px, sign*py) : 0.0;
+    con = rh1*ns0/a;
+    qs = (c - con*con)/ns0;
+
+    if (std::fabs(std::fabs(edge) - std::fabs(qs)) > 1.0e-10)
+    {
+      //phi1z
+      con = 0.5*qs;
+      phi = std::asin((con > 1.0) ? 1.0 : ((con < -1.0) ? -1.0 : con));
+      for (iter = 0; iter < 25; ++iter)
+      {
+        sinphi = std::sin(phi);
+        cosphi = std::cos(phi);
+        con = e*sinphi;
+        con = 1.0 - con*con;
+        dphi = 0.5*con*con/cosphi*(qs/(1.0 - es) - sinphi/con
+                                   + 0.5/e*std::log((1.0 - e*sinphi)
+                                                    /(1.0 + e*sinphi)));
+        phi += dphi;
+        if (std::fabs(dphi) <= 1.0e-7)
+          break;
+      }
+      if (iter == 25)
+        phi = std::numeric_limits<double>::quiet_NaN();
+    }
+    else
+      phi = (qs >= 0.0) ? BATCH_HALFPI : -BATCH_HALFPI;
+
+    y[counter] = phi*BATCH_R2D;
+    x[counter] = adjustLon(theta/ns0 + centerlon)*BATCH_R2D;
+  }
+}
+
+//*******************************************************************
+void AlbersBatch::fromGeo(double * x, double * y, long int count) const
+  throw()
+{
+  double rh1, theta;
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    rh1 = a*std::sqrt(c - ns0*qsfnz(e, std::sin(y[counter]*BATCH_D2R)))
+      /ns0;
+    theta = ns0*adjustLon(x[counter]*BATCH_D2R - centerlon);
+    x[counter] = (rh1*std::sin(theta) + falseeast)/unit;
+    y[counter] = (rh - rh1*std::cos(theta) + falsenorth)/unit;
+  }
+}
+
+
+//*******************************************************************
+LCCBatch::LCCBatch(double ina, double ines, double inlat1, double inlat2,
+                   double incenterlon, double inoriginlat,
+                   double infalseeast, double infalsenorth, double inunit)
+  throw()
+  : BatchProjection(inunit), a(ina), e(std::sqrt(ines)),
+    centerlon(incenterlon*BATCH_D2R), falseeast(infalseeast),
+    falsenorth(infalsenorth)
+{
+  const double lat0 = inoriginlat*BATCH_D2R;
+  const double lat1 = inlat1*BATCH_D2R, lat2 = inlat2*BATCH_D2R;
+  const double ms1 = msfnz(e, std::sin(lat1), std::cos(lat1));
+  const double ms2 = msfnz(e, std::sin(lat2), std::cos(lat2));
+  const double ts0 = tsfnz(e, lat0, std::sin(lat0));
+  const double ts1 = tsfnz(e, lat1, std::sin(lat1));
+  const double ts2 = tsfnz(e, lat2, std::sin(lat2));
+
+  if (std::fabs(lat1 - lat2) > BATCH_EPSLN)
+    ns = std::log(ms1/ms2)/std::log(ts1/ts2);
+  else
+    ns = std::sin(lat1);
+  f0 = ms1/(ns*std::pow(ts1, ns));
+  rh = a*f0*std::pow(ts0, ns);
+}
+
+//*******************************************************************
+LCCBatch::~LCCBatch()
+{}
+
+//*******************************************************************
+void LCCBatch::toGeo(double * x, double * y, long int count) const
+  throw()
+{
+  const double sign = (ns > 0.0) ? 1.0 : -1.0;
+  double px, py, rh1, theta, ts, phi, dphi, con;
+  long int counter;
+  int iter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    px = x[counter]*unit - falseeast;
+    py = rh - y[counter]*unit + falsenorth;
+    rh1 = sign*std::sqrt(px*px + py*py);
+    theta = (rh1 != 0.0) ? std::atan2(sign*px, sign*py) : 0.0;
+
+    if ((rh1 != 0.0) || (ns > 0.0))
+    {
+      //phi2z
+      ts = std::pow(rh1/(a*f0), 1.0/ns);
+      phi = BATCH_HALFPI - 2.0*std::atan(ts);
+      for (iter = 0; iter < 15; ++iter)
+      {
+        con = e*std::sin(phi);
+        dphi = BATCH_HALFPI - 2.0*std::atan(ts*std::pow((1.0 - con)
+                                                        /(1.0 + con),
+                                                        0.5*e)) - phi;
+        phi += dphi;
+        if (std::fabs(dphi) <= BATCH_EPSLN)
+          break;
+      }
+      if (iter == 15)
+        phi = std::numeric_limits<double>::quiet_NaN();
+    }
+    else
+      phi = -BATCH_HALFPI;
+
+    y[counter] = phi*BATCH_R2D;
+    x[counter] = adjustLon(theta/ns + centerlon)*BATCH_R2D;
+  }
+}
+
+//*******************************************************************
+void LCCBatch::fromGeo(double * x, double * y, long int count) const
+  throw()
+{
+  double lat, rh1, theta;
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    lat = y[counter]*BATCH_D2R;
+    if (std::fabs(std::fabs(lat) - BATCH_HALFPI) > BATCH_EPSLN)
+      rh1 = a*f0*std::pow(tsfnz(e, lat, std::sin(lat)), ns);
+    else if (lat*ns > 0.0)
+      rh1 = 0.0;
+    else                                  //the far pole is at infinity
+    {
+      x[counter] = y[counter] = std::numeric_limits<double>::quiet_NaN();
+      continue;
+    }
+
+    theta = ns*adjustLon(x[counter]*BATCH_D2R - centerlon);
+    x[counter] = (rh1*std::sin(theta) + falseeast)/unit;
+    y[counter] = (rh - rh1*std::cos(theta) + falsenorth)/unit;
+  }
+}
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * BatchProjection projects whole arrays of points between a projection
+ * and geographic coordinates without going through the projection
+ * library a point at a time.  They are written for the systems most of
+ * our jobs use (geographic, UTM, transverse mercator, albers and lambert
+ * conformal conic) on the datums that are just a spheroid, with the
+ * same formulas as GCTP.  createBatchProjection gives NULL for anything
+ * else so the caller can fall back to the projection library.
+ *
+ * Geographic coordinates are decimal degrees with the longitude in the
+ * x array and the latitude in the y array.  Points that don't project
+ * come out as NaN.  A batch projection holds no state while projecting
+ * so threads can share one.
+ **/
+
+#ifndef BATCHPROJECTION_H_
+#define BATCHPROJECTION_H_
+
+#include "ProjectionLib/Projection.h"
+
+
+//Base class for the batch projections
+class BatchProjection
+{
+ public:
+  /**
+   * Constructor takes the meters in one unit of the projection
+   **/
+  BatchProjection(double inunit) throw();
+  virtual ~BatchProjection();
+
+  /**
+   * toGeo turns count projected points into longitudes and latitudes
+   * in place and fromGeo does the reverse.
+   **/
+  virtual void toGeo(double * x, double * y, long int count) const
+    throw() = 0;
+  virtual void fromGeo(double * x, double * y, long int count) const
+    throw() = 0;
+
+ protected:
+  double unit;                           //meters per unit
+};
+
+
+//createBatchProjection returns a batch projection for proj or NULL if
+//there isn't one
+BatchProjection * createBatchProjection(ProjLib::Projection * proj) throw();
+
+
+//GeoBatch is geographic in degrees, which is already geographic
+class GeoBatch : public BatchProjection
+{
+ public:
+  GeoBatch() throw();
+  virtual ~GeoBatch();
+
+  virtual void toGeo(double * x, double * y, long int count) const throw();
+  virtual void fromGeo(double * x, double * y, long int count) const
+    throw();
+};
+
+
+//TMBatch is transverse mercator (and UTM)
+class TMBatch : public BatchProjection
+{
+ public:
+  /**
+   * a and es are the spheroid, the angles are in degrees and the false
+   * easting and northing in meters
+   **/
+  TMBatch(double ina, double ines, double inscale, double incenterlon,
+          double inoriginlat, double infalseeast, double infalsenorth,
+          double inunit) throw();
+  virtual ~TMBatch();
+
+  virtual void toGeo(double * x, double * y, long int count) const throw();
+  virtual void fromGeo(double * x, double * y, long int count) const
+    throw();
+
+ protected:
+  double a, es, esp;                     //spheroid
+  double e0, e1, e2, e3;                 //meridian distance terms
+  double scale;                          //scale on the central meridian
+  double centerlon;                      //central meridian (radians)
+  double ml0;                            //meridian distance of the origin
+  double falseeast, falsenorth;          //in meters
+};
+
+
+//AlbersBatch is albers conic equal area
+class AlbersBatch : public BatchProjection
+{
+ public:
+  AlbersBatch(double ina, double ines, double inlat1, double inlat2,
+              double incenterlon, double inoriginlat, double infalseeast,
+              double infalsenorth, double inunit) throw();
+  virtual ~AlbersBatch();
+
+  virtual void toGeo(double * x, double * y, long int count) const throw();
+  virtual void fromGeo(double * x, double * y, long int count) const
+    throw();
+
+ protected:
+  double a, es, e;                       //spheroid
+  double ns0, c, rh;                     //cone constants
+  double centerlon;                      //central meridian (radians)
+  double falseeast, falsenorth;          //in meters
+};
+
+
+//LCCBatch is lambert conformal conic
+class LCCBatch : public BatchProjection
+{
+ public:
+  LCCBatch(double ina, double ines, double inlat1, double inlat2,
+           double incenterlon, double inoriginlat, double infalseeast,
+           double infalsenorth, double inunit) throw();
+  virtual ~LCCBatch();
+
+  virtual void toGeo(double * x, double * y, long int count) const throw();
+  virtual void fromGeo(double * x, double * y, long int count) const
+    throw();
+
+ protected:
+  double a, e;                           //spheroid
+  double ns, f0, rh;                     //cone constants
+  double centerlon;                      //central meridian (radians)
+  double falseeast, falsenorth;          //in meters
+};
+
+#endif
@@ -0,0 +1,292 @@
+/**
+ * Implementation file for ChunkProjector
+ **/
+
+#ifndef CHUNKPROJECTOR_CPP_
+#define CHUNKPROJECTOR_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include <cstring>
+#include "ChunkProjector.h"
+
+//****************************************************************
+ChunkProjector::ChunkProjector(RowTransform * intransform,
+                               Footprint * infootprint,
+                               InputRows * inrows,
+                               ResampleFunc inresample,
+                               long int innewwidth, long int inoldwidth,
+                               long int inoldheight, int inspp,
+                               long int inpixelbytes, long int inmaxlines,
+                               long int intilesize,
+                               IndexResampleFunc inindexresample)
+  throw(std::bad_alloc)
+  : transform(intransform), footprint(infootprint), rows(inrows),
+    resample(inresample), indexresample(inindexresample),
+    newwidth(innewwidth), oldwidth(inoldwidth),
+    oldheight(inoldheight), spp(inspp), pixelbytes(inpixelbytes),
+    maxlines(inmaxlines), tilesize(intilesize), xarr(NULL), yarr(NULL),
+    xidx(NULL), yidx(NULL), spanstart(NULL), spancount(NULL),
+    spanfixed(NULL)
+{
+  try
+  {
+    //the coordinates for a whole chunk are kept so the input rows
+    //can be pinned before any of it is resampled
+    if (!(xarr = new (std::nothrow) double[maxlines*newwidth]))
+      throw std::bad_alloc();
+    if (!(yarr = new (std::nothrow) double[maxlines*newwidth]))
+      throw std::bad_alloc();
+    if (!(spanstart = new (std::nothrow) long int[maxlines]))
+      throw std::bad_alloc();
+    if (!(spancount = new (std::nothrow) long int[maxlines]))
+      throw std::bad_alloc();
+    if (!(spanfixed = new (std::nothrow) bool[maxlines]))
+      throw std::bad_alloc();
+
+    if (indexresample)
+    {
+      if (!(xidx = new (std::nothrow) long int[maxlines*newwidth]))
+        throw std::bad_alloc();
+      if (!(yidx = new (std::nothrow) long int[maxlines*newwidth]))
+        throw std::bad_alloc();
+    }
+  }
+  catch(...)
+  {
+    delete [] xarr;
+    delete [] yarr;
+    delete [] xidx;
+    delete [] yidx;
+    delete [] spanstart;
+    delete [] spancount;
+    delete [] spanfixed;
+    throw std::bad_alloc();
+  }
+}
+
+//****************************************************************
+ChunkProjector::~ChunkProjector()
+{
+  delete [] xarr;
+  delete [] yarr;
+  delete [] xidx;
+  delete [] yidx;
+  delete [] spanstart;
+  delete [] spancount;
+  delete [] spanfixed;
+  delete transform;
+  delete rows;
+}
+
+//****************************************************************
+void ChunkProjector::project(long int starty, long int endy,
+                             unsigned char * buffer) throw()
+{
+  long int ycounter, line;                 //output line and chunk line
+  long int first(oldheight), last(-1);     //input rows the chunk needs
+  long int lines(endy - starty + 1);       //lines in the chunk
+  long int band, bandend, tilex;           //the tile being done
+  long int x0, x1;                         //part of a line in the tile
+  long int inx, iny;                       //input pixel of a copied line
+
+  //project the whole chunk first to find the input rows
+  for (ycounter = starty; ycounter <= endy; ++ycounter)
+  {
+    line = ycounter - starty;
+    spanfixed[line] = false;
+
+    //only the part of the line over the input needs projecting
+    footprint->clipRow(ycounter, &(buffer[newwidth*pixelbytes*line]),
+                       spanstart[line], spancount[line]);
+    if (!spancount[line])
+      continue;
+
+    //lines that land one to one on the input don't need the kernel
+    if (transform->copyRow(ycounter, spanstart[line], spancount[line],
+                           inx, iny))
+    {
+      copyLine(inx, iny, spancount[line],
+               &(buffer[newwidth*pixelbytes*line
+                        + spanstart[line]*pixelbytes]));
+      spancount[line] = 0;
+      continue;
+    }
+
+    //fixed point lines come out as whole input pixels
+    if (indexresample &&
+        transform->projectRowIndices(ycounter, spanstart[line],
+                                     spancount[line],
+                                     &(xidx[newwidth*line]),
+                                     &(yidx[newwidth*line])))
+    {
+      spanfixed[line] = true;
+      rows->getRowRange(&(yidx[newwidth*line]), spancount[line],
+                        first, last);
+      continue;
+    }
+
+    //get the reverse projected values for the line
+    transform->projectRow(ycounter, spanstart[line], spancount[line],
+                          &(xarr[newwidth*line]), &(yarr[newwidth*line]));
+    rows->getRowRange(&(yarr[newwidth*line]), spancount[line],
+                      first, last);
+  }
+
+  //pin the rows so the kernel doesn't hit the cache for every pixel
+  rows->pinRows(first, last);
+
+  if (tilesize <= 0)
+  {
+    for (line = 0; line < lines; ++line)
+    {
+      if (spancount[line])                 //reproject the line
+        resampleSpan(line, 0, spancount[line],
+                     &(buffer[newwidth*pixelbytes*line
+                              + spanstart[line]*pixelbytes]));
+    }
+    return;
+  }
+
+  //go through the chunk a tile at a time so the input rows a tile
+  //touches are only walked once
+  for (band = 0; band < lines; band += tilesize)
+  {
+    bandend = band + tilesize;
+    if (bandend > lines)
+      bandend = lines;
+
+    for (tilex = 0; tilex < newwidth; tilex += tilesize)
+    {
+      for (line = band; line < bandend; ++line)
+      {
+        //the part of the span inside the tile
+        x0 = (spanstart[line] > tilex) ? spanstart[line] : tilex;
+        x1 = spanstart[line] + spancount[line];
+        if (x1 > tilex + tilesize)
+          x1 = tilex + tilesize;
+        if (x0 >= x1)
+          continue;
+
+        resampleSpan(line, x0 - spanstart[line], x1 - x0,
+                     &(buffer[(newwidth*line + x0)*pixelbytes]));
+      }
+    }
+  }
+}
+
+//****************************************************************
+void ChunkProjector::getInputRows(long int starty, long int endy,
+                                  long int & first, long int & last)
+  throw()
+{
+  estimateInputRows(transform, footprint, oldheight, starty, endy,
+                    first, last);
+}
+
+//****************************************************************
+void ChunkProjector::estimateInputRows(RowTransform * intransform,
+                                       const Footprint * infootprint,
+                                       long int inoldheight,
+                                       long int starty, long int endy,
+                                       long int & first, long int & last)
+  throw()
+{
+  long int ycounter, startx, count, x, step; //the outline points
+  double inx, iny;                         //an outline point on the input
+  double ylow(0.0), yhigh(-1.0);           //input rows seen
+
+  //project across the first and last lines and the ends of every span
+  for (ycounter = starty; ycounter <= endy; ++ycounter)
+  {
+    infootprint->getSpan(ycounter, startx, count);
+    if (!count)
+      continue;
+
+    step = ((ycounter == starty) || (ycounter == endy)) ? FOOTPRINT_STEP
+      : count - 1;
+    if (step < 1)
+      step = 1;
+
+    for (x = 0; x < count; x += step)
+    {
+      if (x + step >= count)
+        x = count - 1;                     //always get the end
+
+      intransform->projectRow(ycounter, startx + x, 1, &inx, &iny);
+      if (iny != iny)
+        continue;                          //couldn't be projected or is
+                                           //off the input
+
+      if (yhigh < ylow)
+        ylow = yhigh = iny;
+      else if (iny < ylow)
+        ylow = iny;
+      else if (iny > yhigh)
+        yhigh = iny;
+    }
+  }
+
+  first = 0;
+  last = -1;
+  if ((yhigh < ylow) || (yhigh + 0.5 < -1.0) || (ylow + 0.5 >= inoldheight))
+    return;
+
+  //round like the kernels do and leave them room
+  first = ((ylow + 0.5 < 0.0) ? 0 : static_cast<long int>(ylow + 0.5))
+    - CHUNK_ROWMARGIN;
+  last = ((yhigh + 0.5 >= inoldheight) ? inoldheight - 1
+          : static_cast<long int>(yhigh + 0.5)) + CHUNK_ROWMARGIN;
+  if (first < 0)
+    first = 0;
+  if (last >= inoldheight)
+    last = inoldheight - 1;
+}
+
+//****************************************************************
+void ChunkProjector::resampleSpan(long int line, long int offset,
+                                  long int count, unsigned char * out)
+  throw()
+{
+  if (spanfixed[line])
+    indexresample(&(xidx[newwidth*line + offset]),
+                  &(yidx[newwidth*line + offset]),
+                  count, oldwidth, oldheight, spp, *rows, out);
+  else
+    resample(&(xarr[newwidth*line + offset]),
+             &(yarr[newwidth*line + offset]),
+             count, oldwidth, oldheight, spp, *rows, out);
+}
+
+//****************************************************************
+void ChunkProjector::copyLine(long int inx, long int iny, long int count,
+                              unsigned char * out) throw()
+{
+  const unsigned char * in;                //the input row
+  long int first, last;                    //part of the run on the input
+
+  //the same bounds as the kernels, which round -1 up to 0
+  first = (inx < -1) ? -1 - inx : 0;
+  last = (oldwidth - inx < count) ? oldwidth - inx : count;
+  if ((iny < -1) || (iny >= oldheight) || (first >= last))
+  {
+    std::memset(out, 0, count*pixelbytes);
+    return;
+  }
+
+  in = rows->getRow((iny < 0) ? 0 : iny);
+  std::memset(out, 0, first*pixelbytes);
+  if (inx + first == -1)
+  {
+    std::memcpy(&(out[first*pixelbytes]), in, pixelbytes);
+    ++first;
+  }
+  std::memcpy(&(out[first*pixelbytes]), &(in[(inx + first)*pixelbytes]),
+              (last - first)*pixelbytes);
+  std::memset(&(out[last*pixelbytes]), 0, (count - last)*pixelbytes);
+}
+
+#endif
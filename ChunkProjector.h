@@ -0,0 +1,101 @@
+/**
+ * ChunkProjector reprojects a run of output lines (a chunk) into a
+ * buffer.  It projects the whole chunk first, pins the input rows the
+ * chunk lands on and then resamples it.  The resampling can be done
+ * in square tiles of output pixels so that a rotated chunk stays on a
+ * few input rows at a time; the lines in the buffer come out the same.
+ * The slaves and each thread of the ParallelProjector own one.
+ **/
+
+#ifndef CHUNKPROJECTOR_H_
+#define CHUNKPROJECTOR_H_
+
+#include <new>
+#include "RowTransform.h"
+#include "Footprint.h"
+#include "InputRows.h"
+#include "ResampleKernel.h"
+
+//How many input rows past the chunk outline the kernels can touch
+#define CHUNK_ROWMARGIN 2
+
+
+class ChunkProjector
+{
+ public:
+  /**
+   * Main constructor.  Once constructed the transform and input rows
+   * are owned by the chunk projector, the footprint is not (so it can
+   * be shared).
+   * maxlines is the most lines a chunk will have and pixelbytes is the
+   * size of an output pixel.  tilesize is the width and height of the
+   * resampling tiles (0 resamples a line at a time).
+   * If inindexresample is not NULL lines the transform can give as
+   * whole input pixels (fixed point stepping) are resampled with it.
+   **/
+  ChunkProjector(RowTransform * intransform, Footprint * infootprint,
+                 InputRows * inrows, ResampleFunc inresample,
+                 long int innewwidth, long int inoldwidth,
+                 long int inoldheight, int inspp, long int inpixelbytes,
+                 long int inmaxlines, long int intilesize = 0,
+                 IndexResampleFunc inindexresample = NULL)
+    throw(std::bad_alloc);
+
+  /**
+   * Destructor
+   **/
+  ~ChunkProjector();
+
+  /**
+   * project reprojects output lines starty to endy into buffer, which
+   * holds them one after the other.
+   **/
+  void project(long int starty, long int endy,
+               unsigned char * buffer) throw();
+
+  /**
+   * getInputRows estimates the input rows output lines starty to endy
+   * will need from the outline of the chunk alone, so they can be read
+   * ahead.  last is less than first if the chunk misses the input.
+   **/
+  void getInputRows(long int starty, long int endy,
+                    long int & first, long int & last) throw();
+
+  /**
+   * estimateInputRows is getInputRows for any transform and footprint
+   * over an input inoldheight rows high.
+   **/
+  static void estimateInputRows(RowTransform * intransform,
+                                const Footprint * infootprint,
+                                long int inoldheight,
+                                long int starty, long int endy,
+                                long int & first, long int & last) throw();
+
+ protected:
+  //copyLine copies count input pixels starting at inx on input row iny
+  //into out.  Used for lines the transform says are straight copies.
+  void copyLine(long int inx, long int iny, long int count,
+                unsigned char * out) throw();
+
+  //resampleSpan resamples count pixels of a line starting offset pixels
+  //into its span with whichever kernel the line was projected for
+  void resampleSpan(long int line, long int offset, long int count,
+                    unsigned char * out) throw();
+
+  RowTransform * transform;           //row transform
+  Footprint * footprint;              //input outline
+  InputRows * rows;                   //input scanlines
+  ResampleFunc resample;              //the resampling kernel
+  IndexResampleFunc indexresample;    //the fixed point kernel (or NULL)
+  long int newwidth, oldwidth, oldheight;
+  int spp;
+  long int pixelbytes;                //bytes per output pixel
+  long int maxlines;                  //most lines in a chunk
+  long int tilesize;                  //tile width and height (0 is none)
+  double * xarr, * yarr;              //input coords for a chunk
+  long int * xidx, * yidx;            //input pixels for a chunk
+  long int * spanstart, * spancount;  //projected span of each line
+  bool * spanfixed;                   //line is in xidx and yidx
+};
+
+#endif
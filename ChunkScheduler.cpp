@@ -0,0 +1,202 @@
+/**
+ * Implementation file for ChunkScheduler
+ **/
+
+#ifndef CHUNKSCHEDULER_CPP_
+#define CHUNKSCHEDULER_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "ChunkScheduler.h"
+
+//****************************************************************
+ChunkScheduler::ChunkScheduler(int inslaves, long int incapacity)
+  throw(std::bad_alloc)
+  : capacity(incapacity), remaining(0), maxrows(0)
+{
+  if (capacity < 1)
+    capacity = 1;
+
+  try
+  {
+    //indexed by rank so rank 0 (the master) is left unused
+    slavefirst.assign(inslaves + 1, 0);
+    slavelast.assign(inslaves + 1, -1);
+    slavechunk.assign(inslaves + 1, -1);
+  }
+  catch(...)
+  {
+    throw std::bad_alloc();
+  }
+}
+
+//****************************************************************
+void ChunkScheduler::addChunk(long int begin, long int end, long int first,
+                              long int last) throw(std::bad_alloc)
+{
+  try
+  {
+    begins.push_back(begin);
+    ends.push_back(end);
+    firsts.push_back(first);
+    lasts.push_back(last);
+    taken.push_back(false);
+
+    //chunks that don't need any rows can't overlap anything
+    if (last >= first)
+    {
+      entries.push_back(open.insert(RowIndex::value_type
+                                    (first, begins.size() - 1)));
+      if (last - first + 1 > maxrows)
+        maxrows = last - first + 1;
+    }
+    else
+      entries.push_back(open.end());
+    ++remaining;
+  }
+  catch(...)
+  {
+    throw std::bad_alloc();
+  }
+}
+
+//****************************************************************
+bool ChunkScheduler::next(int slave, long int & begin, long int & end)
+  throw()
+{
+  const long int chunks = begins.size();
+  long int chunk, best(-1), bestoverlap(0), overlap;
+  long int distance, bestdistance(0);
+  RowIndex::const_iterator entry, stop;
+
+  if (!remaining || (slave < 1) ||
+      (slave >= static_cast<int>(slavechunk.size())))
+    return false;
+
+  //the chunk that needs the most of the rows the slave has, the one
+  //closest to its last chunk if there's a tie.  Only chunks starting
+  //within a chunk's rows of the slave's can overlap them.
+  if (slavelast[slave] >= slavefirst[slave])
+  {
+    entry = open.lower_bound(slavefirst[slave] - maxrows + 1);
+    stop = open.upper_bound(slavelast[slave]);
+    for (; entry != stop; ++entry)
+    {
+      chunk = entry->second;
+      if (!(overlap = getOverlap(chunk, slavefirst[slave],
+                                 slavelast[slave])))
+        continue;
+
+      distance = chunk - slavechunk[slave];
+      if (distance < 0)
+        distance = -distance;
+
+      if ((overlap > bestoverlap) ||
+          ((overlap == bestoverlap) && ((distance < bestdistance) ||
+                                        ((distance == bestdistance) &&
+                                         (chunk < best)))))
+      {
+        best = chunk;
+        bestoverlap = overlap;
+        bestdistance = distance;
+      }
+    }
+  }
+
+  //else keep going down, else start somewhere nobody is
+  if (best < 0)
+  {
+    chunk = slavechunk[slave] + 1;
+    if ((slavechunk[slave] >= 0) && (chunk < chunks) && !taken[chunk])
+      best = chunk;
+    else
+      best = getSplit();
+  }
+
+  take(slave, best);
+  begin = begins[best];
+  end = ends[best];
+  return true;
+}
+
+//****************************************************************
+long int ChunkScheduler::getRemaining() const throw()
+{
+  return remaining;
+}
+
+//****************************************************************
+long int ChunkScheduler::getOverlap(long int chunk, long int first,
+                                    long int last) const throw()
+{
+  const long int low = (firsts[chunk] > first) ? firsts[chunk] : first;
+  const long int high = (lasts[chunk] < last) ? lasts[chunk] : last;
+
+  return (high >= low) ? high - low + 1 : 0;
+}
+
+//****************************************************************
+long int ChunkScheduler::getSplit() const throw()
+{
+  const long int chunks = begins.size();
+  long int chunk, start(0), beststart(0), bestlength(0);
+
+  //nothing taken yet so start at the top
+  if (remaining == chunks)
+    return 0;
+
+  for (chunk = 0; chunk <= chunks; ++chunk)
+  {
+    if ((chunk < chunks) && !taken[chunk])
+      continue;
+
+    if (chunk - start > bestlength)
+    {
+      beststart = start;
+      bestlength = chunk - start;
+    }
+    start = chunk + 1;
+  }
+
+  return beststart + bestlength/2;
+}
+
+//****************************************************************
+void ChunkScheduler::take(int slave, long int chunk) throw()
+{
+  long int first(firsts[chunk]), last(lasts[chunk]);
+
+  taken[chunk] = true;
+  if (entries[chunk] != open.end())
+    open.erase(entries[chunk]);
+  --remaining;
+  slavechunk[slave] = chunk;
+
+  if (last < first)
+    return;                               //it didn't read anything
+
+  //add on what the slave had as long as it all fits, keeping the rows
+  //next to the new ones
+  if (slavelast[slave] >= slavefirst[slave])
+  {
+    if (slavefirst[slave] < first)
+      first = slavefirst[slave];
+    if (slavelast[slave] > last)
+      last = slavelast[slave];
+  }
+  if (last - first + 1 > capacity)
+  {
+    if (lasts[chunk] >= slavelast[slave])
+      first = last - capacity + 1;        //it moved down
+    else
+      last = first + capacity - 1;        //it moved up
+  }
+
+  slavefirst[slave] = first;
+  slavelast[slave] = last;
+}
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * ChunkScheduler picks which chunk of output lines the master hands a
+ * slave next so that the slaves reread as few input rows as possible.
+ * Each chunk carries the input rows it needs and each slave the rows it
+ * has read lately (as much as its cache holds).  A slave is given the
+ * chunk that overlaps its rows the most, else the chunk after its last
+ * one.  A slave with nothing to go on gets the middle of the longest
+ * run of chunks nobody has taken, so the slaves end up working through
+ * separate parts of the input.
+ **/
+
+#ifndef CHUNKSCHEDULER_H_
+#define CHUNKSCHEDULER_H_
+
+#include <new>
+#include <vector>
+#include <map>
+
+
+class ChunkScheduler
+{
+ public:
+  /**
+   * Main constructor.  inslaves is the number of slaves (ranks 1 to
+   * inslaves) and incapacity the most input rows a slave keeps.
+   **/
+  ChunkScheduler(int inslaves, long int incapacity) throw(std::bad_alloc);
+
+  /**
+   * addChunk adds output lines begin to end, which need input rows
+   * first to last (last less than first if they don't need any).
+   * Chunks have to be added top to bottom.
+   **/
+  void addChunk(long int begin, long int end, long int first,
+                long int last) throw(std::bad_alloc);
+
+  /**
+   * next picks the next chunk for slave and marks it taken.  Returns
+   * false if there are none left.
+   **/
+  bool next(int slave, long int & begin, long int & end) throw();
+
+  /**
+   * getRemaining returns the number of chunks not taken yet.
+   **/
+  long int getRemaining() const throw();
+
+ protected:
+  //getOverlap returns the number of rows chunk shares with first to last
+  long int getOverlap(long int chunk, long int first, long int last)
+    const throw();
+
+  //getSplit returns the middle of the longest run of chunks not taken
+  long int getSplit() const throw();
+
+  //take marks chunk taken by slave and updates the rows it has
+  void take(int slave, long int chunk) throw();
+
+  typedef std::multimap<long int, long int> RowIndex;
+
+  long int capacity;                      //most rows a slave keeps
+  long int remaining;                     //chunks not taken
+  std::vector<long int> begins, ends;     //output lines of each chunk
+  std::vector<long int> firsts, lasts;    //input rows of each chunk
+  std::vector<bool> taken;                //chunk has been handed out
+  RowIndex open;                          //chunks not taken by first row
+  std::vector<RowIndex::iterator> entries; //each chunk in open
+  long int maxrows;                       //most rows a chunk needs
+  std::vector<long int> slavefirst, slavelast; //rows each slave has
+  std::vector<long int> slavechunk;       //last chunk of each slave or -1
+};
+
+#endif
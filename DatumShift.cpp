@@ -0,0 +1,265 @@
+/**
+ * Implementation file for DatumShift and DatumShiftGrid
+ **/
+
+#ifndef DATUMSHIFT_CPP_
+#define DATUMSHIFT_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "DatumShift.h"
+#include <cmath>
+#include <limits>
+
+#define DATUMSHIFT_D2R (3.14159265358979323846/180.0)
+
+//****************************************************************
+static bool getDatum(ProjLib::DATUM datum, double & a, double & f,
+                     double & dx, double & dy, double & dz) throw()
+{
+  //the spheroid and the shift of its center to WGS 84
+  switch (datum)
+  {
+  case ProjLib::NAD27:                   //clarke 1866, CONUS mean
+    a = 6378206.4;
+    f = 1.0/294.9786982;
+    dx = -8.0;
+    dy = 160.0;
+    dz = 176.0;
+    return true;
+  case ProjLib::NAD83:                   //grs 1980
+    a = 6378137.0;
+    f = 1.0/298.257222101;
+    dx = dy = dz = 0.0;
+    return true;
+  case ProjLib::WGS_84:
+    a = 6378137.0;
+    f = 1.0/298.257223563;
+    dx = dy = dz = 0.0;
+    return true;
+  case ProjLib::WGS_72:
+    a = 6378135.0;
+    f = 1.0/298.26;
+    dx = dy = 0.0;
+    dz = 4.5;
+    return true;
+  default:
+    return false;
+  }
+}
+
+//****************************************************************
+DatumShift::DatumShift() throw() : shifting(false), a(1.0), f(0.0),
+                                   b(1.0), es(0.0), da(0.0), df(0.0),
+                                   dx(0.0), dy(0.0), dz(0.0)
+{}
+
+//****************************************************************
+DatumShift::DatumShift(ProjLib::DATUM infrom, ProjLib::DATUM into) throw()
+  : shifting(false), a(1.0), f(0.0), b(1.0), es(0.0), da(0.0), df(0.0),
+    dx(0.0), dy(0.0), dz(0.0)
+{
+  double toa, tof, todx, tody, todz;
+
+  if ((infrom == into) || !getDatum(infrom, a, f, dx, dy, dz) ||
+      !getDatum(into, toa, tof, todx, tody, todz))
+    return;
+
+  b = a*(1.0 - f);
+  es = f*(2.0 - f);
+  da = toa - a;
+  df = tof - f;
+  dx -= todx;
+  dy -= tody;
+  dz -= todz;
+  shifting = true;
+}
+
+//****************************************************************
+bool DatumShift::good() const throw()
+{
+  return shifting;
+}
+
+//****************************************************************
+void DatumShift::delta(double lon, double lat, double & dlon,
+                       double & dlat) const throw()
+{
+  const double phi = lat*DATUMSHIFT_D2R, lam = lon*DATUMSHIFT_D2R;
+  const double sinphi = std::sin(phi), cosphi = std::cos(phi);
+  const double sinlam = std::sin(lam), coslam = std::cos(lam);
+  const double w = 1.0 - es*sinphi*sinphi;
+  const double rn = a/std::sqrt(w);                 //prime vertical
+  const double rm = a*(1.0 - es)/(w*std::sqrt(w));  //meridian
+
+  dlat = (-dx*sinphi*coslam - dy*sinphi*sinlam + dz*cosphi
+          + da*rn*es*sinphi*cosphi/a
+          + df*(rm*a/b + rn*b/a)*sinphi*cosphi)/rm/DATUMSHIFT_D2R;
+
+  //every longitude is the same at the poles
+  if (std::fabs(cosphi) < 1e-12)
+    dlon = 0.0;
+  else
+    dlon = (-dx*sinlam + dy*coslam)/(rn*cosphi)/DATUMSHIFT_D2R;
+}
+
+//****************************************************************
+void DatumShift::shift(double & lon, double & lat) const throw()
+{
+  double dlon, dlat;
+
+  if (!shifting)
+    return;
+
+  delta(lon, lat, dlon, dlat);
+  lon += dlon;
+  lat += dlat;
+}
+
+
+//****************************************************************
+DatumShiftGrid::DatumShiftGrid() : cellsx(0), cellsy(0), exactcount(0),
+                                   maxerror(0.0)
+{}
+
+//****************************************************************
+DatumShiftGrid::~DatumShiftGrid()
+{}
+
+//****************************************************************
+void DatumShiftGrid::calculate(ProjLib::Projection * to,
+                               const DatumShift & inshift,
+                               const DRect & outRect,
+                               const MathLib::Point & newscale,
+                               long int innewwidth, long int innewheight)
+  throw(std::bad_alloc)
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  long int xcounter, ycounter, node;
+  double x, y, lat, lon, tlon, tlat, error;
+
+  shift = inshift;
+  cellsx = (innewwidth + DATUMSHIFT_CELL - 1)/DATUMSHIFT_CELL;
+  cellsy = (innewheight + DATUMSHIFT_CELL - 1)/DATUMSHIFT_CELL;
+  exactcount = 0;
+  maxerror = 0.0;
+
+  dlon.assign((cellsx + 1)*(cellsy + 1), nan);
+  dlat.assign((cellsx + 1)*(cellsy + 1), nan);
+  exact.assign(cellsx*cellsy, 0);
+
+  //the shift at the nodes
+  for (ycounter = 0; ycounter <= cellsy; ++ycounter)
+  {
+    for (xcounter = 0; xcounter <= cellsx; ++xcounter)
+    {
+      x = outRect.left + newscale.x*xcounter*DATUMSHIFT_CELL;
+      y = outRect.top - newscale.y*ycounter*DATUMSHIFT_CELL;
+      to->projectToGeo(x, y, lat, lon);
+      if ((lon - lon == 0.0) && (lat - lat == 0.0))
+      {
+        node = ycounter*(cellsx + 1) + xcounter;
+        shift.delta(lon, lat, dlon[node], dlat[node]);
+      }
+    }
+  }
+
+  //check the middle of each cell
+  for (ycounter = 0; ycounter < cellsy; ++ycounter)
+  {
+    for (xcounter = 0; xcounter < cellsx; ++xcounter)
+    {
+      node = ycounter*(cellsx + 1) + xcounter;
+      tlon = 0.25*(dlon[node] + dlon[node + 1] + dlon[node + cellsx + 1]
+                   + dlon[node + cellsx + 2]);
+      tlat = 0.25*(dlat[node] + dlat[node + 1] + dlat[node + cellsx + 1]
+                   + dlat[node + cellsx + 2]);
+
+      x = outRect.left + newscale.x*(xcounter + 0.5)*DATUMSHIFT_CELL;
+      y = outRect.top - newscale.y*(ycounter + 0.5)*DATUMSHIFT_CELL;
+      to->projectToGeo(x, y, lat, lon);
+      shift.delta(lon, lat, x, y);
+
+      error = std::fabs(tlon - x);
+      if (std::fabs(tlat - y) > error)
+        error = std::fabs(tlat - y);
+
+      //a NaN anywhere fails this too
+      if (!(error <= DATUMSHIFT_TOLERANCE))
+      {
+        exact[ycounter*cellsx + xcounter] = 1;
+        ++exactcount;
+      }
+      else if (error > maxerror)
+        maxerror = error;
+    }
+  }
+}
+
+//****************************************************************
+void DatumShiftGrid::shiftRow(long int ycounter, long int startx,
+                              long int count, double * lon,
+                              double * lat) const throw()
+{
+  const long int celly = ycounter/DATUMSHIFT_CELL;
+  const double fy = static_cast<double>(ycounter - celly*DATUMSHIFT_CELL)
+    /DATUMSHIFT_CELL;
+  const long int stop = startx + count;
+  long int x(startx), cellx, spanstop, node;
+  double leftlon, leftlat, steplon, steplat, fx;
+
+  while (x < stop)
+  {
+    cellx = x/DATUMSHIFT_CELL;
+    spanstop = (cellx + 1)*DATUMSHIFT_CELL;
+    if (spanstop > stop)
+      spanstop = stop;
+
+    if ((cellx >= cellsx) || (celly >= cellsy) ||
+        exact[celly*cellsx + cellx])
+    {
+      for (; x < spanstop; ++x, ++lon, ++lat)
+        shift.shift(*lon, *lat);
+      continue;
+    }
+
+    //the shift down the left and right sides of the cell at this row
+    node = celly*(cellsx + 1) + cellx;
+    leftlon = dlon[node] + (dlon[node + cellsx + 1] - dlon[node])*fy;
+    leftlat = dlat[node] + (dlat[node + cellsx + 1] - dlat[node])*fy;
+    steplon = (dlon[node + 1] + (dlon[node + cellsx + 2] - dlon[node + 1])*fy
+               - leftlon)/DATUMSHIFT_CELL;
+    steplat = (dlat[node + 1] + (dlat[node + cellsx + 2] - dlat[node + 1])*fy
+               - leftlat)/DATUMSHIFT_CELL;
+
+    for (; x < spanstop; ++x, ++lon, ++lat)
+    {
+      fx = static_cast<double>(x - cellx*DATUMSHIFT_CELL);
+      *lon += leftlon + steplon*fx;
+      *lat += leftlat + steplat*fx;
+    }
+  }
+}
+
+//****************************************************************
+long int DatumShiftGrid::getCellCount() const throw()
+{
+  return cellsx*cellsy;
+}
+
+//****************************************************************
+long int DatumShiftGrid::getExactCount() const throw()
+{
+  return exactcount;
+}
+
+//****************************************************************
+double DatumShiftGrid::getMaxError() const throw()
+{
+  return maxerror;
+}
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * DatumShift moves geographic coordinates from one datum to another
+ * with the standard Molodensky formulas and the three parameter shifts
+ * to WGS 84.  The datums it knows are NAD27 (the CONUS mean), NAD83,
+ * WGS 72 and WGS 84; good() is false for a pair it can't do or that
+ * doesn't need a shift.  The projection library doesn't shift between
+ * datums, so the projector only shifts when it is asked to (see
+ * Projector::setShiftDatums).
+ *
+ * DatumShiftGrid caches the shift for a job.  The shift is computed at
+ * the nodes of a grid of square cells over the output image and
+ * bilinearly interpolated in between.  Each cell is checked at its
+ * center and one that is off from the exact shift by more than
+ * DATUMSHIFT_TOLERANCE (or has a corner that didn't project) has its
+ * pixels shifted exactly instead.
+ **/
+
+#ifndef DATUMSHIFT_H_
+#define DATUMSHIFT_H_
+
+#include <new>
+#include <vector>
+#include "ProjectionLib/Projection.h"
+#include "MathLib/Point.h"
+#include "DRect.h"
+
+//Size of the grid cells in output pixels
+#define DATUMSHIFT_CELL 128
+
+//Most a grid cell can be off from the exact shift in degrees (about a
+//millimeter)
+#define DATUMSHIFT_TOLERANCE 1e-8
+
+
+class DatumShift
+{
+ public:
+  /**
+   * Constructor takes the datum shifted from and the one shifted to.
+   * The default one doesn't shift.
+   **/
+  DatumShift() throw();
+  DatumShift(ProjLib::DATUM infrom, ProjLib::DATUM into) throw();
+
+  /**
+   * good returns true if there is a shift to do
+   **/
+  bool good() const throw();
+
+  /**
+   * delta gets the change in longitude and latitude (in degrees) at
+   * lon, lat and shift adds it.
+   **/
+  void delta(double lon, double lat, double & dlon, double & dlat) const
+    throw();
+  void shift(double & lon, double & lat) const throw();
+
+ protected:
+  bool shifting;                         //whether there is a shift
+  double a, f, b, es;                    //the from spheroid
+  double da, df;                         //change in the spheroid
+  double dx, dy, dz;                     //change in the center (meters)
+};
+
+
+class DatumShiftGrid
+{
+ public:
+  /**
+   * Constructor and Destructor
+   **/
+  DatumShiftGrid();
+  ~DatumShiftGrid();
+
+  /**
+   * calculate builds the grid over a newwidth by newheight output image
+   * in to with the given grid.  The shift is from the datum of the
+   * geographic coordinates of to.
+   **/
+  void calculate(ProjLib::Projection * to, const DatumShift & inshift,
+                 const DRect & outRect, const MathLib::Point & newscale,
+                 long int innewwidth, long int innewheight)
+    throw(std::bad_alloc);
+
+  /**
+   * shiftRow shifts the longitudes and latitudes of count output pixels
+   * starting at startx on output row ycounter
+   **/
+  void shiftRow(long int ycounter, long int startx, long int count,
+                double * lon, double * lat) const throw();
+
+  /**
+   * getCellCount returns the number of cells and getExactCount the
+   * number of them that are shifted exactly.  getMaxError returns the
+   * largest error (degrees) of the interpolated cells.
+   **/
+  long int getCellCount() const throw();
+  long int getExactCount() const throw();
+  double getMaxError() const throw();
+
+ protected:
+  DatumShift shift;                      //the exact shift
+  long int cellsx, cellsy;               //number of cells
+  std::vector<double> dlon, dlat;        //shift at each node
+  std::vector<char> exact;               //cells that are done exactly
+  long int exactcount;                   //number of them
+  double maxerror;                       //largest error interpolated
+};
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * Implementation file for ExtentSampler
+ **/
+
+#ifndef EXTENTSAMPLER_CPP_
+#define EXTENTSAMPLER_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "ExtentSampler.h"
+#include <cmath>
+
+//****************************************************************
+ExtentSampler::ExtentSampler(const DRect & ininRect,
+                             const MathLib::Point & inoldscale,
+                             long int inoldwidth, long int inoldheight)
+  throw()
+  : inRect(ininRect), oldscale(inoldscale), oldwidth(inoldwidth),
+    oldheight(inoldheight), from(NULL), to(NULL), bounds(NULL), points(0)
+{}
+
+//****************************************************************
+bool ExtentSampler::sample(ProjLib::Projection * infrom,
+                           ProjLib::Projection * into,
+                           const DatumShift & inshift,
+                           EdgeBounds & inbounds) throw()
+{
+  std::vector<EdgePoint> samples;         //samples of a side
+  EdgePoint point;
+  double meridian(0.0), d1, d2, lon1, lon2;
+  long int length, steps, counter, pixel;
+  bool havemeridian;
+  int side, coord;
+
+  try
+  {
+    from = infrom;
+    to = into;
+    shift = inshift;
+    bounds = &inbounds;
+    havemeridian = getCentralMeridian(to, meridian);
+
+    for (side = 0; side < 4; ++side)
+    {
+      length = (side < 2) ? oldwidth : oldheight;
+      steps = (length - 1 < EXTENTSAMPLER_STEPS) ? length - 1
+        : EXTENTSAMPLER_STEPS;
+
+      //the ends, the pixels next to them (so a turn just inside an end
+      //shows) and the evenly spaced steps
+      samples.clear();
+      for (counter = 0; counter <= steps + 2; ++counter)
+      {
+        if (counter == 0)
+          pixel = 0;
+        else if (counter == 1)
+          pixel = 1;
+        else if (counter == steps + 1)
+          pixel = length - 2;
+        else if (counter == steps + 2)
+          pixel = length - 1;
+        else
+          pixel = (length - 1)*(counter - 1)/steps;
+
+        if ((pixel >= length) ||
+            (samples.size() && (pixel <= samples.back().pixel)))
+          continue;
+        if (!project(side, pixel, point))
+          return false;
+        samples.push_back(point);
+      }
+
+      //narrow down anywhere x or y turns around
+      for (counter = 1; counter + 1 < static_cast<long int>(samples.size());
+           ++counter)
+      {
+        for (coord = 0; coord < 2; ++coord)
+        {
+          d1 = coord ? samples[counter].y - samples[counter - 1].y
+            : samples[counter].x - samples[counter - 1].x;
+          d2 = coord ? samples[counter + 1].y - samples[counter].y
+            : samples[counter + 1].x - samples[counter].x;
+
+          if (((d1 > 0.0) && (d2 <= 0.0)) || ((d1 >= 0.0) && (d2 < 0.0)))
+          {
+            if (!narrow(side, samples[counter - 1].pixel,
+                        samples[counter + 1].pixel, coord, 1))
+              return false;
+          }
+          else if (((d1 < 0.0) && (d2 >= 0.0)) ||
+                   ((d1 <= 0.0) && (d2 > 0.0)))
+          {
+            if (!narrow(side, samples[counter - 1].pixel,
+                        samples[counter + 1].pixel, coord, -1))
+              return false;
+          }
+        }
+      }
+
+      //and where the side crosses the central meridian
+      if (!havemeridian)
+        continue;
+      for (counter = 1; counter < static_cast<long int>(samples.size());
+           ++counter)
+      {
+        lon1 = std::fmod(samples[counter - 1].lon - meridian + 540.0, 360.0)
+          - 180.0;
+        lon2 = std::fmod(samples[counter].lon - meridian + 540.0, 360.0)
+          - 180.0;
+        if ((std::fabs(lon1) < 90.0) && (std::fabs(lon2) < 90.0) &&
+            (((lon1 < 0.0) && (lon2 > 0.0)) || ((lon1 > 0.0) && (lon2 < 0.0))))
+        {
+          if (!cross(side, samples[counter - 1], samples[counter], meridian))
+            return false;
+        }
+      }
+    }
+
+    addPoles(meridian);
+    return true;
+  }
+  catch(...)
+  {
+    return false;
+  }
+}
+
+//****************************************************************
+long int ExtentSampler::getPointCount() const throw()
+{
+  return points;
+}
+
+//****************************************************************
+bool ExtentSampler::project(int side, long int pixel, EdgePoint & point)
+  throw()
+{
+  double x, y, lat, lon;
+
+  switch (side)
+  {
+  case 0:                                 //top
+  case 1:                                 //bottom
+    x = inRect.left + oldscale.x*pixel;
+    y = side ? inRect.bottom : inRect.top;
+    break;
+  default:                                //left and right
+    x = (side == 2) ? inRect.left : inRect.right;
+    y = inRect.top - oldscale.y*pixel;
+    break;
+  }
+
+  from->projectToGeo(x, y, lat, lon);
+  shift.shift(lon, lat);
+  to->projectFromGeo(lat, lon, x, y);
+  ++points;
+
+  if (!(x - x == 0.0) || !(y - y == 0.0) || !(lon - lon == 0.0))
+    return false;
+
+  point.pixel = pixel;
+  point.x = x;
+  point.y = y;
+  point.lon = lon;
+  bounds->add(x, y);
+  return true;
+}
+
+//****************************************************************
+bool ExtentSampler::narrow(int side, long int first, long int last,
+                           int coord, int sign) throw()
+{
+  EdgePoint a, b;
+  long int middle;
+
+  //the pixel before the extreme goes towards it and the one after it
+  //goes away
+  while (first < last)
+  {
+    middle = first + (last - first)/2;
+    if (!project(side, middle, a) || !project(side, middle + 1, b))
+      return false;
+
+    if (sign*(coord ? b.y - a.y : b.x - a.x) > 0.0)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  return true;
+}
+
+//****************************************************************
+bool ExtentSampler::cross(int side, EdgePoint first, EdgePoint last,
+                          double meridian) throw()
+{
+  EdgePoint middle;
+  const bool firsteast = (std::fmod(first.lon - meridian + 540.0, 360.0)
+                          - 180.0) > 0.0;
+
+  while (last.pixel - first.pixel > 1)
+  {
+    if (!project(side, first.pixel + (last.pixel - first.pixel)/2, middle))
+      return false;
+
+    if (((std::fmod(middle.lon - meridian + 540.0, 360.0) - 180.0) > 0.0)
+        == firsteast)
+      first = middle;
+    else
+      last = middle;
+  }
+
+  return true;
+}
+
+//****************************************************************
+void ExtentSampler::addPoles(double meridian) throw()
+{
+  const double lons[3] = {-180.0, meridian, 180.0};
+  const double left = (inRect.left < inRect.right) ? inRect.left
+    : inRect.right;
+  const double right = (inRect.left < inRect.right) ? inRect.right
+    : inRect.left;
+  const double bottom = (inRect.bottom < inRect.top) ? inRect.bottom
+    : inRect.top;
+  const double top = (inRect.bottom < inRect.top) ? inRect.top
+    : inRect.bottom;
+  double lat, x, y;
+  int pole, counter;
+
+  for (pole = 0; pole < 2; ++pole)
+  {
+    lat = pole ? -90.0 : 90.0;
+    from->projectFromGeo(lat, meridian, x, y);
+    ++points;
+    if (!(x >= left) || !(x <= right) || !(y >= bottom) || !(y <= top))
+      continue;
+
+    //in a projection where the pole is a line all of it is inside.  A
+    //pole stays a pole on any datum.
+    for (counter = 0; counter < 3; ++counter)
+    {
+      to->projectFromGeo(lat, lons[counter], x, y);
+      ++points;
+      bounds->add(x, y);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * ExtentSampler finds the extents of the input image in the output
+ * projection without projecting every edge pixel.  Each side of the
+ * input is sampled sparsely and wherever the projected x or y turns
+ * around between samples the turn is narrowed down to the pixel by
+ * bisection.  The output central meridian crossings of the sides are
+ * found the same way, and a pole inside the input (where the extremes
+ * are inside the image rather than on an edge) is added on its own.
+ *
+ * Sampling assumes each side turns at most once between samples, which
+ * holds for the sides of real images.  Anything that doesn't project
+ * makes it give up so the caller can walk the whole edge instead.
+ **/
+
+#ifndef EXTENTSAMPLER_H_
+#define EXTENTSAMPLER_H_
+
+#include <vector>
+#include "ProjUtil.h"
+#include "DatumShift.h"
+#include "MathLib/Point.h"
+#include "DRect.h"
+
+//Intervals each side is sampled at before narrowing
+#define EXTENTSAMPLER_STEPS 32
+
+
+class ExtentSampler
+{
+ public:
+  /**
+   * Constructor takes the input grid
+   **/
+  ExtentSampler(const DRect & ininRect, const MathLib::Point & inoldscale,
+                long int inoldwidth, long int inoldheight) throw();
+
+  /**
+   * sample adds the extremes of the input in the to projection to
+   * bounds, shifting by inshift in between.  Returns false if any of
+   * the points it needed didn't project.
+   **/
+  bool sample(ProjLib::Projection * from, ProjLib::Projection * to,
+              const DatumShift & inshift, EdgeBounds & bounds) throw();
+
+  /**
+   * getPointCount returns the number of points projected by sample
+   **/
+  long int getPointCount() const throw();
+
+ protected:
+  //A projected pixel of a side
+  struct EdgePoint
+  {
+    long int pixel;                      //pixel along the side
+    double x, y;                         //output coordinates
+    double lon;                          //longitude on the way
+  };
+
+  //project projects pixel of side (top, bottom, left then right)
+  bool project(int side, long int pixel, EdgePoint & point) throw();
+
+  //narrow bisects the pixels between first and last (sorted samples
+  //with the turn between them) to the extreme of coord (0 is x, 1 is
+  //y).  sign is 1 for a max and -1 for a min.
+  bool narrow(int side, long int first, long int last, int coord,
+              int sign) throw();
+
+  //cross bisects the pixels between first and last to where the
+  //longitude crosses meridian
+  bool cross(int side, EdgePoint first, EdgePoint last, double meridian)
+    throw();
+
+  //addPoles adds the poles that are inside the input
+  void addPoles(double meridian) throw();
+
+  DRect inRect;                          //input rectangle
+  MathLib::Point oldscale;               //input scale
+  long int oldwidth, oldheight;          //input size
+  ProjLib::Projection * from, * to;      //the projections being sampled
+  DatumShift shift;                      //between their datums
+  EdgeBounds * bounds;                   //where the points go
+  long int points;                       //points projected
+};
+
+#endif
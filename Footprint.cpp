@@ -0,0 +1,235 @@
+/**
+ * Implementation file for Footprint
+ **/
+
+#ifndef FOOTPRINT_CPP_
+#define FOOTPRINT_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "Footprint.h"
+#include <cmath>
+#include <cstring>
+
+//****************************************************************
+Footprint::Footprint(const DRect & ininRect,
+                     const MathLib::Point & inoldscale,
+                     long int inoldwidth, long int inoldheight,
+                     const DRect & inoutRect,
+                     const MathLib::Point & innewscale,
+                     long int innewwidth, long int innewheight,
+                     long int inpixelbytes) throw(std::bad_alloc)
+  : inRect(ininRect), outRect(inoutRect), oldscale(inoldscale),
+    newscale(innewscale), oldwidth(inoldwidth), oldheight(inoldheight),
+    newwidth(innewwidth), newheight(innewheight),
+    pixelbytes(inpixelbytes), margin(FOOTPRINT_MARGIN), spanstart(NULL),
+    spanend(NULL)
+{
+  if (!(spanstart = new (std::nothrow) long int[newheight]))
+    throw std::bad_alloc();
+  if (!(spanend = new (std::nothrow) long int[newheight]))
+  {
+    delete [] spanstart;
+    throw std::bad_alloc();
+  }
+
+  setFull();
+}
+
+//****************************************************************
+Footprint::~Footprint()
+{
+  delete [] spanstart;
+  delete [] spanend;
+}
+
+//****************************************************************
+bool Footprint::calculate(ProjLib::Projection * from,
+                          ProjLib::Projection * to,
+                          const DatumShift & shift, double inerror) throw()
+{
+  //the input pixels the kernels accept (after rounding) run from -1.5
+  //to width - 0.5 so walk around that rectangle
+  const double px[4] = {-1.5, oldwidth - 0.5, oldwidth - 0.5, -1.5};
+  const double py[4] = {-1.5, -1.5, oldheight - 0.5, oldheight - 0.5};
+  std::vector<double> xlow, xhigh;        //x range of each row
+  std::vector<double> outx, outy;         //the outline in output pixels
+  std::vector<double> steps;              //input pixels to each point
+  double x, y;                            //output pixel coordinates
+  double length, scale(0.0);              //side length and most scale
+  long int side, nsteps, step, ycounter, point;  //counters
+
+  try
+  {
+    for (side = 0; side < 4; ++side)
+    {
+      length = std::fabs(px[(side + 1) % 4] - px[side])
+        + std::fabs(py[(side + 1) % 4] - py[side]);
+      nsteps = static_cast<long int>(std::ceil(length / FOOTPRINT_STEP));
+
+      for (step = 0; step < nsteps; ++step)
+      {
+        //get the world coordinates of this point on the perimeter
+        x = px[side] + (px[(side + 1) % 4] - px[side]) * step / nsteps;
+        y = py[side] + (py[(side + 1) % 4] - py[side]) * step / nsteps;
+        x = inRect.left + oldscale.x * x;
+        y = inRect.top - oldscale.y * y;
+
+        from->projectToGeo(x, y, y, x);
+        shift.shift(x, y);
+        to->projectFromGeo(y, x, x, y);
+
+        //convert to output pixels
+        x = (x - outRect.left) / newscale.x;
+        y = (outRect.top - y) / newscale.y;
+
+        //anything that didn't project (or is off in space) means the
+        //outline can't be trusted
+        if (!(std::fabs(x) < 1e9) || !(std::fabs(y) < 1e9))
+        {
+          setFull();
+          return false;
+        }
+
+        outx.push_back(x);
+        outy.push_back(y);
+        steps.push_back(length / nsteps);
+      }
+    }
+
+    //the output pixels an input pixel of error can move a point by is
+    //about the most the outline stretches between its points
+    for (point = 0; point < static_cast<long int>(outx.size()); ++point)
+    {
+      step = (point + 1) % outx.size();
+      length = std::fabs(outx[step] - outx[point])
+        + std::fabs(outy[step] - outy[point]);
+      if (length > scale*steps[point])
+        scale = length / steps[point];
+    }
+    margin = std::ceil(inerror*scale) + FOOTPRINT_MARGIN;
+
+    xlow.resize(newheight, HUGE_VAL);
+    xhigh.resize(newheight, -HUGE_VAL);
+    for (point = 0; point < static_cast<long int>(outx.size()); ++point)
+    {
+      step = (point + 1) % outx.size();   //the last closes it up
+      addEdge(xlow, xhigh, outx[point], outy[point], outx[step],
+              outy[step]);
+    }
+
+    //now turn the x ranges into spans of whole pixels
+    for (ycounter = 0; ycounter < newheight; ++ycounter)
+    {
+      if (xlow[ycounter] > xhigh[ycounter])
+      {
+        spanstart[ycounter] = spanend[ycounter] = 0;  //nothing on row
+        continue;
+      }
+
+      x = std::floor(xlow[ycounter]) - margin;
+      spanstart[ycounter] = (x < 0.0) ? 0 : static_cast<long int>(x);
+      x = std::ceil(xhigh[ycounter]) + margin + 1;
+      spanend[ycounter] = (x > newwidth) ? newwidth
+        : static_cast<long int>(x);
+      if (spanend[ycounter] < spanstart[ycounter])
+        spanend[ycounter] = spanstart[ycounter];
+    }
+    return true;
+  }
+  catch(...)
+  {
+    setFull();
+    return false;
+  }
+}
+
+//****************************************************************
+void Footprint::clipRow(long int ycounter, unsigned char * scanline,
+                        long int & startx, long int & count) const throw()
+{
+  startx = spanstart[ycounter];
+  count = spanend[ycounter] - startx;
+
+  //clear the pixels on either side of the span
+  std::memset(scanline, 0, startx * pixelbytes);
+  std::memset(scanline + spanend[ycounter] * pixelbytes, 0,
+              (newwidth - spanend[ycounter]) * pixelbytes);
+}
+
+//****************************************************************
+void Footprint::getSpan(long int ycounter, long int & startx,
+                        long int & count) const throw()
+{
+  startx = spanstart[ycounter];
+  count = spanend[ycounter] - startx;
+}
+
+//****************************************************************
+void Footprint::setFull() throw()
+{
+  long int ycounter;
+
+  for (ycounter = 0; ycounter < newheight; ++ycounter)
+  {
+    spanstart[ycounter] = 0;
+    spanend[ycounter] = newwidth;
+  }
+}
+
+//****************************************************************
+void Footprint::addEdge(std::vector<double> & xlow,
+                        std::vector<double> & xhigh,
+                        double x0, double y0,
+                        double x1, double y1) const throw()
+{
+  const double ylow = (y0 < y1) ? y0 : y1;
+  const double yhigh = (y0 < y1) ? y1 : y0;
+  double ya, yb, xa, xb, temp;
+  long int ycounter, ystart, yend;
+
+  //every row within the margin of the edge
+  temp = std::ceil(ylow - margin);
+  ystart = (temp < 0.0) ? 0 : static_cast<long int>(temp);
+  temp = std::floor(yhigh + margin);
+  yend = (temp > newheight - 1) ? newheight - 1
+    : static_cast<long int>(temp);
+
+  for (ycounter = ystart; ycounter <= yend; ++ycounter)
+  {
+    //the part of the edge inside the band around this row
+    ya = ycounter - margin;
+    yb = ycounter + margin;
+    if (ya < ylow)
+      ya = ylow;
+    if (yb > yhigh)
+      yb = yhigh;
+
+    if (y1 == y0)
+    {
+      xa = x0;
+      xb = x1;
+    }
+    else
+    {
+      xa = x0 + (x1 - x0) * (ya - y0) / (y1 - y0);
+      xb = x0 + (x1 - x0) * (yb - y0) / (y1 - y0);
+    }
+
+    if (xa > xb)
+    {
+      temp = xa;
+      xa = xb;
+      xb = temp;
+    }
+    if (xa < xlow[ycounter])
+      xlow[ycounter] = xa;
+    if (xb > xhigh[ycounter])
+      xhigh[ycounter] = xb;
+  }
+}
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * Footprint is the outline of the input image in output pixel
+ * coordinates.  It is used to find the span of each output scanline
+ * that can land inside the input image so the reprojection loops only
+ * project and resample that span and just clear the rest of the row.
+ **/
+
+#ifndef FOOTPRINT_H_
+#define FOOTPRINT_H_
+
+#include <new>
+#include <vector>
+#include "ProjectionMesh/ProjectionMesh.h"
+#include "MathLib/Point.h"
+#include "DRect.h"
+#include "DatumShift.h"
+
+//How many input pixels apart the perimeter is sampled
+#define FOOTPRINT_STEP 16
+
+//How many output pixels the spans are padded by on each side on top
+//of the error of the mapping
+#define FOOTPRINT_MARGIN 2
+
+
+class Footprint
+{
+ public:
+  /**
+   * Main constructor takes the input and output grids.  pixelbytes is
+   * the size of an output pixel in bytes.  Until calculate is called
+   * every row spans the whole output width.
+   **/
+  Footprint(const DRect & ininRect, const MathLib::Point & inoldscale,
+            long int inoldwidth, long int inoldheight,
+            const DRect & inoutRect, const MathLib::Point & innewscale,
+            long int innewwidth, long int innewheight,
+            long int inpixelbytes) throw(std::bad_alloc);
+
+  /**
+   * Destructor
+   **/
+  ~Footprint();
+
+  /**
+   * calculate forward projects the input perimeter into the output
+   * image and builds the row spans from it, shifting by shift in
+   * between.  inerror is the most (in input pixels) the mapping used
+   * to resample can be off from the exact one; the spans are widened
+   * by what that is in output pixels.  If any of the perimeter can't
+   * be projected the rows are left spanning the whole width and false
+   * is returned.
+   **/
+  bool calculate(ProjLib::Projection * from, ProjLib::Projection * to,
+                 const DatumShift & shift, double inerror = 0.0) throw();
+
+  /**
+   * clipRow clears the pixels of scanline ycounter that are outside of
+   * the footprint and returns the span that is left to be projected.
+   * count may be zero.
+   **/
+  void clipRow(long int ycounter, unsigned char * scanline,
+               long int & startx, long int & count) const throw();
+
+  /**
+   * getSpan returns the span of scanline ycounter without touching a
+   * scanline.
+   **/
+  void getSpan(long int ycounter, long int & startx, long int & count)
+    const throw();
+
+ protected:
+  //setFull makes every row span the whole output width
+  void setFull() throw();
+
+  //addEdge widens the x range of the rows an edge (in output pixel
+  //coordinates) passes near
+  void addEdge(std::vector<double> & xlow, std::vector<double> & xhigh,
+               double x0, double y0, double x1, double y1) const throw();
+
+  DRect inRect, outRect;                 //input and output bounds
+  MathLib::Point oldscale, newscale;     //input and output scales
+  long int oldwidth, oldheight;          //input dimensions
+  long int newwidth, newheight;          //output dimensions
+  long int pixelbytes;                   //bytes per output pixel
+  double margin;                         //padding of the spans
+  long int * spanstart, * spanend;       //the span of each row
+};
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ * Implementation file for InputRows
+ **/
+
+#ifndef INPUTROWS_CPP_
+#define INPUTROWS_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "InputRows.h"
+#include <cstring>
+
+//****************************************************************
+InputRows::InputRows(USGSImageLib::ImageIFile * ininfile,
+                     RowCache * incache,
+                     int inbps, long int inrowbytes, long int inheight,
+                     long int inpinbytes)
+  throw(std::bad_alloc)
+  : infile(ininfile), cache(incache), bps(inbps), rowbuffer(NULL),
+    lasty(-1), lastrow(NULL), rowbytes(inrowbytes), height(inheight),
+    pinbytes(inpinbytes), pincapacity(0), pinbuffer(NULL), slotrows(NULL),
+    pintable(NULL), pinfirst(0), pincount(0)
+{
+  if (!cache && infile)
+  {
+    if (!(rowbuffer = new (std::nothrow) unsigned char[inrowbytes]))
+      throw std::bad_alloc();
+  }
+}
+
+//****************************************************************
+InputRows::~InputRows()
+{
+  if (cache && pincount)
+    unpinCacheRows();
+
+  delete [] rowbuffer;
+  delete [] pinbuffer;
+  delete [] slotrows;
+  delete [] pintable;
+}
+
+//****************************************************************
+void InputRows::getRowRange(const double * yarr, long int count,
+                            long int & first, long int & last) const
+  throw()
+{
+  const double dheight = static_cast<double>(height);
+  double ty;
+  long int counter, y;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    ty = yarr[counter] + 0.5;
+    if ((ty > -1.0) && (ty < dheight))          //same test as the kernels
+    {
+      y = static_cast<long int>(ty);
+      if (y < first)
+        first = y;
+      if (y > last)
+        last = y;
+    }
+  }
+}
+
+//****************************************************************
+void InputRows::getRowRange(const long int * yidx, long int count,
+                            long int & first, long int & last) const
+  throw()
+{
+  long int counter, y;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    y = yidx[counter];
+    if ((y >= 0) && (y < height))               //same test as the kernels
+    {
+      if (y < first)
+        first = y;
+      if (y > last)
+        last = y;
+    }
+  }
+}
+
+//****************************************************************
+bool InputRows::pinRows(long int first, long int last) throw()
+{
+  long int y, slot;
+  const unsigned char * row;
+
+  if (cache && pincount)                        //unpin the old range
+    unpinCacheRows();
+  pincount = 0;
+  lasty = -1;                                   //rowbuffer gets reused
+
+  if (first < 0)
+    first = 0;
+  if (last >= height)
+    last = height - 1;
+  if (last < first)
+    return true;                                //nothing to pin
+
+  //aim the cache at the rows the chunk needs
+  if (cache)
+    setCacheWindow(first, last);
+
+  //set up the table (and the slots without a cache) the first time
+  if (!pintable)
+  {
+    if (rowbytes > 0)
+      pincapacity = pinbytes / rowbytes;
+    if (pincapacity > height)
+      pincapacity = height;
+    if (pincapacity <= 0)
+      return false;
+
+    if ((!cache &&
+         (!(pinbuffer = new (std::nothrow) unsigned char
+            [pincapacity*rowbytes]) ||
+          !(slotrows = new (std::nothrow) long int[pincapacity]))) ||
+        !(pintable = new (std::nothrow) const unsigned char *[pincapacity]))
+    {
+      //can't pin so just fall back to the cache
+      delete [] pinbuffer;
+      delete [] slotrows;
+      pinbuffer = NULL;
+      slotrows = NULL;
+      pincapacity = 0;
+      return false;
+    }
+
+    if (slotrows)
+    {
+      for (slot = 0; slot < pincapacity; ++slot)
+        slotrows[slot] = -1;
+    }
+  }
+
+  if (last - first + 1 > pincapacity)
+    return false;                               //too many rows
+
+  if (cache)
+    return pinCacheRows(first, last);
+
+  //read the rows that aren't already in their slots
+  for (y = first; y <= last; ++y)
+  {
+    slot = y % pincapacity;
+    if (slotrows[slot] != y)
+    {
+      if (!(row = fetchRow(y)))
+      {
+        slotrows[slot] = -1;
+        return false;
+      }
+      std::memcpy(pinbuffer + slot*rowbytes, row, rowbytes);
+      slotrows[slot] = y;
+    }
+    pintable[y - first] = pinbuffer + slot*rowbytes;
+  }
+
+  pinfirst = first;
+  pincount = last - first + 1;
+  return true;
+}
+
+//****************************************************************
+bool InputRows::pinCacheRows(long int first, long int last) throw()
+{
+  const unsigned char * row;
+  long int y;
+
+  for (y = first; y <= last; ++y)
+  {
+    //leave a row unpinned so rows outside the range can still be read
+    if (!(row = cache->pinRow(y)) ||
+        (cache->getPinned() >= cache->getCapacity()))
+    {
+      if (row)
+        cache->unpinRow(y);
+      while (--y >= first)
+        cache->unpinRow(y);
+      return false;
+    }
+    pintable[y - first] = row;
+  }
+
+  pinfirst = first;
+  pincount = last - first + 1;
+  return true;
+}
+
+//****************************************************************
+void InputRows::unpinCacheRows() throw()
+{
+  long int y;
+
+  for (y = pinfirst; y < pinfirst + pincount; ++y)
+    cache->unpinRow(y);
+  pincount = 0;
+}
+
+//****************************************************************
+const unsigned char * InputRows::fetchRow(long int y) throw()
+{
+  if (cache)
+    return cache->getRawScanline(y);           //get a pointer to cache
+
+  if (bps == 16)
+    dynamic_cast<USGSImageLib::TIFFImageIFile*>(infile)
+      ->getRawScanline(y, static_cast<tdata_t>(rowbuffer));
+  else
+    infile->getRawScanline(y, rowbuffer);
+
+  return rowbuffer;
+}
+
+//****************************************************************
+void InputRows::setCacheWindow(long int first, long int last) throw()
+{
+  cache->setWindow(first, last);
+}
+
+
+//****************************************************************
+MappedInputRows::MappedInputRows(MappedInput * inmapped,
+                                 long int inrowbytes)
+  throw(std::bad_alloc)
+  : InputRows(NULL, NULL, 8, inrowbytes, inmapped->getHeight()),
+    mapped(inmapped)
+{
+  long int y;
+
+  //the whole image is one pinned range
+  if (!(pintable = new (std::nothrow) const unsigned char *[height]))
+    throw std::bad_alloc();
+
+  for (y = 0; y < height; ++y)
+    pintable[y] = mapped->getRow(y);
+  pinfirst = 0;
+  pincount = height;
+}
+
+//****************************************************************
+MappedInputRows::~MappedInputRows()
+{}
+
+//****************************************************************
+bool MappedInputRows::pinRows(long int first, long int last) throw()
+{
+  mapped->adviseRows(first, last);
+  return true;
+}
+
+//****************************************************************
+const unsigned char * MappedInputRows::fetchRow(long int y) throw()
+{
+  return mapped->getRow(y);
+}
+
+
+//****************************************************************
+LockedInputRows::LockedInputRows(USGSImageLib::ImageIFile * ininfile,
+                                 RowCache * incache,
+                                 int inbps, long int inrowbytes,
+                                 long int inheight, long int inpinbytes,
+                                 ACE_Thread_Mutex & inlock)
+  throw(std::bad_alloc)
+  : InputRows(ininfile, incache, inbps, inrowbytes, inheight, inpinbytes),
+    lock(inlock), copybuffer(NULL)
+{
+  //rows in the cache can go away once the lock is released so they
+  //have to be copied out unless they are pinned
+  if (cache)
+  {
+    if (!(copybuffer = new (std::nothrow) unsigned char[rowbytes]))
+      throw std::bad_alloc();
+  }
+}
+
+//****************************************************************
+LockedInputRows::~LockedInputRows()
+{
+  if (cache && pincount)
+    unpinCacheRows();                         //under the lock
+
+  delete [] copybuffer;
+}
+
+//****************************************************************
+const unsigned char * LockedInputRows::fetchRow(long int y) throw()
+{
+  const unsigned char * ret;
+
+  lock.acquire();
+  ret = InputRows::fetchRow(y);
+  if (copybuffer && ret)
+  {
+    std::memcpy(copybuffer, ret, rowbytes);
+    ret = copybuffer;
+  }
+  lock.release();
+
+  return ret;
+}
+
+//****************************************************************
+void LockedInputRows::setCacheWindow(long int first, long int last) throw()
+{
+  lock.acquire();
+  InputRows::setCacheWindow(first, last);
+  lock.release();
+}
+
+//****************************************************************
+bool LockedInputRows::pinCacheRows(long int first, long int last) throw()
+{
+  bool ret;
+
+  lock.acquire();
+  ret = InputRows::pinCacheRows(first, last);
+  lock.release();
+
+  return ret;
+}
+
+//****************************************************************
+void LockedInputRows::unpinCacheRows() throw()
+{
+  lock.acquire();
+  InputRows::unpinCacheRows();
+  lock.release();
+}
+
+
+//****************************************************************
+SharedInputRows::SharedInputRows(SharedRowCache * inshared,
+                                 long int inrowbytes, long int inheight,
+                                 long int inpinbytes)
+  throw(std::bad_alloc)
+  : InputRows(NULL, NULL, 8, inrowbytes, inheight, inpinbytes),
+    shared(inshared)
+{}
+
+//****************************************************************
+SharedInputRows::~SharedInputRows()
+{}
+
+//****************************************************************
+const unsigned char * SharedInputRows::fetchRow(long int y) throw()
+{
+  return shared->getRawScanline(y);
+}
+
+#endif
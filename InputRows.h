@@ -0,0 +1,190 @@
+/**
+ * InputRows hands out raw input scanlines to the resampling kernels.
+ * It hides whether the rows come from the cache or straight from the
+ * input file (16 bit tiffs can't use the cache) and remembers the last
+ * row so that runs of pixels on the same input row only cost a compare.
+ *
+ * A range of rows can also be pinned before a chunk is resampled.
+ * Pinned rows are looked up in a flat table so the cache is not touched
+ * per pixel.  With a cache the table points at the cache's own buffers,
+ * which are pinned there so they aren't evicted during the chunk.
+ * Without one the rows are copied into slots owned by the InputRows and
+ * rows shared with the last range are not read again.
+ *
+ * MappedInputRows gives rows straight out of a MappedInput, so every
+ * row is effectively pinned and pinning only advises the OS.
+ *
+ * LockedInputRows is for a file and cache shared with other threads.
+ *
+ * SharedInputRows reads through a SharedRowCache shared with the other
+ * processes on the node.
+ **/
+
+#ifndef INPUTROWS_H_
+#define INPUTROWS_H_
+
+#include <new>
+#include <ace/Synch.h>
+#include "ImageLib/GeoTIFFImageIFile.h"
+#include "RowCache.h"
+#include "MappedInput.h"
+#include "SharedRowCache.h"
+
+
+class InputRows
+{
+ public:
+  /**
+   * Main constructor.  incache may be NULL in which case the rows are
+   * read from infile.  Neither the file or the cache are owned.
+   * inheight is the number of input rows and inpinbytes is the most
+   * rows (in bytes) that can be pinned (0 turns pinning off).  Only
+   * without a cache is that memory on top of the cache.
+   **/
+  InputRows(USGSImageLib::ImageIFile * ininfile,
+            RowCache * incache,
+            int inbps, long int inrowbytes, long int inheight,
+            long int inpinbytes = 0) throw(std::bad_alloc);
+
+  /**
+   * Destructor
+   **/
+  virtual ~InputRows();
+
+  /**
+   * getRow returns a pointer to input scanline y.  The pointer is only
+   * good until the next call with a different row.
+   **/
+  inline const unsigned char * getRow(long int y) throw();
+
+  /**
+   * getRowRange widens first and last to take in the rows that the
+   * in bounds coordinates of yarr (from a RowTransform) land on.
+   **/
+  void getRowRange(const double * yarr, long int count,
+                   long int & first, long int & last) const throw();
+
+  //The same for whole input row numbers (from projectRowIndices)
+  void getRowRange(const long int * yidx, long int count,
+                   long int & first, long int & last) const throw();
+
+  /**
+   * pinRows pins rows first to last, replacing any rows pinned before.
+   * Returns false (and pins nothing) if the rows won't fit in the pin
+   * memory, in which case getRow still works from the cache.
+   **/
+  virtual bool pinRows(long int first, long int last) throw();
+
+ protected:
+  //fetchRow gets a row from the cache or the file
+  virtual const unsigned char * fetchRow(long int y) throw();
+
+  //setCacheWindow tells the cache the rows being pinned
+  virtual void setCacheWindow(long int first, long int last) throw();
+
+  //pinCacheRows pins rows first to last in the cache and points the
+  //table at them.  unpinCacheRows lets go of the pinned range.
+  virtual bool pinCacheRows(long int first, long int last) throw();
+  virtual void unpinCacheRows() throw();
+
+  USGSImageLib::ImageIFile * infile;      //the input file
+  RowCache * cache;                       //the cache (can be NULL)
+  int bps;                                //bits per sample
+  unsigned char * rowbuffer;              //buffer when not cached
+  long int lasty;                         //last row fetched
+  const unsigned char * lastrow;          //pointer to last row
+  long int rowbytes;                      //bytes in a row
+  long int height;                        //number of rows
+
+  //pinned rows.  Without a cache row y lives in slot y % pincapacity.
+  long int pinbytes;                      //memory allowed for pinning
+  long int pincapacity;                   //most rows pinned
+  unsigned char * pinbuffer;              //the slots (no cache)
+  long int * slotrows;                    //row in each slot
+  const unsigned char ** pintable;        //pinned rows from pinfirst
+  long int pinfirst, pincount;            //the pinned range
+};
+
+
+class MappedInputRows : public InputRows
+{
+ public:
+  /**
+   * The mapped input is not owned and must be open.
+   **/
+  MappedInputRows(MappedInput * inmapped, long int inrowbytes)
+    throw(std::bad_alloc);
+  virtual ~MappedInputRows();
+
+  //pinRows advises the mapping that the rows are coming
+  virtual bool pinRows(long int first, long int last) throw();
+
+ protected:
+  virtual const unsigned char * fetchRow(long int y) throw();
+
+  MappedInput * mapped;                   //the mapped input
+};
+
+
+//LockedInputRows is InputRows for a thread.  Fetches from the shared
+//file and cache are done under the lock and copied out unless the rows
+//are pinned.
+class LockedInputRows : public InputRows
+{
+ public:
+  LockedInputRows(USGSImageLib::ImageIFile * ininfile,
+                  RowCache * incache,
+                  int inbps, long int inrowbytes, long int inheight,
+                  long int inpinbytes, ACE_Thread_Mutex & inlock)
+    throw(std::bad_alloc);
+  virtual ~LockedInputRows();
+
+ protected:
+  virtual const unsigned char * fetchRow(long int y) throw();
+  virtual void setCacheWindow(long int first, long int last) throw();
+  virtual bool pinCacheRows(long int first, long int last) throw();
+  virtual void unpinCacheRows() throw();
+
+  ACE_Thread_Mutex & lock;                //lock for the input
+  unsigned char * copybuffer;             //this thread's copy of a row
+};
+
+
+//SharedInputRows gets rows that aren't pinned from the shared cache.
+class SharedInputRows : public InputRows
+{
+ public:
+  /**
+   * The shared cache is not owned and must be open.
+   **/
+  SharedInputRows(SharedRowCache * inshared, long int inrowbytes,
+                  long int inheight, long int inpinbytes)
+    throw(std::bad_alloc);
+  virtual ~SharedInputRows();
+
+ protected:
+  virtual const unsigned char * fetchRow(long int y) throw();
+
+  SharedRowCache * shared;                //the shared cache
+};
+
+
+//inline functions
+
+//****************************************************************
+inline const unsigned char * InputRows::getRow(long int y) throw()
+{
+  //one unsigned compare checks both ends of the pinned range
+  if (static_cast<unsigned long int>(y - pinfirst) <
+      static_cast<unsigned long int>(pincount))
+    return pintable[y - pinfirst];
+
+  if (y != lasty)
+  {
+    lastrow = fetchRow(y);
+    lasty = y;
+  }
+  return lastrow;
+}
+
+#endif
@@ -0,0 +1,366 @@
+/**
+ * Implementation file for MappedInput
+ **/
+
+#ifndef MAPPEDINPUT_CPP_
+#define MAPPEDINPUT_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "MappedInput.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//The TIFF tags that matter
+#define MAPPED_TIFF_WIDTH        256
+#define MAPPED_TIFF_LENGTH       257
+#define MAPPED_TIFF_BPS          258
+#define MAPPED_TIFF_COMPRESSION  259
+#define MAPPED_TIFF_STRIPOFFSETS 273
+#define MAPPED_TIFF_SPP          277
+#define MAPPED_TIFF_ROWSPERSTRIP 278
+#define MAPPED_TIFF_PLANAR       284
+#define MAPPED_TIFF_TILEWIDTH    322
+
+//****************************************************************
+static unsigned long int getTIFFShort(const unsigned char * data,
+                                      bool bigendian) throw()
+{
+  if (bigendian)
+    return (static_cast<unsigned long int>(data[0]) << 8) | data[1];
+  return (static_cast<unsigned long int>(data[1]) << 8) | data[0];
+}
+
+//****************************************************************
+static unsigned long int getTIFFLong(const unsigned char * data,
+                                     bool bigendian) throw()
+{
+  if (bigendian)
+    return (getTIFFShort(data, true) << 16) | getTIFFShort(data + 2, true);
+  return (getTIFFShort(data + 2, false) << 16) | getTIFFShort(data, false);
+}
+
+//****************************************************************
+MappedInput::MappedInput() : map(NULL), mapsize(0), rowbytes(0),
+                             height(0), advisedfirst(0), advisedlast(-1)
+{}
+
+//****************************************************************
+MappedInput::~MappedInput()
+{
+  close();
+}
+
+//****************************************************************
+bool MappedInput::open(const std::string & filename, long int width,
+                       long int inheight, int spp, int bps) throw()
+{
+  struct stat info;
+  void * temp;
+  int fd;
+
+  close();
+
+  if ((width <= 0) || (inheight <= 0) || (spp <= 0) ||
+      ((bps != 8) && (bps != 16)))
+    return false;
+
+  if ((fd = ::open(filename.c_str(), O_RDONLY)) < 0)
+    return false;
+
+  if (fstat(fd, &info) || (info.st_size < 8))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  mapsize = info.st_size;
+  temp = mmap(NULL, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);                                //the map keeps the file
+  if (temp == MAP_FAILED)
+  {
+    mapsize = 0;
+    return false;
+  }
+
+  map = static_cast<unsigned char *>(temp);
+  rowbytes = width*spp*(bps/8);
+  height = inheight;
+
+  try
+  {
+    rows.resize(height);
+  }
+  catch(...)
+  {
+    close();
+    return false;
+  }
+
+  if ((((map[0] == 'I') && (map[1] == 'I')) ||
+       ((map[0] == 'M') && (map[1] == 'M'))) ? mapTIFF(width, spp, bps)
+      : mapDOQ(spp))
+    return true;
+
+  close();
+  return false;
+}
+
+//****************************************************************
+void MappedInput::close() throw()
+{
+  if (map)
+    munmap(map, mapsize);
+  map = NULL;
+  mapsize = 0;
+  rowbytes = 0;
+  height = 0;
+  rows.clear();
+  advisedfirst = 0;
+  advisedlast = -1;
+}
+
+//****************************************************************
+void MappedInput::adviseRows(long int first, long int last) throw()
+{
+  const long int pagesize = sysconf(_SC_PAGESIZE);
+  const unsigned char * start, * end;
+  long int counter;
+
+  if (first < 0)
+    first = 0;
+  if (last >= height)
+    last = height - 1;
+
+  //nothing new since the last time
+  if ((last < first) || ((first >= advisedfirst) && (last <= advisedlast)))
+    return;
+  advisedfirst = first;
+  advisedlast = last;
+
+  //strips don't have to be in order in the file
+  start = end = rows[first];
+  for (counter = first + 1; counter <= last; ++counter)
+  {
+    if (rows[counter] < start)
+      start = rows[counter];
+    if (rows[counter] > end)
+      end = rows[counter];
+  }
+  end += rowbytes;
+
+  //madvise wants a page aligned start
+  start = map + ((start - map)/pagesize)*pagesize;
+  madvise(const_cast<unsigned char *>(start), end - start, MADV_WILLNEED);
+}
+
+//****************************************************************
+long int MappedInput::getHeight() const throw()
+{
+  return height;
+}
+
+//****************************************************************
+bool MappedInput::mapTIFF(long int width, int spp, int bps) throw()
+{
+  const unsigned short int one = 1;
+  const bool bigendian = (map[0] == 'M');
+  const bool hostbigendian = !*reinterpret_cast<const unsigned char *>(&one);
+  std::vector<unsigned long int> values, offsets, bpsvalues;
+  unsigned long int ifd, entries, counter, rowsperstrip(0xffffffffUL);
+  unsigned long int tiffwidth(0), tiffheight(0), tiffspp(1);
+  unsigned long int compression(1), planar(1);
+  const unsigned char * entry;
+  long int y, stripbytes;
+
+  //16 bit samples have to be in this machine's order to use in place
+  if ((getTIFFShort(map + 2, bigendian) != 42) ||
+      ((bps == 16) && (bigendian != hostbigendian)))
+    return false;
+
+  ifd = getTIFFLong(map + 4, bigendian);
+  if ((ifd < 8) || (static_cast<long int>(ifd) + 2 > mapsize))
+    return false;
+  entries = getTIFFShort(map + ifd, bigendian);
+  if (static_cast<long int>(ifd + 2 + entries*12) > mapsize)
+    return false;
+
+  for (counter = 0; counter < entries; ++counter)
+  {
+    entry = map + ifd + 2 + counter*12;
+
+    switch (getTIFFShort(entry, bigendian))
+    {
+    case MAPPED_TIFF_TILEWIDTH:
+      return false;                           //tiled
+    case MAPPED_TIFF_STRIPOFFSETS:
+      if (!getTIFFValues(entry, bigendian, offsets))
+        return false;
+      continue;
+    case MAPPED_TIFF_BPS:
+      if (!getTIFFValues(entry, bigendian, bpsvalues))
+        return false;
+      continue;
+    case MAPPED_TIFF_WIDTH:
+    case MAPPED_TIFF_LENGTH:
+    case MAPPED_TIFF_COMPRESSION:
+    case MAPPED_TIFF_SPP:
+    case MAPPED_TIFF_ROWSPERSTRIP:
+    case MAPPED_TIFF_PLANAR:
+      if (!getTIFFValues(entry, bigendian, values) || (values.size() != 1))
+        return false;
+      break;
+    default:
+      continue;
+    }
+
+    switch (getTIFFShort(entry, bigendian))
+    {
+    case MAPPED_TIFF_WIDTH:
+      tiffwidth = values[0];
+      break;
+    case MAPPED_TIFF_LENGTH:
+      tiffheight = values[0];
+      break;
+    case MAPPED_TIFF_COMPRESSION:
+      compression = values[0];
+      break;
+    case MAPPED_TIFF_SPP:
+      tiffspp = values[0];
+      break;
+    case MAPPED_TIFF_ROWSPERSTRIP:
+      rowsperstrip = values[0];
+      break;
+    default:
+      planar = values[0];
+      break;
+    }
+  }
+
+  //it has to be what the library said it was and stored plainly
+  if ((tiffwidth != static_cast<unsigned long int>(width)) ||
+      (tiffheight != static_cast<unsigned long int>(height)) ||
+      (tiffspp != static_cast<unsigned long int>(spp)) ||
+      (compression != 1) || ((planar != 1) && (spp > 1)) ||
+      (bpsvalues.size() < 1) ||
+      (bpsvalues[0] != static_cast<unsigned long int>(bps)) ||
+      (rowsperstrip == 0))
+    return false;
+
+  if (rowsperstrip > static_cast<unsigned long int>(height))
+    rowsperstrip = height;
+  if (offsets.size() != (height + rowsperstrip - 1)/rowsperstrip)
+    return false;
+
+  for (counter = 0; counter < offsets.size(); ++counter)
+  {
+    //the last strip can be short
+    y = counter*rowsperstrip;
+    stripbytes = ((height - y < static_cast<long int>(rowsperstrip))
+                  ? height - y : static_cast<long int>(rowsperstrip))
+      *rowbytes;
+    if ((stripbytes > mapsize) || (offsets[counter] >
+                                   static_cast<unsigned long int>
+                                   (mapsize - stripbytes)))
+      return false;
+  }
+
+  for (y = 0; y < height; ++y)
+    rows[y] = map + offsets[y/rowsperstrip] + (y % rowsperstrip)*rowbytes;
+
+  return true;
+}
+
+//****************************************************************
+bool MappedInput::mapDOQ(int spp) throw()
+{
+  const long int databytes = height*rowbytes;
+  std::string header;
+  std::string::size_type position;
+  long int y;
+
+  //the header is padded out to whole rows with the image after it
+  if ((mapsize < databytes) || ((mapsize - databytes) % rowbytes))
+    return false;
+
+  try
+  {
+    header.assign(reinterpret_cast<const char *>(map), mapsize - databytes);
+  }
+  catch(...)
+  {
+    return false;
+  }
+
+  if (header.compare(0, 21, "BEGIN_USGS_DOQ_HEADER") ||
+      (header.find("END_USGS_HEADER") == std::string::npos))
+    return false;
+
+  //the library gives pixels with their bands together
+  if (spp > 1)
+  {
+    if ((position = header.find("BAND_ORGANIZATION")) == std::string::npos)
+      return false;
+    position = header.find_first_not_of(' ', position + 17);
+    if ((position == std::string::npos) || header.compare(position, 3, "BIP"))
+      return false;
+  }
+
+  for (y = 0; y < height; ++y)
+    rows[y] = map + (mapsize - databytes) + y*rowbytes;
+
+  return true;
+}
+
+//****************************************************************
+bool MappedInput::getTIFFValues(const unsigned char * entry,
+                                bool bigendian,
+                                std::vector<unsigned long int> & values)
+  const throw()
+{
+  const unsigned long int type = getTIFFShort(entry + 2, bigendian);
+  const unsigned long int count = getTIFFLong(entry + 4, bigendian);
+  const unsigned long int size = (type == 3) ? 2 : 4;
+  const unsigned char * data;
+  unsigned long int counter;
+
+  //SHORT or LONG only
+  if (((type != 3) && (type != 4)) || !count ||
+      (count > static_cast<unsigned long int>(mapsize)/size))
+    return false;
+
+  //small enough values are in the entry itself
+  if (count*size <= 4)
+    data = entry + 8;
+  else
+  {
+    data = map + getTIFFLong(entry + 8, bigendian);
+    if (getTIFFLong(entry + 8, bigendian) + count*size
+        > static_cast<unsigned long int>(mapsize))
+      return false;
+  }
+
+  try
+  {
+    values.resize(count);
+  }
+  catch(...)
+  {
+    return false;
+  }
+
+  for (counter = 0; counter < count; ++counter)
+    values[counter] = (size == 2) ? getTIFFShort(data + counter*size,
+                                                 bigendian)
+      : getTIFFLong(data + counter*size, bigendian);
+
+  return true;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * MappedInput memory maps an uncompressed input image so its rows can
+ * be used in place instead of being read and copied into a cache.  The
+ * OS page cache holds the rows and co-located processes mapping the
+ * same file share it.
+ *
+ * Only images whose rows are stored whole and as the library would
+ * return them can be mapped: strip organized, uncompressed,
+ * interleaved (chunky) TIFFs in the byte order of this machine and
+ * DOQs with band interleaved by pixel data.  open() is false for
+ * anything else and the image has to be read through the library.
+ **/
+
+#ifndef MAPPEDINPUT_H_
+#define MAPPEDINPUT_H_
+
+#include <string>
+#include <vector>
+
+
+class MappedInput
+{
+ public:
+  /**
+   * Constructor and Destructor
+   **/
+  MappedInput();
+  ~MappedInput();
+
+  /**
+   * open maps filename, which the library says is a width by height
+   * image with spp samples of bps bits.  Returns false (and maps
+   * nothing) if it can't be mapped.
+   **/
+  bool open(const std::string & filename, long int width, long int height,
+            int spp, int bps) throw();
+
+  /**
+   * close unmaps the image.
+   **/
+  void close() throw();
+
+  /**
+   * getRow returns a pointer to row y in the map.  It stays good until
+   * the image is closed.
+   **/
+  inline const unsigned char * getRow(long int y) const throw();
+
+  /**
+   * adviseRows tells the OS rows first to last are about to be used
+   * so it can start reading them in.
+   **/
+  void adviseRows(long int first, long int last) throw();
+
+  /**
+   * getHeight returns the number of rows mapped.
+   **/
+  long int getHeight() const throw();
+
+ protected:
+  //mapTIFF and mapDOQ find the rows of a TIFF or DOQ in the map
+  bool mapTIFF(long int width, int spp, int bps) throw();
+  bool mapDOQ(int spp) throw();
+
+  //getTIFFValues reads the values of a SHORT or LONG TIFF tag entry
+  bool getTIFFValues(const unsigned char * entry, bool bigendian,
+                     std::vector<unsigned long int> & values) const throw();
+
+  unsigned char * map;                   //the mapped file
+  long int mapsize;                      //bytes mapped
+  long int rowbytes;                     //bytes in a row
+  long int height;                       //rows in the image
+  std::vector<const unsigned char *> rows; //where each row starts
+  long int advisedfirst, advisedlast;    //rows last advised
+};
+
+
+//inline functions
+
+//****************************************************************
+inline const unsigned char * MappedInput::getRow(long int y) const throw()
+{
+  return rows[y];
+}
+
+#endif
@@ -0,0 +1,498 @@
+/**
+ * Implementation file for MeshGrid
+ **/
+
+#ifndef MESHGRID_CPP_
+#define MESHGRID_CPP_
+
+#include "MeshGrid.h"
+#include "RowTransform.h"
+#include <cmath>
+
+#if !defined(PROJECTOR_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MESHGRID_SIMD
+#include <immintrin.h>
+#endif
+
+//****************************************************************
+static void scalarSpan(double ax, double bx, double ay, double by,
+                       long int first, double scale, long int count,
+                       double * xarr, double * yarr)
+{
+  long int counter;
+  double u;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    u = (first + counter)*scale;
+    xarr[counter] = ax + bx*u;
+    yarr[counter] = ay + by*u;
+  }
+}
+
+#ifdef MESHGRID_SIMD
+
+#pragma GCC push_options
+#pragma GCC target("sse2")
+
+//****************************************************************
+static void sse2Span(double ax, double bx, double ay, double by,
+                     long int first, double scale, long int count,
+                     double * xarr, double * yarr)
+{
+  const __m128d vax = _mm_set1_pd(ax), vbx = _mm_set1_pd(bx);
+  const __m128d vay = _mm_set1_pd(ay), vby = _mm_set1_pd(by);
+  const __m128d vscale = _mm_set1_pd(scale), step = _mm_set1_pd(2.0);
+  //the pixel numbers are whole so stepping them is exact
+  __m128d vx = _mm_setr_pd(static_cast<double>(first),
+                           static_cast<double>(first + 1));
+  __m128d u;
+  long int counter(0);
+
+  for (; counter + 2 <= count; counter += 2)
+  {
+    u = _mm_mul_pd(vx, vscale);
+    _mm_storeu_pd(xarr + counter, _mm_add_pd(vax, _mm_mul_pd(vbx, u)));
+    _mm_storeu_pd(yarr + counter, _mm_add_pd(vay, _mm_mul_pd(vby, u)));
+    vx = _mm_add_pd(vx, step);
+  }
+
+  scalarSpan(ax, bx, ay, by, first + counter, scale, count - counter,
+             xarr + counter, yarr + counter);
+}
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx")
+
+//****************************************************************
+static void avxSpan(double ax, double bx, double ay, double by,
+                    long int first, double scale, long int count,
+                    double * xarr, double * yarr)
+{
+  const __m256d vax = _mm256_set1_pd(ax), vbx = _mm256_set1_pd(bx);
+  const __m256d vay = _mm256_set1_pd(ay), vby = _mm256_set1_pd(by);
+  const __m256d vscale = _mm256_set1_pd(scale);
+  const __m256d step = _mm256_set1_pd(4.0);
+  __m256d vx = _mm256_setr_pd(static_cast<double>(first),
+                              static_cast<double>(first + 1),
+                              static_cast<double>(first + 2),
+                              static_cast<double>(first + 3));
+  __m256d u;
+  long int counter(0);
+
+  for (; counter + 4 <= count; counter += 4)
+  {
+    u = _mm256_mul_pd(vx, vscale);
+    _mm256_storeu_pd(xarr + counter,
+                     _mm256_add_pd(vax, _mm256_mul_pd(vbx, u)));
+    _mm256_storeu_pd(yarr + counter,
+                     _mm256_add_pd(vay, _mm256_mul_pd(vby, u)));
+    vx = _mm256_add_pd(vx, step);
+  }
+
+  scalarSpan(ax, bx, ay, by, first + counter, scale, count - counter,
+             xarr + counter, yarr + counter);
+}
+
+#pragma GCC pop_options
+
+#endif
+
+//****************************************************************
+MeshSpanFunc getMeshSpanFunc() throw()
+{
+#ifdef MESHGRID_SIMD
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx"))
+    return &avxSpan;
+
+  if (__builtin_cpu_supports("sse2"))
+    return &sse2Span;
+#endif
+
+  return &scalarSpan;
+}
+
+//****************************************************************
+MeshGrid::MeshGrid() : newwidth(0), newheight(0), cellsize(0), cellsx(0),
+                       cellsy(0), tolerance(0.0), nodes(0), leaves(0),
+                       maxerror(0.0), spanfunc(getMeshSpanFunc())
+{}
+
+//****************************************************************
+MeshGrid::~MeshGrid()
+{}
+
+//****************************************************************
+void MeshGrid::calculate(RowTransform & exact, long int innewwidth,
+                         long int innewheight, double intolerance)
+  throw(std::bad_alloc)
+{
+  std::vector<double> nodex, nodey;        //the top grid nodes
+  MeshCell cell;                           //a top cell
+  long int x, y, largest;
+
+  newwidth = innewwidth;
+  newheight = innewheight;
+  tolerance = intolerance;
+  nodes = leaves = 0;
+  maxerror = 0.0;
+  cells.clear();
+
+  if ((newwidth <= 0) || (newheight <= 0))
+    return;
+
+  //the top cells are a power of two so the children always land on
+  //whole pixels
+  largest = (newwidth > newheight) ? newwidth : newheight;
+  for (cellsize = MESHGRID_MINCELL; cellsize*MESHGRID_START < largest;
+       cellsize *= 2);
+  cellsx = (newwidth + cellsize - 1)/cellsize;
+  cellsy = (newheight + cellsize - 1)/cellsize;
+
+  //project the nodes of the top grid
+  nodex.resize((cellsx + 1)*(cellsy + 1));
+  nodey.resize((cellsx + 1)*(cellsy + 1));
+  for (y = 0; y <= cellsy; ++y)
+  {
+    for (x = 0; x <= cellsx; ++x)
+      exact.projectRow(y*cellsize, x*cellsize, 1,
+                       &(nodex[y*(cellsx + 1) + x]),
+                       &(nodey[y*(cellsx + 1) + x]));
+  }
+  nodes = (cellsx + 1)*(cellsy + 1);
+
+  cells.reserve(cellsx*cellsy*4);
+  for (y = 0; y < cellsy; ++y)
+  {
+    for (x = 0; x < cellsx; ++x)
+    {
+      cell.x[0] = nodex[y*(cellsx + 1) + x];
+      cell.y[0] = nodey[y*(cellsx + 1) + x];
+      cell.x[1] = nodex[y*(cellsx + 1) + x + 1];
+      cell.y[1] = nodey[y*(cellsx + 1) + x + 1];
+      cell.x[2] = nodex[(y + 1)*(cellsx + 1) + x];
+      cell.y[2] = nodey[(y + 1)*(cellsx + 1) + x];
+      cell.x[3] = nodex[(y + 1)*(cellsx + 1) + x + 1];
+      cell.y[3] = nodey[(y + 1)*(cellsx + 1) + x + 1];
+      cell.child = -1;
+      cells.push_back(cell);
+    }
+  }
+
+  for (y = 0; y < cellsy; ++y)
+  {
+    for (x = 0; x < cellsx; ++x)
+      refine(exact, y*cellsx + x, x*cellsize, y*cellsize, cellsize);
+  }
+}
+
+//****************************************************************
+void MeshGrid::refine(RowTransform & exact, long int index, long int x0,
+                      long int y0, long int size) throw(std::bad_alloc)
+{
+  const long int half = size/2;
+  //top, left, center, right and bottom of the cell
+  const long int px[5] = {x0 + half, x0, x0 + half, x0 + size, x0 + half};
+  const long int py[5] = {y0, y0 + half, y0 + half, y0 + half, y0 + size};
+  const MeshCell cell = cells[index];      //copied, cells can move
+  double mx[5], my[5];                     //the exact points
+  double ix[5], iy[5];                     //the interpolated points
+  double gridx[9], gridy[9];               //3x3 points for the children
+  double err(0.0), errx, erry;
+  bool finite(true);
+  MeshCell child;
+  long int counter, first;
+
+  for (counter = 0; counter < 5; ++counter)
+    exact.projectRow(py[counter], px[counter], 1,
+                     &(mx[counter]), &(my[counter]));
+  nodes += 5;
+
+  ix[0] = (cell.x[0] + cell.x[1])*0.5;
+  iy[0] = (cell.y[0] + cell.y[1])*0.5;
+  ix[1] = (cell.x[0] + cell.x[2])*0.5;
+  iy[1] = (cell.y[0] + cell.y[2])*0.5;
+  ix[2] = (cell.x[0] + cell.x[1] + cell.x[2] + cell.x[3])*0.25;
+  iy[2] = (cell.y[0] + cell.y[1] + cell.y[2] + cell.y[3])*0.25;
+  ix[3] = (cell.x[1] + cell.x[3])*0.5;
+  iy[3] = (cell.y[1] + cell.y[3])*0.5;
+  ix[4] = (cell.x[2] + cell.x[3])*0.5;
+  iy[4] = (cell.y[2] + cell.y[3])*0.5;
+
+  for (counter = 0; counter < 5; ++counter)
+  {
+    errx = std::fabs(mx[counter] - ix[counter]);
+    erry = std::fabs(my[counter] - iy[counter]);
+    if (!(errx < 1e9) || !(erry < 1e9))
+      finite = false;                      //off the projection
+    else
+    {
+      if (errx > err)
+        err = errx;
+      if (erry > err)
+        err = erry;
+    }
+  }
+
+  //good enough or can't be split any more
+  if ((finite && (err <= tolerance)) || (size <= MESHGRID_MINCELL) ||
+      (static_cast<long int>(cells.size()) + 4 > MESHGRID_MAXCELLS))
+  {
+    ++leaves;
+    if (finite && (err > maxerror))
+      maxerror = err;
+    return;
+  }
+
+  //the corners, side middles and center make up the children
+  gridx[0] = cell.x[0]; gridy[0] = cell.y[0];
+  gridx[1] = mx[0];     gridy[1] = my[0];
+  gridx[2] = cell.x[1]; gridy[2] = cell.y[1];
+  gridx[3] = mx[1];     gridy[3] = my[1];
+  gridx[4] = mx[2];     gridy[4] = my[2];
+  gridx[5] = mx[3];     gridy[5] = my[3];
+  gridx[6] = cell.x[2]; gridy[6] = cell.y[2];
+  gridx[7] = mx[4];     gridy[7] = my[4];
+  gridx[8] = cell.x[3]; gridy[8] = cell.y[3];
+
+  first = cells.size();
+  child.child = -1;
+  for (counter = 0; counter < 4; ++counter)
+  {
+    //top left point of the child in the 3x3 grid
+    const long int corner = (counter & 1) + 3*(counter >> 1);
+
+    child.x[0] = gridx[corner];
+    child.y[0] = gridy[corner];
+    child.x[1] = gridx[corner + 1];
+    child.y[1] = gridy[corner + 1];
+    child.x[2] = gridx[corner + 3];
+    child.y[2] = gridy[corner + 3];
+    child.x[3] = gridx[corner + 4];
+    child.y[3] = gridy[corner + 4];
+    cells.push_back(child);
+  }
+  cells[index].child = first;
+
+  for (counter = 0; counter < 4; ++counter)
+    refine(exact, first + counter, x0 + (counter & 1)*half,
+           y0 + (counter >> 1)*half, half);
+}
+
+//****************************************************************
+long int MeshGrid::findCell(long int x, long int y, long int & x0,
+                            long int & y0, long int & size) const throw()
+{
+  long int index;
+
+  size = cellsize;
+  x0 = (x/cellsize)*cellsize;
+  y0 = (y/cellsize)*cellsize;
+  index = (y/cellsize)*cellsx + x/cellsize;
+
+  //walk down to the leaf
+  while (cells[index].child >= 0)
+  {
+    size /= 2;
+    index = cells[index].child;
+    if (x >= x0 + size)
+    {
+      x0 += size;
+      index += 1;
+    }
+    if (y >= y0 + size)
+    {
+      y0 += size;
+      index += 2;
+    }
+  }
+
+  return index;
+}
+
+//****************************************************************
+void MeshGrid::projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) const throw()
+{
+  long int x(startx), end(startx + count), stop;
+  long int x0, y0, size, index;
+  double v, scale;                         //position in the cell
+  double ax, bx, ay, by;                   //the row through the cell
+
+  while (x < end)
+  {
+    index = findCell(x, ycounter, x0, y0, size);
+    const MeshCell & cell = cells[index];
+
+    //along a row the bilinear interpolation is linear
+    scale = 1.0/size;
+    v = (ycounter - y0)*scale;
+    ax = cell.x[0] + (cell.x[2] - cell.x[0])*v;
+    bx = cell.x[1] + (cell.x[3] - cell.x[1])*v - ax;
+    ay = cell.y[0] + (cell.y[2] - cell.y[0])*v;
+    by = cell.y[1] + (cell.y[3] - cell.y[1])*v - ay;
+
+    stop = (x0 + size < end) ? x0 + size : end;
+    spanfunc(ax, bx, ay, by, x - x0, scale, stop - x, xarr, yarr);
+    xarr += stop - x;
+    yarr += stop - x;
+    x = stop;
+  }
+}
+
+//****************************************************************
+void MeshGrid::projectRowIndices(long int ycounter, long int startx,
+                                 long int count, long int * xidx,
+                                 long int * yidx) const throw()
+{
+  long int x(startx), end(startx + count), stop;
+  long int x0, y0, size, index;
+  double v, scale;                         //position in the cell
+  double ax, bx, ay, by;                   //the row through the cell
+
+  while (x < end)
+  {
+    index = findCell(x, ycounter, x0, y0, size);
+    const MeshCell & cell = cells[index];
+
+    scale = 1.0/size;
+    v = (ycounter - y0)*scale;
+    ax = cell.x[0] + (cell.x[2] - cell.x[0])*v;
+    bx = cell.x[1] + (cell.x[3] - cell.x[1])*v - ax;
+    ay = cell.y[0] + (cell.y[2] - cell.y[0])*v;
+    by = cell.y[1] + (cell.y[3] - cell.y[1])*v - ay;
+
+    stop = (x0 + size < end) ? x0 + size : end;
+    fixedSpan(ax, bx, x - x0, scale, stop - x, xidx);
+    fixedSpan(ay, by, x - x0, scale, stop - x, yidx);
+    xidx += stop - x;
+    yidx += stop - x;
+    x = stop;
+  }
+}
+
+//****************************************************************
+void MeshGrid::fixedSpan(double a, double b, long int first, double scale,
+                         long int count, long int * idx) const throw()
+{
+  const double one = 4294967296.0;         //1.0 in 32.32
+  //the ends of the span rounded to the nearest pixel
+  const double start = a + b*(first*scale) + 0.5;
+  const double stop = a + b*((first + count - 1)*scale) + 0.5;
+  long long int fixed, step;
+  long int counter;
+  double t;
+
+  if ((std::fabs(start) < MESHGRID_FIXEDLIMIT) &&
+      (std::fabs(stop) < MESHGRID_FIXEDLIMIT))
+  {
+    fixed = static_cast<long long int>(std::floor(start*one));
+    step = static_cast<long long int>(std::floor(b*scale*one + 0.5));
+
+    //gcc shifts signed values arithmetically so this is the floor
+    for (counter = 0; counter < count; ++counter, fixed += step)
+      idx[counter] = static_cast<long int>(fixed >> 32);
+    return;
+  }
+
+  //too far out (or not a number), do it the slow way
+  for (counter = 0; counter < count; ++counter)
+  {
+    t = a + b*((first + counter)*scale) + 0.5;
+    if ((t >= 0.0) && (t < MESHGRID_FIXEDLIMIT))
+      idx[counter] = static_cast<long int>(t);
+    else
+      idx[counter] = -1;
+  }
+}
+
+//****************************************************************
+long int MeshGrid::getNodeCount() const throw()
+{
+  return nodes;
+}
+
+//****************************************************************
+long int MeshGrid::getCellCount() const throw()
+{
+  return leaves;
+}
+
+//****************************************************************
+double MeshGrid::getMaxError() const throw()
+{
+  return maxerror;
+}
+
+//****************************************************************
+long int MeshGrid::getCellTotal() const throw()
+{
+  return cells.size();
+}
+
+//****************************************************************
+void MeshGrid::save(long int * info, double * coords,
+                    long int * children) const throw()
+{
+  long int counter;
+  int corner;
+
+  info[0] = newwidth;
+  info[1] = newheight;
+  info[2] = cellsize;
+  info[3] = cellsx;
+  info[4] = cellsy;
+  info[5] = cells.size();
+  info[6] = nodes;
+  info[7] = leaves;
+
+  for (counter = 0; counter < static_cast<long int>(cells.size());
+       ++counter)
+  {
+    for (corner = 0; corner < 4; ++corner)
+    {
+      coords[8*counter + corner] = cells[counter].x[corner];
+      coords[8*counter + 4 + corner] = cells[counter].y[corner];
+    }
+    children[counter] = cells[counter].child;
+  }
+}
+
+//****************************************************************
+void MeshGrid::load(const long int * info, const double * coords,
+                    const long int * children) throw(std::bad_alloc)
+{
+  MeshCell cell;
+  long int counter;
+  int corner;
+
+  newwidth = info[0];
+  newheight = info[1];
+  cellsize = info[2];
+  cellsx = info[3];
+  cellsy = info[4];
+  nodes = info[6];
+  leaves = info[7];
+  maxerror = 0.0;                          //not known here
+
+  cells.clear();
+  cells.reserve(info[5]);
+  for (counter = 0; counter < info[5]; ++counter)
+  {
+    for (corner = 0; corner < 4; ++corner)
+    {
+      cell.x[corner] = coords[8*counter + corner];
+      cell.y[corner] = coords[8*counter + 4 + corner];
+    }
+    cell.child = children[counter];
+    cells.push_back(cell);
+  }
+}
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * MeshGrid is an adaptive interpolation mesh from output pixels to
+ * input pixels.  It starts as a coarse grid of square cells and splits
+ * any cell where bilinear interpolation of its corners is more than the
+ * tolerance (in input pixels) off from the true transform at the cell
+ * center or the middle of its sides.  Unlike a uniform mesh the size
+ * doesn't have to be guessed; cells only get small where the transform
+ * bends.
+ *
+ * Rows are interpolated a span at a time.  The leaf cell is found once
+ * for each span of the row that crosses it and the pixels in the span
+ * are done by a SIMD span function when the cpu has one (see
+ * getMeshSpanFunc; PROJECTOR_NO_SIMD leaves them out).
+ *
+ * projectRowIndices steps through each span in 32.32 fixed point
+ * instead, giving whole input pixels with integer adds and shifts.
+ * The start and step of a span are rounded to 2^-32 pixels so the
+ * coordinate of the n'th pixel of a span is off by at most
+ * (n + 1)*2^-32 input pixels from projectRow's.  Spans are no longer
+ * than a top cell (at most 1/8 of the image) so that is under 2^-14
+ * pixels for images up to a million pixels across.  Only coordinates
+ * that close to the middle of a pixel can round to the neighbour.
+ * Coordinates in the half pixel just off the top or left edge of the
+ * input are out of bounds here, where the double kernels round them
+ * onto the edge pixel.
+ **/
+
+#ifndef MESHGRID_H_
+#define MESHGRID_H_
+
+#include <new>
+#include <vector>
+
+//Cells across the larger side of the image to start with
+#define MESHGRID_START 16
+
+//Cells are not split below this size (in output pixels)
+#define MESHGRID_MINCELL 2
+
+//Most cells a mesh can have before splitting stops
+#define MESHGRID_MAXCELLS 1048576L
+
+//Number of longs in the info from save
+#define MESHGRID_INFO 8
+
+//Spans with coordinates past this (in input pixels) are too big for
+//the fixed point stepping and are rounded a pixel at a time
+#define MESHGRID_FIXEDLIMIT 1073741824.0
+
+class RowTransform;
+
+//MeshSpanFunc fills count pixels of a span through one cell.  Pixel
+//counter is at (first + counter)*scale across the cell and the row
+//through the cell is ax + bx*u, ay + by*u.
+typedef void (*MeshSpanFunc)(double ax, double bx, double ay, double by,
+                             long int first, double scale, long int count,
+                             double * xarr, double * yarr);
+
+//getMeshSpanFunc returns the best span function for the cpu.  They all
+//give the same results.
+MeshSpanFunc getMeshSpanFunc() throw();
+
+
+//One cell of the mesh.  The corners are top left, top right, bottom
+//left and bottom right in input pixels.
+struct MeshCell
+{
+  double x[4], y[4];                     //input pixel of each corner
+  long int child;                        //first of 4 children or -1
+};
+
+
+class MeshGrid
+{
+ public:
+  /**
+   * Constructor and Destructor
+   **/
+  MeshGrid();
+  ~MeshGrid();
+
+  /**
+   * calculate builds the mesh over a newwidth by newheight output image
+   * sampling exact (which should be an exact transform).  tolerance is
+   * the error allowed in input pixels.
+   **/
+  void calculate(RowTransform & exact, long int innewwidth,
+                 long int innewheight, double intolerance)
+    throw(std::bad_alloc);
+
+  /**
+   * projectRow interpolates count output pixels starting at startx on
+   * output row ycounter, which must be inside the image.
+   **/
+  void projectRow(long int ycounter, long int startx, long int count,
+                  double * xarr, double * yarr) const throw();
+
+  /**
+   * projectRowIndices is projectRow rounded to whole input pixels with
+   * fixed point stepping (see above).  Pixels that round off the input
+   * get -1 or an index past the edge.
+   **/
+  void projectRowIndices(long int ycounter, long int startx,
+                         long int count, long int * xidx,
+                         long int * yidx) const throw();
+
+  /**
+   * getNodeCount returns the number of points that were projected to
+   * build the mesh and getCellCount the number of cells that are used
+   * for interpolation.
+   **/
+  long int getNodeCount() const throw();
+  long int getCellCount() const throw();
+
+  /**
+   * getMaxError returns the largest error (in input pixels) that was
+   * measured in the cells that were kept.  Cells at the smallest size
+   * can be over the tolerance.
+   **/
+  double getMaxError() const throw();
+
+  /**
+   * save and load give and take the whole mesh as flat arrays so it
+   * can be sent to another process.  info holds MESHGRID_INFO longs,
+   * coords 8 doubles per cell (the corner x's then y's) and children
+   * one long per cell.  getCellTotal is the number of cells.
+   **/
+  long int getCellTotal() const throw();
+  void save(long int * info, double * coords,
+            long int * children) const throw();
+  void load(const long int * info, const double * coords,
+            const long int * children) throw(std::bad_alloc);
+
+ protected:
+  //refine checks a cell against the transform and splits it if needed
+  void refine(RowTransform & exact, long int index, long int x0,
+              long int y0, long int size) throw(std::bad_alloc);
+
+  //fixedSpan fills count indices of one coordinate of a span
+  void fixedSpan(double a, double b, long int first, double scale,
+                 long int count, long int * idx) const throw();
+
+  //findCell returns the leaf cell that holds output pixel x, y and sets
+  //x0, y0 and size to where it is
+  long int findCell(long int x, long int y, long int & x0, long int & y0,
+                    long int & size) const throw();
+
+  std::vector<MeshCell> cells;           //top cells then the children
+  long int newwidth, newheight;          //output image size
+  long int cellsize;                     //size of the top cells
+  long int cellsx, cellsy;               //number of top cells
+  double tolerance;                      //allowed error
+  long int nodes;                        //points projected
+  long int leaves;                       //cells used
+  double maxerror;                       //largest error kept
+  MeshSpanFunc spanfunc;                 //fills the spans of a row
+};
+
+#endif
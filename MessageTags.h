@@ -6,6 +6,8 @@
 #define SETUP_MSG 2
 #define EXIT_MSG  3
 #define ERROR_MSG 4
+#define MESH_MSG  5
+#define STATS_MSG 6
 
 
 #endif
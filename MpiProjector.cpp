@@ -8,13 +8,14 @@
 #include <cmath>
 
 //*******************************************************************
-MpiProjector::MpiProjector() : Projector(),
+MpiProjector::MpiProjector() : ParallelProjector(),
                                numofslaves(0),
                                evenchunks(false),slavelocal(false), 
                                sequencemethod(0),
                                minchunk(0), maxchunk(0),
                                sequence(0), sequencesize(0),
-                               slavelocalpath("./"), stitcher(false)
+                               slavelocalpath("./"), stitcher(false),
+                               statspending(0)
 {}
 
 //*******************************************************************
@@ -93,7 +94,7 @@ void MpiProjector::project(BaseProgress * progress)
   {
     if (!numofslaves)                            //must have a slave pvmproject
     {
-      Projector::project(progress);
+      ParallelProjector::project(progress);
       return;
     }
     
@@ -123,6 +124,21 @@ void MpiProjector::project(BaseProgress * progress)
       pmesh = NULL;
     }
 
+    //build the adaptive mesh once here and send it to the slaves,
+    //unless there is a plan (which the master has to save)
+    if (!openWarpPlan())
+    {
+      setupShiftGrid();
+      setupMeshGrid();
+      if (!plandir.empty())
+      {
+        pmesh = setupReversePmesh();
+        buildWarpPlan(pmesh, NULL);
+        delete pmesh;
+        pmesh = NULL;
+      }
+    }
+
     //check the rank in MPI
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
@@ -176,13 +192,13 @@ bool MpiProjector::sendSlaveSetup(int rank) throw()
   try
   {
     //calculate the buffersize
-    MPI_Pack_size(200, MPI_CHAR, MPI_COMM_WORLD, &tempsize);
+    MPI_Pack_size(300, MPI_CHAR, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
     MPI_Pack_size(2, MPI_LONG, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
-    MPI_Pack_size(23, MPI_DOUBLE, MPI_COMM_WORLD, &tempsize);
+    MPI_Pack_size(24, MPI_DOUBLE, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
-    MPI_Pack_size(8, MPI_INT, MPI_COMM_WORLD, &tempsize);
+    MPI_Pack_size(14, MPI_INT, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
     
     if (!(buf = new (std::nothrow) unsigned char[bufsize]))
@@ -234,6 +250,29 @@ bool MpiProjector::sendSlaveSetup(int rank) throw()
             buf, bufsize, &position, MPI_COMM_WORLD);
     MPI_Pack(&pmeshname, 1, MPI_INT,
             buf, bufsize, &position, MPI_COMM_WORLD);
+    MPI_Pack(&maxerror, 1, MPI_DOUBLE,
+            buf, bufsize, &position, MPI_COMM_WORLD);
+    MPI_Pack(&tilesize, 1, MPI_INT,
+            buf, bufsize, &position, MPI_COMM_WORLD);
+    temp = fixedpoint ? 1 : 0;
+    MPI_Pack(&temp, 1, MPI_INT,
+            buf, bufsize, &position, MPI_COMM_WORLD);
+    temp = shiftdatums ? 1 : 0;
+    MPI_Pack(&temp, 1, MPI_INT,
+            buf, bufsize, &position, MPI_COMM_WORLD);
+    temp = (meshgrid && !warpplan) ? 1 : 0;        //mesh sent after this
+    MPI_Pack(&temp, 1, MPI_INT,
+            buf, bufsize, &position, MPI_COMM_WORLD);
+    strcpy(tempbuffer, warpplan ? plandir.c_str() : "");
+    MPI_Pack(tempbuffer, 100, MPI_CHAR,
+             buf, bufsize, &position, MPI_COMM_WORLD);
+
+    //pack the cache settings
+    temp = cachesize;
+    MPI_Pack(&temp, 1, MPI_INT,
+            buf, bufsize, &position, MPI_COMM_WORLD);
+    MPI_Pack(&cachepolicy, 1, MPI_INT,
+            buf, bufsize, &position, MPI_COMM_WORLD);
     
     //pack the projection parameters
     MPI_Pack(reinterpret_cast<int *>(&Params.projtype), 1, MPI_INT,
@@ -305,6 +344,9 @@ bool MpiProjector::sendSlaveSetup(int rank) throw()
 
     delete [] buf;
 
+    if (meshgrid && !warpplan)
+      return sendSlaveMesh(rank);
+
     return true;
   }
   catch(...)
@@ -315,6 +357,59 @@ bool MpiProjector::sendSlaveSetup(int rank) throw()
   }
 }
 
+//********************************************************************
+bool MpiProjector::sendSlaveMesh(int rank) throw()
+{
+  long int info[MESHGRID_INFO];          //the mesh metrics
+  double * coords(0);                    //the cell corners
+  long int * children(0);                //the cell children
+  unsigned char * buf(0);
+  int bufsize(0), tempsize(0);
+  int position(0);
+  long int cells(meshgrid->getCellTotal());
+
+  try
+  {
+    if (!(coords = new (std::nothrow) double[8*cells + 1]))
+      throw std::bad_alloc();
+    if (!(children = new (std::nothrow) long int[cells + 1]))
+      throw std::bad_alloc();
+    meshgrid->save(info, coords, children);
+
+    //calculate the buffersize
+    MPI_Pack_size(MESHGRID_INFO + cells, MPI_LONG, MPI_COMM_WORLD,
+                  &tempsize);
+    bufsize += tempsize;
+    MPI_Pack_size(8*cells, MPI_DOUBLE, MPI_COMM_WORLD, &tempsize);
+    bufsize += tempsize;
+
+    if (!(buf = new (std::nothrow) unsigned char[bufsize]))
+      throw std::bad_alloc();
+
+    MPI_Pack(info, MESHGRID_INFO, MPI_LONG,
+             buf, bufsize, &position, MPI_COMM_WORLD);
+    MPI_Pack(coords, 8*cells, MPI_DOUBLE,
+             buf, bufsize, &position, MPI_COMM_WORLD);
+    MPI_Pack(children, cells, MPI_LONG,
+             buf, bufsize, &position, MPI_COMM_WORLD);
+
+    MPI_Send(buf, position, MPI_PACKED, rank,
+             MESH_MSG, MPI_COMM_WORLD);
+
+    delete [] buf;
+    delete [] coords;
+    delete [] children;
+    return true;
+  }
+  catch(...)
+  {
+    delete [] buf;
+    delete [] coords;
+    delete [] children;
+    return false;
+  }
+}
+
 //*******************************************************
 bool MpiProjector::projectslavelocal(BaseProgress * progress)
   throw(ProjectorException)
@@ -541,6 +636,121 @@ bool MpiProjector::projectslavelocal(BaseProgress * progress)
   */
 }
 
+//*******************************************************
+void MpiProjector::addSlaveStats(unsigned char * buffer, int buffersize)
+  throw()
+{
+  RowCacheStats stats;                  //the slave's counts
+  long int counts[3];                   //as they were sent
+  int position(0);
+
+  MPI_Unpack(buffer, buffersize, &position, counts, 3, MPI_LONG,
+             MPI_COMM_WORLD);
+  stats.hits = counts[0];
+  stats.misses = counts[1];
+  stats.evictions = counts[2];
+  cachestats.add(stats);
+}
+
+//*******************************************************
+void MpiProjector::receiveSlaveStats() throw()
+{
+  unsigned char buffer[64];             //the counts
+  MPI_Status status;
+  int msize(0);
+
+  for (; statspending > 0; --statspending)
+  {
+    MPI_Recv(buffer, sizeof(buffer), MPI_PACKED, MPI_ANY_SOURCE,
+             STATS_MSG, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_PACKED, &msize);
+    addSlaveStats(buffer, msize);
+  }
+}
+
+//*******************************************************
+ChunkScheduler * MpiProjector::setupSchedule() throw()
+{
+  ChunkScheduler * ret(0);                    //return schedule
+  PmeshLib::ProjectionMesh * pmesh(0);        //reverse pmesh
+  Footprint * outline(0);                     //input outline
+  RowTransform * transform(0);                //output to input
+  const long int rowbytes = oldwidth*spp*(bps/8); //bytes in an input row
+  long int beginofchunk, endofchunk(-1);      //the chunk
+  long int first, last;                       //its input rows
+  long int ycounter(1);
+  unsigned int chunkdif(maxchunk-minchunk);
+
+  try
+  {
+    //a slave keeps as many rows as its cache holds (or the OS does)
+    if (!(ret = new (std::nothrow) ChunkScheduler
+          (numofslaves, cachesize ? static_cast<long int>(cachesize)
+           *1048576L/rowbytes : oldheight)))
+      throw std::bad_alloc();
+
+    //without these the chunks just don't say what rows they need.  A
+    //plan or the adaptive mesh keeps this from projecting every chunk
+    //exactly, and without either the job's pmesh is built for it.
+    if (!warpplan && !meshgrid)
+      pmesh = setupReversePmesh();
+    outline = setupFootprint(spp, pmesh);
+    transform = setupRowTransform(pmesh);
+
+    //init the random number generator
+    if (sequencemethod == 2)
+      srand48(time(NULL));
+
+    for (beginofchunk = 0; beginofchunk < newheight;
+         beginofchunk = endofchunk + 1)
+    {
+      switch(sequencemethod)
+      {
+      case 0:
+        endofchunk = beginofchunk + maxchunk -1;
+        break;
+      case 1:
+        ++ycounter;
+        if (ycounter >= sequencesize)
+          ycounter = 0;
+        endofchunk = beginofchunk + sequence[ycounter]-1;
+        break;
+      case 2:
+        endofchunk = beginofchunk + static_cast<int>(drand48()*chunkdif
+                                                     + minchunk) -1;
+        break;
+      }
+
+      //check the newheight
+      if (endofchunk >= newheight)
+        endofchunk = newheight-1;
+      if (endofchunk < beginofchunk)
+        endofchunk = beginofchunk;
+
+      first = 0;
+      last = -1;
+      if (outline && transform)
+        ChunkProjector::estimateInputRows(transform, outline, oldheight,
+                                          beginofchunk, endofchunk,
+                                          first, last);
+      ret->addChunk(beginofchunk, endofchunk, first, last);
+    }
+
+    delete transform;
+    delete outline;
+    delete pmesh;
+    return ret;
+  }
+  catch(...)
+  {
+    delete transform;
+    delete outline;
+    delete pmesh;
+    delete ret;
+    return NULL;
+  }
+}
+
 //*******************************************************
 bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
   throw(ProjectorException)
@@ -549,12 +759,12 @@ bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
   long int buffersize(0);
   MPI_Status status;         
   unsigned char * buffer(0); //the buffer for sending data
-  long int ycounter(1), endofchunk(0), beginofchunk(0);
+  long int ycounter(0), endofchunk(0), beginofchunk(0);
   long int countmax(0);      //this is the total number of scanlines sent
   long int chunkssent(0);    //this is the number of chunks sent
   long int chunksgot(0);     //this is the number of chunks that we have got
-  unsigned int chunkdif(maxchunk-minchunk);
   Stitcher * mystitch(0);    //this is the sticher pointer (if we use it)
+  ChunkScheduler * schedule(0); //picks the chunk for each slave
     
 
   try
@@ -582,9 +792,13 @@ bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
         throw std::bad_alloc();
     }
 
-    //init the random number generator
-    if (sequencemethod == 2)
-      srand48(time(NULL));
+    //split the output into chunks and find the input rows of each
+    if (!(schedule = setupSchedule()))
+      throw std::bad_alloc();
+
+    //the slaves' caches are counted as they exit
+    cachestats = RowCacheStats();
+    statspending = 0;
     
     
     //figure out the maximum buffer size based on the system;
@@ -601,44 +815,8 @@ bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
     
 
 
-    while (countmax < newheight)
+    while (schedule->getRemaining())
     {
-      beginofchunk = countmax;    //set the beginning line
-      //build the message
-      switch(sequencemethod)
-      {
-      case 0:
-        endofchunk = countmax + maxchunk -1;
-        break;
-      case 1:
-        ++ycounter;
-        if (ycounter >= sequencesize)
-          ycounter = 0;
-        endofchunk = countmax + sequence[ycounter]-1;
-        break;
-      case 2:
-        endofchunk = countmax + static_cast<int>(drand48()*chunkdif
-                                                 + minchunk) -1;
-        break;
-      }
-      
-                                                            
-      //check the newheight
-      if (endofchunk >= newheight)
-      {
-        endofchunk = newheight-1;
-      }
-
-      //update the countmax
-      countmax += (endofchunk - beginofchunk) + 1;
-      
-      //update the number of chunks sent
-      ++chunkssent;
-              
-      //update the output
-      if (progress && !((beginofchunk) % 11))
-        progress->update(beginofchunk);
-      
       //do a blocking wait for any message.
       MPI_Recv(buffer, buffersize, MPI_PACKED, MPI_ANY_SOURCE,
                MPI_ANY_TAG, MPI_COMM_WORLD, &status);
@@ -650,15 +828,7 @@ bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
       case SETUP_MSG:
         //pack the info in and send to slave
         sendSlaveSetup(status.MPI_SOURCE);
-        //add the first bit of work
-        position = 0;
-        MPI_Pack(&(beginofchunk), 1, MPI_LONG, buffer, buffersize,
-                 &position, MPI_COMM_WORLD);
-        MPI_Pack(&(endofchunk), 1, MPI_LONG, buffer, buffersize,
-                 &position, MPI_COMM_WORLD);
-        //send to the slave
-        MPI_Send(buffer, position, MPI_PACKED, status.MPI_SOURCE,
-                 WORK_MSG, MPI_COMM_WORLD);
+        ++statspending;             //it sends its cache counts at the end
         break;
       case WORK_MSG:
         //unpack the scanline
@@ -671,22 +841,39 @@ bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
         }
         else
           unpackScanline(buffer, msize);
-        //pack the next work
-        position = 0;
-        MPI_Pack(&(beginofchunk), 1, MPI_LONG, buffer, buffersize,
-                 &position, MPI_COMM_WORLD);
-        MPI_Pack(&(endofchunk), 1, MPI_LONG, buffer, buffersize,
-                 &position, MPI_COMM_WORLD);
-        //send to the slave
-        MPI_Send(buffer, position, MPI_PACKED, status.MPI_SOURCE,
-                 WORK_MSG, MPI_COMM_WORLD);
         break;
       case ERROR_MSG:
       default:
          throw ProjectorException(PROJECTOR_ERROR_BADINPUT);
       }
+
+      //give it the chunk that best fits the input it has read
+      schedule->next(status.MPI_SOURCE, beginofchunk, endofchunk);
+
+      //update the countmax
+      countmax += (endofchunk - beginofchunk) + 1;
+      
+      //update the number of chunks sent
+      ++chunkssent;
+              
+      //update the output
+      if (progress && !(chunkssent % 11))
+        progress->update(countmax);
+
+      //pack the next work
+      position = 0;
+      MPI_Pack(&(beginofchunk), 1, MPI_LONG, buffer, buffersize,
+               &position, MPI_COMM_WORLD);
+      MPI_Pack(&(endofchunk), 1, MPI_LONG, buffer, buffersize,
+               &position, MPI_COMM_WORLD);
+      //send to the slave
+      MPI_Send(buffer, position, MPI_PACKED, status.MPI_SOURCE,
+               WORK_MSG, MPI_COMM_WORLD);
     }
 
+    delete schedule;
+    schedule = NULL;
+
     //finish writting scanlines
     for (ycounter = chunksgot; ycounter < chunkssent; ++ycounter)
     {
@@ -715,6 +902,8 @@ bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
                EXIT_MSG, MPI_COMM_WORLD);
     }
 
+    receiveSlaveStats();                        //how the caches did
+
     if (progress)
       progress->done();
 
@@ -737,6 +926,7 @@ bool MpiProjector::projectnoslavelocal(BaseProgress * progress)
       delete mystitch;                          //should stop the stitcher
       mystitch = NULL;
     }
+    delete schedule;
 
     return false;
   }
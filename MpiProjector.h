@@ -7,14 +7,15 @@
 #ifndef MPIPROJECTOR_H_
 #define MPIPROJECTOR_H_
 
-#include "Projector.h"
+#include "ParallelProjector.h"
 #include "MessageTags.h"
 #include <mpi.h>
 #include <queue>
 #include "Stitcher.h"
+#include "ChunkScheduler.h"
 
-//The master pvm projector
-class MpiProjector : public Projector
+//The master pvm projector.  With no slaves it runs threaded.
+class MpiProjector : public ParallelProjector
 {
  public:
   //Constructor and Destructor
@@ -94,15 +95,29 @@ protected:
   bool projectnoslavelocal(BaseProgress * progress = NULL)
     throw(ProjectorException);
 
+  //setupSchedule splits the output into chunks by the sequencing method
+  //and works out the input rows each one needs with the same mapping
+  //the slaves use
+  ChunkScheduler * setupSchedule() throw();
+
 
   //sendSlaveSetup function does all the pvm packing to send to the slave
   //for setup
   bool sendSlaveSetup(int rank) throw();
 
+  //sendSlaveMesh sends the adaptive mesh to a slave after the setup so
+  //the slaves don't each have to build it
+  bool sendSlaveMesh(int rank) throw();
+
   //unpackScanline unpacks a scanline from the slave and writes it
   long int unpackScanline(unsigned char * buffer, 
                           long int buffersize) throw();
 
+  //addSlaveStats adds in the cache counts a slave sent when it exited
+  //and receiveSlaveStats waits for the ones still to come
+  void addSlaveStats(unsigned char * buffer, int buffersize) throw();
+  void receiveSlaveStats() throw();
+
   int numofslaves;                   //the number of slaves
   bool evenchunks;                   //are we using even chunks
   bool slavelocal;                   //should the slaves store and then send?
@@ -118,6 +133,7 @@ protected:
                                      //should store there files
   bool stitcher;                     //wheather the master should use the
                                      //sticher
+  int statspending;                  //slaves yet to send their cache counts
 
 };
 
@@ -9,28 +9,25 @@
 MpiProjectorSlave::MpiProjectorSlave() : Projector(),
                                          slavelocal(false),
                                          mastertid(0), mytid(0),
-                                         maxchunk(1)
+                                         maxchunk(1), pmesh(NULL),
+                                         footprint(NULL), chunker(NULL),
+                                         readahead(NULL), lastchunky(-1),
+                                         shared(NULL)
 {
 }
 
 //********************************************************
 MpiProjectorSlave::~MpiProjectorSlave()
 {
+  cleanupChunks();
+  delete shared;
 }
 
 //********************************************************
 bool MpiProjectorSlave::connect() throw()
 {
-  double x, y;                             //temp projecting vars
-  int _x, _y;                              //actual image xy
-  long int currenty, endy,xcounter,
-    ycounter;                              //current line and counter
-  unsigned char * scanline = NULL;         //output scanline
+  long int currenty, endy;                 //current chunk
   unsigned char * buffer = NULL;           //the buffer to send back
-  const unsigned char * inscanline = NULL; //input scaline
-  int sppcounter;                          // spp counter
-  PmeshLib::ProjectionMesh * pmesh = NULL; //projection mesh
-  double xscaleinv, yscaleinv;
   unsigned char * sendb(0);                //the send buffer
   int sendbsize(0);                        //the send buffer size
   MPI_Status status;                       //mpi status
@@ -55,14 +52,7 @@ bool MpiProjectorSlave::connect() throw()
     }
 
   
-    if (pmesh)
-    {
-      delete pmesh;
-      pmesh = NULL;
-    }
-     
-    pmesh = setupReversePmesh();        //setup the reverse pmesh
-     
+    setupChunks();                      //setup the transform and such
     
     //create the buffer to be at least as big as the 
     //maximum chunksize
@@ -89,10 +79,6 @@ bool MpiProjectorSlave::connect() throw()
     MPI_Recv(sendb, sendbsize, MPI_PACKED, MPI_ANY_SOURCE,
                MPI_ANY_TAG, MPI_COMM_WORLD, &status);
 
-    
-    //calcuate the inversers to do multiplaction instead of division
-    xscaleinv = 1.0/oldscale.x;
-    yscaleinv = 1.0/oldscale.y;
 
 
     //proccess messages
@@ -114,51 +100,9 @@ bool MpiProjectorSlave::connect() throw()
       MPI_Pack(&endy, 1, MPI_LONG, sendb, sendbsize, &position,
                MPI_COMM_WORLD);
 
-             
-      for (ycounter = currenty; ycounter <= endy; ++ycounter)
-      {
-        scanline = &(buffer[newwidth*spp*(ycounter-currenty)]);
-        
-        //reproject the line
-        for (xcounter = 0; xcounter < newwidth; ++xcounter)
-        {
-          x = outRect.left + newscale.x * xcounter;
-          y = outRect.top  - newscale.y * ycounter;
-          
-          //now get the 
-          //reverse projected value
-          if (pmesh)
-	  {
-	    pmesh->projectPoint(x, y);
-	  }        
-          else
-          {
-            toprojection->projectToGeo(x, y, y, x);
-            fromprojection->projectFromGeo(y, x, x, y);
-          }
-          _x = static_cast<long int>((x - inRect.left)* 
-                                     (xscaleinv) + 0.5);
-          _y = static_cast<long int>((inRect.top - y) * 
-                                     (yscaleinv) + 0.5);
-          
-          if ((_x >= oldwidth) || (_x < 0) || (_y >= oldheight) 
-              || (_y < 0))
-          {
-            for (sppcounter = 0; sppcounter < spp; sppcounter++)
-              scanline[xcounter*spp + sppcounter] = 0;
-          }
-          else
-          {
-            inscanline = cache->getRawScanline(_y);
-            for (sppcounter = 0; sppcounter < spp; sppcounter++)
-              scanline[xcounter*spp + sppcounter ] = 
-                inscanline[_x*spp + sppcounter];
-          }
-       
-         
-	}
 
-      }
+      readAhead(currenty, endy);                 //start the reads
+      chunker->project(currenty, endy, buffer);  //reproject the lines
      
       //pack this chunk into the buffer
       MPI_Pack(buffer, (endy-currenty + 1)*newwidth*spp, 
@@ -171,9 +115,6 @@ bool MpiProjectorSlave::connect() throw()
       MPI_Send(sendb, position, MPI_PACKED, 0,
                  WORK_MSG, MPI_COMM_WORLD);
       
-      //reset the scanline
-      scanline = NULL;
-
       //get the next work
       MPI_Recv(sendb, sendbsize, MPI_PACKED, MPI_ANY_SOURCE,
              MPI_ANY_TAG, MPI_COMM_WORLD, &status);
@@ -183,11 +124,10 @@ bool MpiProjectorSlave::connect() throw()
     }
     
     delete [] buffer;
-    scanline = NULL;
-    delete pmesh;
+    cleanupChunks();                    //stops the read ahead
+    sendStats();                        //tell the master how the cache did
     delete toprojection;
     toprojection = NULL;
-    pmesh = NULL;
     return true;
   }
   catch(...)
@@ -195,11 +135,10 @@ bool MpiProjectorSlave::connect() throw()
      //set a error to the master
     MPI_Send(0, 0, MPI_PACKED, 0,
              ERROR_MSG, MPI_COMM_WORLD);
-    delete pmesh;
+    delete [] buffer;
+    cleanupChunks();
     delete toprojection;
     toprojection = NULL;
-    pmesh = NULL;
-    delete scanline;
     return false;
   }
 }
@@ -207,16 +146,8 @@ bool MpiProjectorSlave::connect() throw()
 //*********************************************************
 bool MpiProjectorSlave::storelocal() throw()
 {
-  double x, y;                             //temp projecting vars
-  int _x, _y;                              //actual image xy
-  long int currenty, endy,xcounter,
-    ycounter;                              //current line and counter
-  unsigned char * scanline = NULL;         //output scanline
+  long int currenty, endy;                 //current chunk
   unsigned char * buffer = NULL;           //the buffer to send back
-  const unsigned char * inscanline = NULL; //input scaline
-  int sppcounter;                          // spp counter
-  PmeshLib::ProjectionMesh * pmesh = NULL; //projection mesh
-  double xscaleinv, yscaleinv;
   unsigned char * sendb(0);                //the send buffer
   int sendbsize(0);                        //the send buffer size
   MPI_Status status;                       //mpi status
@@ -237,14 +168,7 @@ bool MpiProjectorSlave::storelocal() throw()
     
 
   
-    if (pmesh)
-    {
-      delete pmesh;
-      pmesh = NULL;
-    }
-     
-    pmesh = setupReversePmesh();        //setup the reverse pmesh
-     
+    setupChunks();                      //setup the transform and such
     
     //create the buffer to be at least as big as the 
     //maximum chunksize
@@ -270,10 +194,6 @@ bool MpiProjectorSlave::storelocal() throw()
     //get the first bit of work
     MPI_Recv(sendb, sendbsize, MPI_PACKED, MPI_ANY_SOURCE,
                MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-    
-    //calcuate the inversers to do multiplaction instead of division
-    xscaleinv = 1.0/oldscale.x;
-    yscaleinv = 1.0/oldscale.y;
 
 
     //proccess messages
@@ -295,51 +215,9 @@ bool MpiProjectorSlave::storelocal() throw()
       MPI_Pack(&endy, 1, MPI_LONG, sendb, sendbsize, &position,
                MPI_COMM_WORLD);
 
-             
-      for (ycounter = currenty; ycounter <= endy; ++ycounter)
-      {
-        scanline = &(buffer[newwidth*spp*(ycounter-currenty)]);
-        
-        //reproject the line
-        for (xcounter = 0; xcounter < newwidth; ++xcounter)
-        {
-          x = outRect.left + newscale.x * xcounter;
-          y = outRect.top  - newscale.y * ycounter;
-          
-          //now get the 
-          //reverse projected value
-          if (pmesh)
-	  {
-	    pmesh->projectPoint(x, y);
-	  }        
-          else
-          {
-            toprojection->projectToGeo(x, y, y, x);
-            fromprojection->projectFromGeo(y, x, x, y);
-          }
-          _x = static_cast<long int>((x - inRect.left)* 
-                                     (xscaleinv) + 0.5);
-          _y = static_cast<long int>((inRect.top - y) * 
-                                     (yscaleinv) + 0.5);
-          
-          if ((_x >= oldwidth) || (_x < 0) || (_y >= oldheight) 
-              || (_y < 0))
-          {
-            for (sppcounter = 0; sppcounter < spp; sppcounter++)
-              scanline[xcounter*spp + sppcounter] = 0;
-          }
-          else
-          {
-            inscanline = cache->getRawScanline(_y);
-            for (sppcounter = 0; sppcounter < spp; sppcounter++)
-              scanline[xcounter*spp + sppcounter ] = 
-                inscanline[_x*spp + sppcounter];
-          }
-       
-         
-	}
 
-      }
+      readAhead(currenty, endy);                 //start the reads
+      chunker->project(currenty, endy, buffer);  //reproject the lines
      
       //seek to the right position in the file....
       //Maybe this should be a lseek64??
@@ -362,9 +240,6 @@ bool MpiProjectorSlave::storelocal() throw()
       MPI_Send(sendb, position, MPI_PACKED, 0,
                  WORK_MSG, MPI_COMM_WORLD);
       
-      //reset the scanline
-      scanline = NULL;
-
       //get the next work
       MPI_Recv(sendb, sendbsize, MPI_PACKED, MPI_ANY_SOURCE,
              MPI_ANY_TAG, MPI_COMM_WORLD, &status);
@@ -377,11 +252,10 @@ bool MpiProjectorSlave::storelocal() throw()
     pvfs_close(ofiledesc);
     
     delete [] buffer;
-    scanline = NULL;
-    delete pmesh;
+    cleanupChunks();                    //stops the read ahead
+    sendStats();                        //tell the master how the cache did
     delete toprojection;
     toprojection = NULL;
-    pmesh = NULL;
     return true;
   }
   catch(...)
@@ -390,11 +264,10 @@ bool MpiProjectorSlave::storelocal() throw()
     //set a error to the master
     MPI_Send(0, 0, MPI_PACKED, 0,
              ERROR_MSG, MPI_COMM_WORLD);
-    delete pmesh;
+    delete [] buffer;
+    cleanupChunks();
     delete toprojection;
     toprojection = NULL;
-    pmesh = NULL;
-    delete scanline;
     return false;
   }
 
@@ -404,12 +277,228 @@ bool MpiProjectorSlave::storelocal() throw()
 
 
 
+//*********************************************************
+void MpiProjectorSlave::setupChunks() throw(std::bad_alloc)
+{
+  RowTransform * transform = NULL;    //row transform
+  InputRows * rows = NULL;            //input scanlines
+
+  cleanupChunks();                    //get rid of anything old
+
+  try
+  {
+    if (!openWarpPlan())              //a saved plan needs no mesh
+    {
+      pmesh = setupReversePmesh();    //setup the reverse pmesh
+      setupShiftGrid();               //setup the datum shift
+      if (!meshgrid)                  //unless the master sent it
+        setupMeshGrid();              //setup the adaptive mesh
+    }
+
+    if (!(footprint = setupFootprint(spp, pmesh)))
+      throw std::bad_alloc();
+
+    //the buffers to the master are sized for one byte per sample
+    if (bps != 8)
+      throw std::bad_alloc();
+
+    if (!(transform = setupRowTransform(pmesh)))
+      throw std::bad_alloc();
+
+    //share the cache with the other slaves on the node if asked to.
+    //Pinned rows are still private copies so half the cache size goes
+    //to the shared cache and each processor pins from the other half.
+    delete shared;
+    shared = NULL;
+    if ((cachepolicy == ROWCACHE_SHARED) && cache && !mapped)
+    {
+      if (!(shared = new (std::nothrow) SharedRowCache
+            (infile, bps, oldwidth*spp*(bps/8), oldheight)))
+        throw std::bad_alloc();
+      if (!shared->open(inputfile,
+                        static_cast<long int>(cachesize)*1048576L/2) ||
+          !(rows = new (std::nothrow) SharedInputRows
+            (shared, oldwidth*spp*(bps/8), oldheight,
+             static_cast<long int>(cachesize)*1048576L/2
+             / ((ACE_OS::num_processors_online() > 1)
+                ? ACE_OS::num_processors_online() : 1))))
+      {
+        delete shared;                //cache privately instead
+        shared = NULL;
+      }
+    }
+
+    //read ahead into the cache while the chunks are projected, which
+    //means everything else has to lock the file and cache
+    if (!rows && cache && !mapped)
+    {
+      if (!(readahead = new (std::nothrow) ReadAhead(cache, oldheight)))
+        throw std::bad_alloc();
+      if (!readahead->start() ||
+          !(rows = new (std::nothrow) LockedInputRows
+            (infile, cache, bps, oldwidth*spp*(bps/8), oldheight,
+             static_cast<long int>(cachesize)*1048576L,
+             readahead->getLock())))
+      {
+        delete readahead;
+        readahead = NULL;
+      }
+    }
+
+    //pin rows in the cache itself
+    if (!rows &&
+        !(rows = setupInputRows(static_cast<long int>(cachesize)*1048576L)))
+      throw std::bad_alloc();
+
+    if (!(chunker = new (std::nothrow) ChunkProjector
+          (transform, footprint, rows, getResampleFunc(bps, spp),
+           newwidth, oldwidth, oldheight, spp, spp, maxchunk,
+           tilesize, (fixedpoint || warpplan) ?
+           getIndexResampleFunc(bps, spp) : NULL)))
+      throw std::bad_alloc();
+    transform = NULL;                 //owned by the chunk projector now
+    rows = NULL;
+  }
+  catch(...)
+  {
+    delete transform;
+    delete rows;
+    cleanupChunks();
+    throw std::bad_alloc();
+  }
+}
+
+//*********************************************************
+void MpiProjectorSlave::cleanupChunks() throw()
+{
+  delete chunker;
+  delete readahead;                   //after the rows that use its lock
+  delete footprint;
+  delete pmesh;
+  chunker = NULL;
+  readahead = NULL;
+  footprint = NULL;
+  pmesh = NULL;
+  lastchunky = -1;
+}
+
+//*********************************************************
+void MpiProjectorSlave::readAhead(long int currenty, long int endy) throw()
+{
+  long int first, last;                    //rows for this chunk
+  long int nextfirst(0), nextlast(-1);     //rows for the next one
+  long int nexty, nextendy;                //the next chunk
+
+  if (!readahead && !mapped)
+    return;
+
+  //guess the next chunk is as far on as this one was from the last
+  nexty = ((lastchunky >= 0) && (currenty > lastchunky))
+    ? currenty + (currenty - lastchunky) : endy + 1;
+  nextendy = nexty + (endy - currenty);
+  if (nextendy >= newheight)
+    nextendy = newheight - 1;
+  lastchunky = currenty;
+
+  chunker->getInputRows(currenty, endy, first, last);
+  if (nexty <= nextendy)
+    chunker->getInputRows(nexty, nextendy, nextfirst, nextlast);
+
+  if (readahead)
+    readahead->request(first, last, nextfirst, nextlast);
+  else
+  {
+    //the OS reads a mapped input in for us
+    mapped->adviseRows(first, last);
+    mapped->adviseRows(nextfirst, nextlast);
+  }
+}
+
+//*********************************************************
+void MpiProjectorSlave::sendStats() throw()
+{
+  RowCacheStats stats;                     //what the cache did
+  long int counts[3];                      //the counts to send
+  unsigned char buf[64];                   //the message
+  int position(0);
+
+  if (shared)
+    stats = shared->getStats();
+  else if (cache)
+    stats = cache->getStats();
+
+  counts[0] = stats.hits;
+  counts[1] = stats.misses;
+  counts[2] = stats.evictions;
+
+  MPI_Pack(counts, 3, MPI_LONG, buf, sizeof(buf), &position,
+           MPI_COMM_WORLD);
+  MPI_Send(buf, position, MPI_PACKED, 0, STATS_MSG, MPI_COMM_WORLD);
+}
+
+//*********************************************************
+void MpiProjectorSlave::unpackMesh() throw(std::bad_alloc)
+{
+  long int info[MESHGRID_INFO];          //the mesh metrics
+  double * coords(0);                    //the cell corners
+  long int * children(0);                //the cell children
+  unsigned char * buf(0);
+  int bufsize(0);
+  int position(0);
+  MPI_Status status;
+
+  try
+  {
+    //the size depends on the mesh so look first
+    MPI_Probe(0, MESH_MSG, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_PACKED, &bufsize);
+
+    if (!(buf = new (std::nothrow) unsigned char[bufsize]))
+      throw std::bad_alloc();
+
+    MPI_Recv(buf, bufsize, MPI_PACKED, 0, MESH_MSG, MPI_COMM_WORLD,
+             &status);
+
+    MPI_Unpack(buf, bufsize, &position, info, MESHGRID_INFO, MPI_LONG,
+               MPI_COMM_WORLD);
+
+    if (!(coords = new (std::nothrow) double[8*info[5] + 1]))
+      throw std::bad_alloc();
+    if (!(children = new (std::nothrow) long int[info[5] + 1]))
+      throw std::bad_alloc();
+
+    MPI_Unpack(buf, bufsize, &position, coords, 8*info[5], MPI_DOUBLE,
+               MPI_COMM_WORLD);
+    MPI_Unpack(buf, bufsize, &position, children, info[5], MPI_LONG,
+               MPI_COMM_WORLD);
+
+    delete meshgrid;
+    if (!(meshgrid = new (std::nothrow) MeshGrid))
+      throw std::bad_alloc();
+    meshgrid->load(info, coords, children);
+
+    delete [] buf;
+    delete [] coords;
+    delete [] children;
+  }
+  catch(...)
+  {
+    delete [] buf;
+    delete [] coords;
+    delete [] children;
+    delete meshgrid;
+    meshgrid = NULL;
+    throw std::bad_alloc();
+  }
+}
+
 //*********************************************************
 void MpiProjectorSlave::unpackSetup() throw()
 {
  
   char tempbuffer[100];
   int temp;
+  int havemesh(0);                         //the master sends a mesh
   unsigned char * buf(0);
   int bufsize(0), tempsize(0);
   int position(0);
@@ -419,13 +508,13 @@ void MpiProjectorSlave::unpackSetup() throw()
   try
   {
     //calculate the buffersize
-    MPI_Pack_size(200, MPI_CHAR, MPI_COMM_WORLD, &tempsize);
+    MPI_Pack_size(300, MPI_CHAR, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
     MPI_Pack_size(2, MPI_LONG, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
-    MPI_Pack_size(23, MPI_DOUBLE, MPI_COMM_WORLD, &tempsize);
+    MPI_Pack_size(24, MPI_DOUBLE, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
-    MPI_Pack_size(8, MPI_INT, MPI_COMM_WORLD, &tempsize);
+    MPI_Pack_size(13, MPI_INT, MPI_COMM_WORLD, &tempsize);
     bufsize += tempsize;
     
     //create the buffer
@@ -484,6 +573,28 @@ void MpiProjectorSlave::unpackSetup() throw()
             MPI_COMM_WORLD);
     MPI_Unpack(buf, bufsize, &position, &pmeshname, 1, MPI_INT,
            MPI_COMM_WORLD);
+    MPI_Unpack(buf, bufsize, &position, &maxerror, 1, MPI_DOUBLE,
+           MPI_COMM_WORLD);
+    MPI_Unpack(buf, bufsize, &position, &tilesize, 1, MPI_INT,
+           MPI_COMM_WORLD);
+    MPI_Unpack(buf, bufsize, &position, &temp, 1, MPI_INT,
+           MPI_COMM_WORLD);
+    fixedpoint = (temp != 0);
+    MPI_Unpack(buf, bufsize, &position, &temp, 1, MPI_INT,
+           MPI_COMM_WORLD);
+    shiftdatums = (temp != 0);
+    MPI_Unpack(buf, bufsize, &position, &havemesh, 1, MPI_INT,
+           MPI_COMM_WORLD);
+    MPI_Unpack(buf, bufsize, &position, tempbuffer, 100, MPI_CHAR,
+             MPI_COMM_WORLD);
+    plandir = tempbuffer;                 //the master has a plan there
+
+    //unpack the cache settings
+    MPI_Unpack(buf, bufsize, &position, &temp, 1, MPI_INT,
+           MPI_COMM_WORLD);
+    cachesize = temp;
+    MPI_Unpack(buf, bufsize, &position, &cachepolicy, 1, MPI_INT,
+           MPI_COMM_WORLD);
     
     //pack the projection parameters
     MPI_Unpack(buf, bufsize, &position, 
@@ -559,10 +670,15 @@ void MpiProjectorSlave::unpackSetup() throw()
       
     Projector::setInputFile(inputfilename);//setup cache, input image metrics, 
                                            //input projection
+    inputfile = inputfilename;             //names the shared cache
     
     toprojection = SetProjection(Params); //get the to projection
     
     delete [] buf; //done with buffer
+    buf = NULL;
+
+    if (havemesh)                         //get the master's mesh
+      unpackMesh();
     
   }
   catch(...)
@@ -12,6 +12,9 @@
 #include <malloc.h>
 
 #include "Projector.h"
+#include "ChunkProjector.h"
+#include "ReadAhead.h"
+#include "SharedRowCache.h"
 #include "MessageTags.h"
 #include <mpi.h>
 #include <queue>
@@ -58,15 +61,39 @@ class MpiProjectorSlave : public Projector
   //unpackSetup function unpacks setup info from the master
   void unpackSetup() throw();
 
+  //unpackMesh gets the adaptive mesh the master sends after the setup
+  void unpackMesh() throw(std::bad_alloc);
+
   //storelocal function handles when the master tells the slave
   //to store its information locally.
   bool storelocal() throw();
+
+  //setupChunks sets up the mesh, footprint and chunk projector
+  void setupChunks() throw(std::bad_alloc);
+
+  //cleanupChunks deletes everything setupChunks created
+  void cleanupChunks() throw();
+
+  //readAhead starts reading the input rows for a chunk and the chunk
+  //likely to come after it
+  void readAhead(long int currenty, long int endy) throw();
+
+  //sendStats sends the master what the input cache did
+  void sendStats() throw();
   
   
   bool slavelocal;                 //default is false
   int mastertid, mytid;            //pvm name
   unsigned int maxchunk;           //maximum chunksize
   std::string basepath;            //the path to the local file directory
+
+  PmeshLib::ProjectionMesh * pmesh;   //the reverse mesh
+  Footprint * footprint;              //input outline
+  ChunkProjector * chunker;           //reprojects the chunks
+  ReadAhead * readahead;              //reads the rows ahead or NULL
+  long int lastchunky;                //start of the last chunk or -1
+  SharedRowCache * shared;            //the node's input cache or NULL
+  std::string inputfile;              //the input the master sent
  
 
 };
@@ -48,13 +48,13 @@ void PVFSProjector::project(BaseProgress * progress = NULL)
   {
     if (!mcounters.size())           //must have a partition num  
     {
-      Projector::project(progress);
+      ParallelProjector::project(progress);
       return;
     }
 
     if (static_cast<unsigned int>(numofslaves) < mcounters.size()) 
     {
-      Projector::project(progress);
+      ParallelProjector::project(progress);
       return;
     }
 
@@ -91,6 +91,21 @@ void PVFSProjector::project(BaseProgress * progress = NULL)
       pmesh = NULL;
     }
 
+    //build the adaptive mesh once here and send it to the slaves,
+    //unless there is a plan (which the master has to save)
+    if (!openWarpPlan())
+    {
+      setupShiftGrid();
+      setupMeshGrid();
+      if (!plandir.empty())
+      {
+        pmesh = setupReversePmesh();
+        buildWarpPlan(pmesh, NULL);
+        delete pmesh;
+        pmesh = NULL;
+      }
+    }
+
     //check the rank in MPI
     MPI_Comm_rank(MPI_COMM_WORLD, &mytid);
 
@@ -176,8 +191,13 @@ void PVFSProjector::projectPVFS(BaseProgress * progress)
         throw std::bad_alloc();
     }
     
-     //figure out the maximum buffer size based on the system;
-    MPI_Pack_size(2, MPI_LONG, MPI_COMM_WORLD, &membersize);
+    //the slaves' caches are counted as they exit
+    cachestats = RowCacheStats();
+    statspending = 0;
+
+     //figure out the maximum buffer size based on the system
+     //(three longs leaves room for the cache counts)
+    MPI_Pack_size(3, MPI_LONG, MPI_COMM_WORLD, &membersize);
     buffersize+=membersize;
     if(!slavelocal)
     {
@@ -199,6 +219,15 @@ void PVFSProjector::projectPVFS(BaseProgress * progress)
       //do a blocking wait for any message.
       MPI_Recv(buffer, buffersize, MPI_PACKED, MPI_ANY_SOURCE,
                MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+
+      //a slave that already exited sent its cache counts
+      if (status.MPI_TAG == STATS_MSG)
+      {
+        MPI_Get_count(&status, MPI_PACKED, &msize);
+        addSlaveStats(buffer, msize);
+        --statspending;
+        continue;
+      }
       
       //get the starting scanline
       beginofchunk = mcounters[membership[status.MPI_SOURCE]]; 
@@ -301,6 +330,8 @@ void PVFSProjector::projectPVFS(BaseProgress * progress)
 
     }
 
+    receiveSlaveStats();                        //how the caches did
+
     if (progress)
       progress->done();
     
@@ -426,6 +457,7 @@ long int PVFSProjector::terminateSlave(MPI_Status status,
     //the slave is done so it should get out of dodge
     MPI_Send(0, 0, MPI_PACKED, status.MPI_SOURCE,
               EXIT_MSG, MPI_COMM_WORLD);
+    ++statspending;                     //it sends its cache counts next
   }
 
   return retvalue;
@@ -0,0 +1,486 @@
+/**
+ * Implementation file for the ParallelProjector
+ **/
+
+#ifndef PARALLELPROJECTOR_CPP_
+#define PARALLELPROJECTOR_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include <strstream>
+#include <cstring>
+#include "ParallelProjector.h"
+
+
+//*************************************************************
+void * parallel_start(void * worker)
+{
+  //run the worker
+  ParallelWorker * temp = reinterpret_cast<ParallelWorker *>(worker);
+  temp->owner->runWorker(temp);
+  return 0;
+}
+
+//*************************************************************
+void * parallel_extents(void * worker)
+{
+  //run the extents worker
+  ExtentsWorker * temp = reinterpret_cast<ExtentsWorker *>(worker);
+  temp->owner->runExtents(temp);
+  return 0;
+}
+
+
+//*************************************************************
+ParallelWorker::ParallelWorker() : owner(NULL), from(NULL), to(NULL),
+                                   chunker(NULL)
+{}
+
+//*************************************************************
+ParallelWorker::~ParallelWorker()
+{
+  delete chunker;                         //uses the projections
+  delete from;
+  delete to;
+}
+
+
+//*************************************************************
+ExtentsWorker::ExtentsWorker() : owner(NULL), from(NULL), to(NULL),
+                                 first(0), last(0)
+{}
+
+//*************************************************************
+ExtentsWorker::~ExtentsWorker()
+{
+  delete from;
+  delete to;
+}
+
+
+//*************************************************************
+ParallelProjector::ParallelProjector() : Projector(), numthreads(0),
+                                         inputmutex(), statemutex(),
+                                         statecond(statemutex),
+                                         numblocks(0), written(0),
+                                         window(0), blockbytes(0),
+                                         blockbuffer(NULL),
+                                         slotblock(NULL), failed(false)
+{}
+
+//*************************************************************
+ParallelProjector::~ParallelProjector()
+{}
+
+//*************************************************************
+void ParallelProjector::setNumberOfThreads(const int & innumthreads) throw()
+{
+  numthreads = innumthreads;
+}
+
+//*************************************************************
+int ParallelProjector::getNumberOfThreads() const throw()
+{
+  return numthreads;
+}
+
+//*************************************************************
+void ParallelProjector::project(BaseProgress * progress)
+  throw(ProjectorException)
+{
+  PmeshLib::ProjectionMesh * pmesh = NULL;     //projection mesh
+  Footprint * footprint = NULL;                //input outline
+  ParallelWorker * worker = NULL;              //a thread
+  const long int pixelbytes = spp*(bps/8);     //bytes per pixel
+  long int threads, counter, spawned(0);       //the threads
+  long int block, slot, line, lastline;        //the block being written
+
+  try
+  {
+    threads = numthreads ? numthreads : ACE_OS::num_processors_online();
+    if (threads <= 1)                          //nothing to split up
+    {
+      Projector::project(progress);
+      return;
+    }
+
+    if (!fromprojection || !toprojection)      //check for projections
+      throw ProjectorException(PROJECTOR_PROJECTION);
+
+    pmesh = setupForwardPmesh();               //setup the forward mesh
+
+    getExtents(pmesh);                         //try to get the extents
+
+    setupOutput(outfile);                      //setup the output file
+
+    if (openWarpPlan())                        //a saved plan needs no mesh
+    {
+      delete pmesh;
+      pmesh = NULL;
+    }
+    else
+    {
+      if (pmesh)                               //check for existing pmesh
+      {
+        delete pmesh;
+        pmesh = setupReversePmesh();           //setup the reverse mesh
+      }
+
+      setupShiftGrid();                        //setup the datum shift
+      setupMeshGrid();                         //setup the adaptive mesh
+    }
+
+    if (!(footprint = setupFootprint(pixelbytes, pmesh)))
+      throw std::bad_alloc();
+
+    buildWarpPlan(pmesh, footprint);           //save it for next time
+
+    //figure out the blocks and how many can be held before writing
+    numblocks = (newheight + PARALLEL_BLOCK - 1) / PARALLEL_BLOCK;
+    if (threads > numblocks)
+      threads = numblocks;
+    window = 2*threads;
+    if (window > numblocks)
+      window = numblocks;
+    blockbytes = PARALLEL_BLOCK*newwidth*pixelbytes;
+    written = 0;
+    failed = false;
+
+    if (!(blockbuffer = new (std::nothrow) unsigned char[window*blockbytes]))
+      throw std::bad_alloc();
+    if (!(slotblock = new (std::nothrow) long int[window]))
+      throw std::bad_alloc();
+    for (slot = 0; slot < window; ++slot)
+      slotblock[slot] = -1;
+
+    //setup the threads.  The reverse mesh is only read while projecting
+    //so they all share it.
+    workers.reserve(threads);
+    for (counter = 0; counter < threads; ++counter)
+    {
+      if (!(worker = new (std::nothrow) ParallelWorker))
+        throw std::bad_alloc();
+      workers.push_back(worker);
+      worker->owner = this;
+      setupWorker(worker, pmesh, footprint,
+                  static_cast<long int>(cachesize)*1048576L/threads);
+    }
+
+    //deal the blocks out round robin so the threads work near each other
+    for (block = 0; block < numblocks; ++block)
+      workers[block % threads]->blocks.push_back(block);
+
+    //init the status progress
+    if (progress)
+    {
+      std::strstream tempstream;
+
+      tempstream << "Reprojecting " << newheight << " lines with "
+                 << threads << " threads." << std::ends;
+      tempstream.freeze(0);
+      progress->init(tempstream.str(),
+                      NULL,
+                      "Done.",
+                      newheight,
+                      29);
+      progress->start();  //start the progress
+    }
+
+    //start the threads
+    for (spawned = 0; spawned < threads; ++spawned)
+    {
+      if (ACE_Thread::spawn((ACE_THR_FUNC)parallel_start,
+                            reinterpret_cast<void *>(workers[spawned]),
+                            THR_NEW_LWP | THR_JOINABLE,
+                            &(workers[spawned]->threadid)) == -1)
+        break;
+    }
+
+    try
+    {
+      if (spawned < threads)
+        throw std::bad_alloc();
+
+      //write the blocks out in order as they finish
+      for (block = 0; block < numblocks; ++block)
+      {
+        slot = block % window;
+
+        statemutex.acquire();
+        while ((slotblock[slot] != block) && !failed)
+          statecond.wait();
+        if (failed)
+        {
+          statemutex.release();
+          break;
+        }
+        statemutex.release();
+
+        lastline = (block + 1)*PARALLEL_BLOCK;
+        if (lastline > newheight)
+          lastline = newheight;
+        for (line = block*PARALLEL_BLOCK; line < lastline; ++line)
+          out->putRawScanline(line, &(blockbuffer
+                                      [slot*blockbytes +
+                                       (line - block*PARALLEL_BLOCK)
+                                       *newwidth*pixelbytes]));
+
+        if (progress)
+          progress->update(lastline);
+
+        //free up the slot
+        statemutex.acquire();
+        slotblock[slot] = -1;
+        written = block + 1;
+        statecond.broadcast();
+        statemutex.release();
+      }
+    }
+    catch(...)
+    {
+      //stop the threads
+      statemutex.acquire();
+      failed = true;
+      statecond.broadcast();
+      statemutex.release();
+    }
+
+    //wait for the threads
+    for (counter = 0; counter < spawned; ++counter)
+      ACE_Thread::join(workers[counter]->threadid);
+
+    if (failed)
+      throw ProjectorException(PROJECTOR_ERROR_UNKOWN);
+
+    //finsh the progress
+    if (progress)
+      progress->done();
+
+    if (cache)                                 //how the cache did
+      cachestats = cache->getStats();
+
+    writer.removeImage(0);                     //flush the output file
+    out = NULL;
+    for (counter = 0; counter < static_cast<long int>(workers.size());
+         ++counter)
+      delete workers[counter];
+    workers.clear();
+    delete [] blockbuffer;
+    delete [] slotblock;
+    blockbuffer = NULL;
+    slotblock = NULL;
+    delete footprint;
+    delete pmesh;
+  }
+  catch(...)
+  {
+    for (counter = 0; counter < static_cast<long int>(workers.size());
+         ++counter)
+      delete workers[counter];
+    workers.clear();
+    delete [] blockbuffer;
+    delete [] slotblock;
+    blockbuffer = NULL;
+    slotblock = NULL;
+    delete footprint;
+    delete pmesh;
+    writer.removeImage(0);                     //flush output file
+    out = NULL;
+    throw ProjectorException(PROJECTOR_ERROR_UNKOWN);
+  }
+}
+
+//*************************************************************
+void ParallelProjector::runWorker(ParallelWorker * worker) throw()
+{
+  long int block, slot, lastline;              //the block being done
+
+  statemutex.acquire();
+  while ((block = nextBlock(worker)) >= 0)
+  {
+    //wait for the writer to make room
+    while ((block >= written + window) && !failed)
+      statecond.wait();
+    if (failed)
+      break;
+    statemutex.release();
+
+    slot = block % window;
+    lastline = (block + 1)*PARALLEL_BLOCK;
+    if (lastline > newheight)
+      lastline = newheight;
+    worker->chunker->project(block*PARALLEL_BLOCK, lastline - 1,
+                             &(blockbuffer[slot*blockbytes]));
+
+    //tell the writer it's done
+    statemutex.acquire();
+    slotblock[slot] = block;
+    statecond.broadcast();
+  }
+  statemutex.release();
+}
+
+//*************************************************************
+void ParallelProjector::runExtents(ExtentsWorker * worker) throw()
+{
+  projectEdges(NULL, worker->from, worker->to, worker->first, worker->last,
+               worker->bounds);
+}
+
+//*************************************************************
+void ParallelProjector::walkEdges(PmeshLib::ProjectionMesh * pmesh,
+                                  EdgeBounds & bounds)
+  throw(ProjectorException)
+{
+  std::vector<ExtentsWorker *> edgeworkers;    //the threads
+  ExtentsWorker * worker = NULL;               //a thread
+  const long int edges = 2*(oldwidth + oldheight);
+  long int threads, counter, spawned(0);
+
+  threads = numthreads ? numthreads : ACE_OS::num_processors_online();
+  if (threads > edges/PARALLEL_EDGES)
+    threads = edges/PARALLEL_EDGES;
+
+  //the pmesh is cheap enough on its own
+  if ((threads <= 1) || pmesh)
+  {
+    Projector::walkEdges(pmesh, bounds);
+    return;
+  }
+
+  try
+  {
+    //the projections keep state so each thread gets its own
+    edgeworkers.reserve(threads);
+    for (counter = 0; counter < threads; ++counter)
+    {
+      if (!(worker = new (std::nothrow) ExtentsWorker))
+        throw std::bad_alloc();
+      edgeworkers.push_back(worker);
+      worker->owner = this;
+      worker->first = edges*counter/threads;
+      worker->last = edges*(counter + 1)/threads;
+      if (!(worker->from = fromprojection->clone()))
+        throw std::bad_alloc();
+      if (!(worker->to = toprojection->clone()))
+        throw std::bad_alloc();
+    }
+
+    for (spawned = 0; spawned < threads; ++spawned)
+    {
+      if (ACE_Thread::spawn((ACE_THR_FUNC)parallel_extents,
+                            reinterpret_cast<void *>(edgeworkers[spawned]),
+                            THR_NEW_LWP | THR_JOINABLE,
+                            &(edgeworkers[spawned]->threadid)) == -1)
+        break;
+    }
+
+    //do any that couldn't get a thread here
+    for (counter = spawned; counter < threads; ++counter)
+      runExtents(edgeworkers[counter]);
+
+    for (counter = 0; counter < threads; ++counter)
+    {
+      if (counter < spawned)
+        ACE_Thread::join(edgeworkers[counter]->threadid);
+      bounds.merge(edgeworkers[counter]->bounds);
+    }
+
+    for (counter = 0; counter < threads; ++counter)
+      delete edgeworkers[counter];
+    edgeworkers.clear();
+  }
+  catch(...)
+  {
+    for (counter = 0; counter < static_cast<long int>(edgeworkers.size());
+         ++counter)
+      delete edgeworkers[counter];
+    throw ProjectorException(PROJECTOR_UNABLE_OUTPUT_SETUP);
+  }
+}
+
+//*************************************************************
+void ParallelProjector::setupWorker(ParallelWorker * worker,
+                                    PmeshLib::ProjectionMesh * pmesh,
+                                    Footprint * footprint,
+                                    long int pinbytes)
+  throw(std::bad_alloc)
+{
+  const long int pixelbytes = spp*(bps/8);     //bytes per pixel
+  RowTransform * transform = NULL;             //row transform
+  InputRows * rows = NULL;                     //input scanlines
+
+  try
+  {
+    //the projections keep state so each thread gets its own
+    if (!(worker->from = fromprojection->clone()))
+      throw std::bad_alloc();
+    if (!(worker->to = toprojection->clone()))
+      throw std::bad_alloc();
+
+    if (!(transform = setupRowTransform(pmesh, worker->to, worker->from)))
+      throw std::bad_alloc();
+
+    //a mapped input needs no lock
+    if (mapped)
+    {
+      if (!(rows = setupInputRows(pinbytes)))
+        throw std::bad_alloc();
+    }
+    else if (!(rows = new (std::nothrow) LockedInputRows(infile, cache, bps,
+                                                         oldwidth*pixelbytes,
+                                                         oldheight, pinbytes,
+                                                         inputmutex)))
+      throw std::bad_alloc();
+
+    if (!(worker->chunker = new (std::nothrow) ChunkProjector
+          (transform, footprint, rows, getResampleFunc(bps, spp),
+           newwidth, oldwidth, oldheight, spp, pixelbytes,
+           PARALLEL_BLOCK, tilesize, (fixedpoint || warpplan) ?
+           getIndexResampleFunc(bps, spp) : NULL)))
+      throw std::bad_alloc();
+  }
+  catch(...)
+  {
+    delete transform;
+    delete rows;
+    throw std::bad_alloc();
+  }
+}
+
+//*************************************************************
+long int ParallelProjector::nextBlock(ParallelWorker * worker) throw()
+{
+  ParallelWorker * victim = NULL;              //who to steal from
+  long int ret;
+  unsigned int counter;
+
+  if (failed)
+    return -1;
+
+  if (worker->blocks.size())                   //take from the front
+  {
+    ret = worker->blocks.front();
+    worker->blocks.pop_front();
+    return ret;
+  }
+
+  //steal from the back of the thread with the most left
+  for (counter = 0; counter < workers.size(); ++counter)
+  {
+    if (!victim || (workers[counter]->blocks.size() > victim->blocks.size()))
+      victim = workers[counter];
+  }
+
+  if (!victim || !victim->blocks.size())
+    return -1;                                 //all done
+
+  ret = victim->blocks.back();
+  victim->blocks.pop_back();
+  return ret;
+}
+
+#endif
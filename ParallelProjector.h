@@ -0,0 +1,121 @@
+/**
+ * ParallelProjector runs the reprojection with threads on a single
+ * machine.  The output lines are split into blocks that are dealt out
+ * round robin to the threads, and a thread that runs out of blocks
+ * steals from the back of the thread with the most left.  Each thread
+ * has its own projections, row transform and input rows (reads from
+ * the shared input go through a mutex).  The calling thread writes the
+ * finished blocks out in order.
+ **/
+
+#ifndef PARALLELPROJECTOR_H_
+#define PARALLELPROJECTOR_H_
+
+#include <deque>
+#include <vector>
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Thread.h>
+#include "Projector.h"
+#include "ChunkProjector.h"
+
+#define PARALLEL_BLOCK 16   //output lines in a block of work
+#define PARALLEL_EDGES 1024 //fewest edge pixels worth a thread
+
+
+class ParallelProjector;
+
+//ParallelWorker holds what belongs to one thread
+class ParallelWorker
+{
+ public:
+  ParallelWorker();
+  ~ParallelWorker();
+
+  ParallelProjector * owner;              //the projector
+  ProjLib::Projection * from, * to;       //this thread's projections
+  ChunkProjector * chunker;               //this thread's chunk projector
+  std::deque<long int> blocks;            //blocks left for this thread
+  ACE_thread_t threadid;                  //the thread
+};
+
+
+//ExtentsWorker holds one thread's share of the input edges
+class ExtentsWorker
+{
+ public:
+  ExtentsWorker();
+  ~ExtentsWorker();
+
+  ParallelProjector * owner;              //the projector
+  ProjLib::Projection * from, * to;       //this thread's projections
+  long int first, last;                   //edge pixels to project
+  EdgeBounds bounds;                      //where they went
+  ACE_thread_t threadid;                  //the thread
+};
+
+
+//This is the function that starts a worker thread
+void * parallel_start(void * worker);
+
+//This is the function that starts an extents thread
+void * parallel_extents(void * worker);
+
+
+class ParallelProjector : public Projector
+{
+ public:
+  //Constructor and Destructor
+  ParallelProjector();
+  virtual ~ParallelProjector();
+
+  //This function sets the number of threads to use.  0 (the default)
+  //uses one thread per processor and 1 runs single threaded.
+  void setNumberOfThreads(const int & innumthreads) throw();
+  int getNumberOfThreads() const throw();
+
+  //main function which runs the projection
+  virtual void
+    project(BaseProgress * progress = NULL)
+    throw(ProjectorException);
+
+  //runWorker is where the threads run and should not be called by
+  //anything else
+  void runWorker(ParallelWorker * worker) throw();
+
+  //runExtents is where the extents threads run
+  void runExtents(ExtentsWorker * worker) throw();
+
+ protected:
+  //walkEdges splits the input edges across the threads, each keeping a
+  //running min and max
+  virtual void walkEdges(PmeshLib::ProjectionMesh * pmesh,
+                         EdgeBounds & bounds) throw(ProjectorException);
+
+  //setupWorker sets up the projections and chunk projector of a thread
+  void setupWorker(ParallelWorker * worker, PmeshLib::ProjectionMesh * pmesh,
+                   Footprint * footprint, long int pinbytes)
+    throw(std::bad_alloc);
+
+  //nextBlock gets the next block for a worker, stealing one if the
+  //worker has none left.  Returns -1 when all of the blocks are gone.
+  //statemutex must be held.
+  long int nextBlock(ParallelWorker * worker) throw();
+
+  int numthreads;                         //threads to use (0 is auto)
+
+  //state shared with the threads while projecting
+  ACE_Thread_Mutex inputmutex;            //lock for the input file
+  ACE_Thread_Mutex statemutex;            //lock for everything below
+  ACE_Condition<ACE_Thread_Mutex> statecond;  //signaled on any change
+  std::vector<ParallelWorker *> workers;  //the threads
+  long int numblocks;                     //blocks in the image
+  long int written;                       //blocks written so far
+  long int window;                        //blocks that can be in flight
+  long int blockbytes;                    //bytes in a block
+  unsigned char * blockbuffer;            //window blocks of lines
+  long int * slotblock;                   //finished block in each slot
+  bool failed;                            //set if a thread failed
+};
+
+#endif
@@ -0,0 +1,269 @@
+/**
+ * Implementation file for PmeshBench
+ **/
+
+#ifndef PMESHBENCH_CPP_
+#define PMESHBENCH_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include <iomanip>
+#include <strstream>
+#include <cmath>
+#include "PmeshBench.h"
+
+//the sweep
+static const int pmeshsizes[PMESHBENCH_SIZES] = {4, 8, 16, 32, 64, 128};
+static const int pmeshnames[PMESHBENCH_INTERPOLATORS] = {6, 8, 10};
+static const char * interpolators[PMESHBENCH_INTERPOLATORS] =
+  {"leastsqrs", "bilinear", "bicubic"};
+static const double tolerances[PMESHBENCH_TOLERANCES] =
+  {0.5, 0.125, 0.03125};
+
+//*********************************************************************
+PmeshBench::PmeshBench() : rowstep(1)
+{}
+
+//*********************************************************************
+PmeshBench::~PmeshBench()
+{}
+
+//*********************************************************************
+void PmeshBench::setRowStep(long int inrowstep) throw()
+{
+  rowstep = (inrowstep > 0) ? inrowstep : 1;
+}
+
+//*********************************************************************
+long int PmeshBench::getRowStep() const throw()
+{
+  return rowstep;
+}
+
+//*********************************************************************
+void PmeshBench::run(std::ostream & out) throw(ProjectorException)
+{
+  double * xarr = NULL, * yarr = NULL;         //the transform's rows
+  double * ex = NULL, * ey = NULL;             //the exact rows
+  ExactRowTransform * exact = NULL;            //the exact transform
+  PmeshLib::ProjectionMesh * pmesh = NULL;     //mesh being timed
+  RowTransform * transform = NULL;             //and its transform
+  std::string size;                            //size column
+  clock_t start;
+  double setup;
+  int name, counter;
+
+  try
+  {
+    if (!fromprojection || !toprojection)      //check for projections
+      throw ProjectorException(PROJECTOR_PROJECTION);
+
+    pmeshname = 0;                             //the exact extents
+    getExtents(NULL);
+    setupShiftGrid();
+
+    if (!(xarr = new (std::nothrow) double[newwidth]) ||
+        !(yarr = new (std::nothrow) double[newwidth]) ||
+        !(ex = new (std::nothrow) double[newwidth]) ||
+        !(ey = new (std::nothrow) double[newwidth]))
+      throw std::bad_alloc();
+
+    if (!(exact = new (std::nothrow) ExactRowTransform
+          (outRect, newscale, inRect, oldscale, toprojection,
+           fromprojection, getShift(toprojection, fromprojection),
+           shiftgrid)))
+      throw std::bad_alloc();
+
+    out << "Input " << oldwidth << " x " << oldheight << ", output "
+        << newwidth << " x " << newheight << ", every " << rowstep
+        << " rows." << std::endl;
+    out << std::setw(10) << "mesh" << std::setw(10) << "size"
+        << std::setw(10) << "setup(s)" << std::setw(14) << "pixels/s"
+        << std::setw(12) << "max(px)" << std::setw(12) << "mean(px)"
+        << std::setw(10) << "moved(%)" << std::endl;
+
+    measure(*exact, *exact, "exact", "-", 0.0, xarr, yarr, ex, ey, out);
+
+    //no mesh is ever used for these
+    if (isAffinePair(fromprojection, toprojection) ||
+        isSeparablePair(fromprojection, toprojection))
+    {
+      out << "The mapping is affine or separable so no mesh is used."
+          << std::endl;
+    }
+    else
+    {
+      //a pmesh can't shift datums so a run would use the adaptive mesh
+      if (isShifted())
+        out << "The datums differ so the adaptive mesh is used in place"
+            << " of a pmesh." << std::endl;
+
+      for (name = 0; (name < PMESHBENCH_INTERPOLATORS) && !isShifted();
+           ++name)
+      {
+        for (counter = 0; counter < PMESHBENCH_SIZES; ++counter)
+        {
+          pmeshname = pmeshnames[name];
+          pmeshsize = pmeshsizes[counter];
+
+          start = clock();
+          if (!(pmesh = setupReversePmesh()))
+            throw std::bad_alloc();
+          setup = getSeconds(start);
+
+          if (!(transform = new (std::nothrow) MeshRowTransform
+                (outRect, newscale, inRect, oldscale, pmesh)))
+            throw std::bad_alloc();
+
+          std::strstream tempstream;
+          tempstream << pmeshsize << std::ends;
+          size = tempstream.str();
+          tempstream.freeze(0);
+          measure(*transform, *exact, interpolators[name], size.c_str(),
+                  setup, xarr, yarr, ex, ey, out);
+
+          delete transform;
+          transform = NULL;
+          delete pmesh;
+          pmesh = NULL;
+        }
+      }
+
+      for (counter = 0; counter < PMESHBENCH_TOLERANCES; ++counter)
+      {
+        pmeshname = PMESH_ADAPTIVE;
+        maxerror = tolerances[counter];
+
+        start = clock();
+        setupMeshGrid();
+        setup = getSeconds(start);
+
+        if (!(transform = new (std::nothrow) GridRowTransform
+              (outRect, newscale, inRect, oldscale, meshgrid)))
+          throw std::bad_alloc();
+
+        std::strstream tempstream;
+        tempstream << maxerror << std::ends;
+        size = tempstream.str();
+        tempstream.freeze(0);
+        measure(*transform, *exact, "adaptive", size.c_str(), setup,
+                xarr, yarr, ex, ey, out);
+
+        delete transform;
+        transform = NULL;
+      }
+    }
+
+    delete exact;
+    delete [] xarr;
+    delete [] yarr;
+    delete [] ex;
+    delete [] ey;
+  }
+  catch(ProjectorException & temp)
+  {
+    delete transform;
+    delete pmesh;
+    delete exact;
+    delete [] xarr;
+    delete [] yarr;
+    delete [] ex;
+    delete [] ey;
+    throw temp;                                      //just rethrow
+  }
+  catch(...)
+  {
+    delete transform;
+    delete pmesh;
+    delete exact;
+    delete [] xarr;
+    delete [] yarr;
+    delete [] ex;
+    delete [] ey;
+    throw ProjectorException(PROJECTOR_ERROR_UNKOWN);
+  }
+}
+
+//*********************************************************************
+void PmeshBench::measure(RowTransform & transform, RowTransform & exact,
+                         const char * name, const char * size,
+                         double setup, double * xarr, double * yarr,
+                         double * ex, double * ey, std::ostream & out)
+  throw()
+{
+  long int ycounter, xcounter;
+  long int pixels(0), compared(0), measured(0), moved(0);
+  double seconds, dx, dy, distance, maxdistance(0.0), total(0.0);
+  clock_t start;
+
+  //the timed pass
+  start = clock();
+  for (ycounter = 0; ycounter < newheight; ycounter += rowstep)
+  {
+    transform.projectRow(ycounter, 0, newwidth, xarr, yarr);
+    pixels += newwidth;
+  }
+  seconds = getSeconds(start);
+
+  //then how far off it is from the exact pixels that are in the input
+  for (ycounter = 0; ycounter < newheight; ycounter += rowstep)
+  {
+    transform.projectRow(ycounter, 0, newwidth, xarr, yarr);
+    exact.projectRow(ycounter, 0, newwidth, ex, ey);
+
+    for (xcounter = 0; xcounter < newwidth; ++xcounter)
+    {
+      if (!(ex[xcounter] + 0.5 >= 0.0) || !(ex[xcounter] + 0.5 < oldwidth) ||
+          !(ey[xcounter] + 0.5 >= 0.0) || !(ey[xcounter] + 0.5 < oldheight))
+        continue;
+
+      dx = xarr[xcounter] - ex[xcounter];
+      dy = yarr[xcounter] - ey[xcounter];
+      distance = std::sqrt(dx*dx + dy*dy);
+      ++compared;
+
+      //one that didn't project only counts as moved
+      if (!(distance - distance == 0.0))
+      {
+        ++moved;
+        continue;
+      }
+      if (distance > maxdistance)
+        maxdistance = distance;
+      total += distance;
+      ++measured;
+
+      if ((std::floor(xarr[xcounter] + 0.5) != std::floor(ex[xcounter] + 0.5))
+          || (std::floor(yarr[xcounter] + 0.5)
+              != std::floor(ey[xcounter] + 0.5)))
+        ++moved;
+    }
+  }
+
+  out << std::setw(10) << name << std::setw(10) << size
+      << std::setw(10) << std::setiosflags(std::ios::fixed)
+      << std::setprecision(3) << setup
+      << std::setw(14) << std::setprecision(0) << pixels/seconds
+      << std::setw(12) << std::setprecision(4) << maxdistance
+      << std::setw(12) << (measured ? total/measured : 0.0)
+      << std::setw(10) << std::setprecision(2)
+      << (compared ? 100.0*moved/compared : 0.0)
+      << std::resetiosflags(std::ios::fixed) << std::setprecision(6)
+      << std::endl;
+}
+
+//*********************************************************************
+double PmeshBench::getSeconds(clock_t start) throw()
+{
+  const clock_t finish = clock();
+
+  //never report a pass as taking no time at all
+  if (finish <= start)
+    return 1.0/CLOCKS_PER_SEC;
+  return static_cast<double>(finish - start)/CLOCKS_PER_SEC;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * PmeshBench times the ways the output to input mapping can be done for
+ * a job against each other.  The exact projection is run first and
+ * then the reverse ProjectionMesh with each interpolator at a sweep of
+ * mesh sizes, and the adaptive mesh at a few tolerances.  Each one is
+ * reported with its setup time, the pixels per second it maps and how
+ * far (in input pixels) it puts them from where the exact projection
+ * does, along with the share of them that round to a different input
+ * pixel.  Only pixels that land in the input are compared.  A job with
+ * datum shifting turned on (see Projector::setShiftDatums) skips the
+ * ProjectionMesh, which can't shift, just as a run does.
+ *
+ * The output grid is found the same way a real run finds it, from the
+ * output projection and the output scale (or the same scale).
+ **/
+
+#ifndef PMESHBENCH_H_
+#define PMESHBENCH_H_
+
+#include <iostream>
+#include <ctime>
+#include "Projector.h"
+
+//Number of mesh sizes, interpolators and adaptive tolerances swept
+#define PMESHBENCH_SIZES 6
+#define PMESHBENCH_INTERPOLATORS 3
+#define PMESHBENCH_TOLERANCES 3
+
+
+class PmeshBench : public Projector
+{
+ public:
+  //Constructor and Destructor
+  PmeshBench();
+  virtual ~PmeshBench();
+
+  //This function sets the output rows that are timed and compared.
+  //Every rowstep'th row is done.  Default is 1 (every row).
+  void setRowStep(long int inrowstep) throw();
+  long int getRowStep() const throw();
+
+  //run times everything and writes the table to out
+  void run(std::ostream & out) throw(ProjectorException);
+
+ protected:
+  //measure times transform over the rows and compares it with exact.
+  //xarr through ey must hold newwidth entries.
+  void measure(RowTransform & transform, RowTransform & exact,
+               const char * name, const char * size, double setup,
+               double * xarr, double * yarr, double * ex, double * ey,
+               std::ostream & out) throw();
+
+  //getSeconds returns the processor time since start
+  static double getSeconds(clock_t start) throw();
+
+  long int rowstep;                             //rows between those done
+};
+
+#endif
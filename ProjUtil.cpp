@@ -11,6 +11,7 @@
 #define PROJUTIL_CPP_
 
 #include "ProjUtil.h"
+#include <cstdlib>
 
 //****************************************************************************
 ProjectionParams getParams(ProjLib::Projection * proj) 
@@ -615,10 +616,56 @@ double ConvertFromDMS(double dms) throw()
 //***************************************************************************
 void getMinMax(std::vector<double>& array, double& min, double& max) throw()
 {
-  std::sort(array.begin(), array.end());
+  std::vector<double>::const_iterator it;
 
-  max = array[array.size() - 1];
-  min = array[0];
+  //one pass is enough for the ends
+  min = max = array[0];
+  for (it = array.begin() + 1; it != array.end(); ++it)
+  {
+    if (*it < min)
+      min = *it;
+    else if (*it > max)
+      max = *it;
+  }
+}
+
+//****************************************************************************
+EdgeBounds::EdgeBounds() throw() : minx(0), maxx(0), miny(0), maxy(0),
+                                   count(0)
+{}
+
+//****************************************************************************
+void EdgeBounds::add(double x, double y) throw()
+{
+  if (!(x - x == 0.0) || !(y - y == 0.0))  //NaN or infinite
+    return;
+
+  if (!count++)
+  {
+    minx = maxx = x;
+    miny = maxy = y;
+    return;
+  }
+
+  if (x < minx)
+    minx = x;
+  else if (x > maxx)
+    maxx = x;
+  if (y < miny)
+    miny = y;
+  else if (y > maxy)
+    maxy = y;
+}
+
+//****************************************************************************
+void EdgeBounds::merge(const EdgeBounds & other) throw()
+{
+  if (!other.count)
+    return;
+
+  add(other.minx, other.miny);
+  add(other.maxx, other.maxy);
+  count += other.count - 2;
 }
 
 //****************************************************************************
@@ -702,6 +749,138 @@ MathLib::Point getSameScale(MathLib::Point inoldscale,
   return ret;
 }
 
+//****************************************************************************
+bool isAffinePair(ProjLib::Projection * in, ProjLib::Projection * out)
+  throw()
+{
+  ProjectionParams inparams, outparams;     //the projection parameters
+  bool inlinear, outlinear;                 //linear or angular units
+
+  try
+  {
+    if (!in || !out)
+      return false;
+
+    if ((in->getProjectionSystem() != out->getProjectionSystem()) ||
+        (in->getDatum() != out->getDatum()))
+      return false;
+
+    //units of the same kind only differ by a scale
+    inlinear = (in->getUnit() == ProjLib::METERS ||
+                in->getUnit() == ProjLib::US_FEET ||
+                in->getUnit() == ProjLib::INTERNATIONAL_FEET);
+    outlinear = (out->getUnit() == ProjLib::METERS ||
+                 out->getUnit() == ProjLib::US_FEET ||
+                 out->getUnit() == ProjLib::INTERNATIONAL_FEET);
+    if ((in->getUnit() != out->getUnit()) && (!inlinear || !outlinear))
+    {
+      //geographic can be in any angular unit
+      if ((in->getProjectionSystem() != ProjLib::GEO) ||
+          inlinear || outlinear)
+        return false;
+    }
+
+    switch(in->getProjectionSystem())
+    {
+    case GEO:                               //nothing else to compare
+      return true;
+    case HOM:                               //only type B has its params
+      return false;
+    default:
+      break;
+    }
+
+    inparams = getParams(in);
+    outparams = getParams(out);
+
+    return (inparams.zone == outparams.zone &&
+            inparams.StdParallel1 == outparams.StdParallel1 &&
+            inparams.StdParallel2 == outparams.StdParallel2 &&
+            inparams.NatOriginLong == outparams.NatOriginLong &&
+            inparams.NatOriginLat == outparams.NatOriginLat &&
+            inparams.FalseOriginLong == outparams.FalseOriginLong &&
+            inparams.FalseOriginLat == outparams.FalseOriginLat &&
+            inparams.FalseOriginEasting == outparams.FalseOriginEasting &&
+            inparams.FalseOriginNorthing == outparams.FalseOriginNorthing &&
+            inparams.CenterLong == outparams.CenterLong &&
+            inparams.CenterLat == outparams.CenterLat &&
+            inparams.CenterEasting == outparams.CenterEasting &&
+            inparams.CenterNorthing == outparams.CenterNorthing &&
+            inparams.ScaleAtNatOrigin == outparams.ScaleAtNatOrigin &&
+            inparams.AzimuthAngle == outparams.AzimuthAngle &&
+            inparams.StraightVertPoleLong ==
+            outparams.StraightVertPoleLong &&
+            inparams.FalseEasting == outparams.FalseEasting &&
+            inparams.FalseNorthing == outparams.FalseNorthing);
+  }
+  catch(...)
+  {
+    return false;                           //can't tell so reproject
+  }
+}
+
+//****************************************************************************
+bool isSeparablePair(ProjLib::Projection * in, ProjLib::Projection * out)
+  throw()
+{
+  ProjLib::Projection * proj[2] = {in, out};  //the projections to check
+  int counter;
+
+  if (!in || !out)
+    return false;
+
+  //a datum shift mixes latitude and longitude
+  if (in->getDatum() != out->getDatum())
+    return false;
+
+  //longitude is a function of x and latitude of y in these
+  for (counter = 0; counter < 2; ++counter)
+  {
+    switch(proj[counter]->getProjectionSystem())
+    {
+    case GEO:
+    case MERCAT:
+    case EQRECT:
+    case MILLER:
+      break;
+    default:
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//***********************************************************
+bool getCentralMeridian(ProjLib::Projection * proj, double & meridian)
+  throw()
+{
+  ProjectionParams params;
+
+  try
+  {
+    switch(proj->getProjectionSystem())
+    {
+    case GEO:
+    case SPCS:                                 //varies by zone
+      return false;
+    case UTM:
+      params = getParams(proj);
+      meridian = 6.0*std::abs(params.zone) - 183.0;
+      return true;
+    default:
+      params = getParams(proj);
+      meridian = params.CenterLong ? params.CenterLong
+        : params.NatOriginLong;
+      return true;
+    }
+  }
+  catch(...)
+  {
+    return false;
+  }
+}
+
 //***********************************************************
 Projection * SetProjection(std::string parameterfile) throw()
 {
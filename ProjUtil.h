@@ -44,11 +44,40 @@ double ConvertFromDMS(double dms) throw();
 //get minMax of two vecors
 void getMinMax(std::vector<double>& array, double& min, double& max) throw();
 
+//EdgeBounds is a running min and max of projected points so they don't
+//have to be kept and sorted.  Points that didn't project (NaN or
+//infinite) are left out.
+struct EdgeBounds
+{
+  EdgeBounds() throw();
+  void add(double x, double y) throw();
+  void merge(const EdgeBounds & other) throw();
+
+  double minx, maxx, miny, maxy;
+  long int count;                      //points added
+};
+
 //get SameScale converts linear units to perserve linear length (note:
 //if the input scale is angluar then the lat and long at equator are used
 MathLib::Point getSameScale(MathLib::Point inoldscale, ProjLib::Projection * in,
                ProjLib::Projection * out) throw(ProjectionException);
 
+//isAffinePair returns true if the two projections are the same except
+//for the units (in which case mapping one to the other is just a scale)
+bool isAffinePair(ProjLib::Projection * in, ProjLib::Projection * out)
+  throw();
+
+//isSeparablePair returns true if x in one projection only depends on x
+//in the other (and y on y), as with geographic and the cylindrical
+//projections on the same datum
+bool isSeparablePair(ProjLib::Projection * in, ProjLib::Projection * out)
+  throw();
+
+//getCentralMeridian gets the central meridian of a projection in
+//degrees.  Returns false if it doesn't have one.
+bool getCentralMeridian(ProjLib::Projection * proj, double & meridian)
+  throw();
+
 //Get the projection from a input file
 Projection * SetProjection(std::string parameterfile) throw();
 
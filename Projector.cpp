@@ -18,15 +18,22 @@
 
 #include <strstream>
 #include "Projector.h"
+#include "ChunkProjector.h"
+#include "ExtentSampler.h"
 #include "ImageLib/RGBPalette.h"
 #include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <iostream>
 
 //*********************************************************************
 Projector::Projector() : fromprojection(NULL), toprojection(NULL),
-infile(NULL), out(NULL), cache(NULL), 
+infile(NULL), out(NULL), cache(NULL), mapped(NULL),
 oldheight(0), oldwidth(0), newheight(0), newwidth(0),
-pmeshsize(4), pmeshname(0), outfile("out.tif"), 
-samescale(false), cachesize(CACHESIZE), packbits(false) 
+pmeshsize(4), pmeshname(0), maxerror(0.0), tilesize(0), meshgrid(NULL),
+fixedpoint(false), warpplan(NULL), shiftdatums(false), shiftgrid(NULL),
+outfile("out.tif"), samescale(false), cachesize(CACHESIZE), 
+cachepolicy(ROWCACHE_LRU), packbits(false) 
 {
   //init the scales
   oldscale.x = newscale.x = 0;
@@ -40,11 +47,13 @@ Projector::Projector(std::string & ininfile,
             const std::string & inoutfile) 
   throw (ProjectorException, std::bad_alloc)
   : fromprojection(NULL),
-    toprojection(NULL), infile(NULL), out(NULL), cache(NULL), 
+    toprojection(NULL), infile(NULL), out(NULL), cache(NULL), mapped(NULL),
     oldheight(0), 
     oldwidth(0), newheight(0), newwidth(0),
-    pmeshsize(4), pmeshname(0), outfile("out.tif"), samescale(false),
-    cachesize(CACHESIZE), packbits(false)
+    pmeshsize(4), pmeshname(0), maxerror(0.0), tilesize(0), meshgrid(NULL),
+    fixedpoint(false), warpplan(NULL), shiftdatums(false), shiftgrid(NULL),
+    outfile("out.tif"), samescale(false),
+    cachesize(CACHESIZE), cachepolicy(ROWCACHE_LRU), packbits(false)
 {
   oldscale.x = newscale.x = 0;                //initialize scale
   oldscale.y = newscale.y = 0;
@@ -63,11 +72,13 @@ Projector::Projector(std::string & ininfile,
             const std::string & inoutfile) 
   throw (ProjectorException, std::bad_alloc)
   : fromprojection(NULL),
-    toprojection(NULL), infile(NULL), out(NULL), cache(NULL), 
+    toprojection(NULL), infile(NULL), out(NULL), cache(NULL), mapped(NULL),
     oldheight(0), 
     oldwidth(0), newheight(0), newwidth(0),
-    pmeshsize(4), pmeshname(0), outfile("out.tif"), samescale(false),
-    cachesize(CACHESIZE), packbits(false)
+    pmeshsize(4), pmeshname(0), maxerror(0.0), tilesize(0), meshgrid(NULL),
+    fixedpoint(false), warpplan(NULL), shiftdatums(false), shiftgrid(NULL),
+    outfile("out.tif"), samescale(false),
+    cachesize(CACHESIZE), cachepolicy(ROWCACHE_LRU), packbits(false)
 {
   oldscale.x = newscale.x = 0;                //initialize scale
   oldscale.y = newscale.y = 0;
@@ -83,8 +94,12 @@ Projector::Projector(std::string & ininfile,
 Projector::~Projector()
 {
   delete cache;
+  delete mapped;
   delete toprojection;
   delete infile;
+  delete meshgrid;
+  delete warpplan;
+  delete shiftgrid;
 }
   
 
@@ -139,6 +154,36 @@ void Projector::setPmeshSize(const long int & inpmeshsize) throw()
   pmeshsize = inpmeshsize;  //set the pmesh size
 }
 
+//************************************************************************
+void Projector::setMaxError(const double & inmaxerror) throw()
+{
+  maxerror = inmaxerror;    //set the approximation error
+}
+
+//************************************************************************
+void Projector::setTileSize(const int & intilesize) throw()
+{
+  tilesize = intilesize;    //set the resampling tile size
+}
+
+//************************************************************************
+void Projector::setFixedPoint(bool infixedpoint) throw()
+{
+  fixedpoint = infixedpoint;
+}
+
+//************************************************************************
+void Projector::setShiftDatums(bool inshiftdatums) throw()
+{
+  shiftdatums = inshiftdatums;
+}
+
+//************************************************************************
+void Projector::setWarpPlanDir(const std::string & inplandir) throw()
+{
+  plandir = inplandir;
+}
+
 //***********************************************************************
 void Projector::setOutputScale(const MathLib::Point & innewscale) throw()
 {
@@ -156,6 +201,30 @@ void Projector::setSameScale(bool insamescale) throw()
 void Projector::setCacheSize(const unsigned int & incachesize) throw()
 {
   cachesize = incachesize;
+
+  try
+  {
+    if (infile)                           //resize the open one
+      setupCache();
+  }
+  catch(...)
+  {
+  }
+}
+
+//*********************************************************
+void Projector::setCachePolicy(int incachepolicy) throw()
+{
+  cachepolicy = incachepolicy;
+
+  try
+  {
+    if (infile)                           //redo the open one
+      setupCache();
+  }
+  catch(...)
+  {
+  }
 }
 
 
@@ -183,12 +252,66 @@ int Projector::getPmeshSize() const throw()
   return pmeshsize;     //return the square of the number of nodes
 }
 
+//**************************************************************
+double Projector::getMaxError() const throw()
+{
+  return maxerror;
+}
+
+//**************************************************************
+int Projector::getTileSize() const throw()
+{
+  return tilesize;
+}
+
+//**************************************************************
+bool Projector::getFixedPoint() const throw()
+{
+  return fixedpoint;
+}
+
+//**************************************************************
+bool Projector::getShiftDatums() const throw()
+{
+  return shiftdatums;
+}
+
+//**************************************************************
+std::string Projector::getWarpPlanDir() const throw()
+{
+  return plandir;
+}
+
+//**************************************************************
+long int Projector::getMeshNodeCount() const throw()
+{
+  return meshgrid ? meshgrid->getNodeCount() : 0;
+}
+
+//**************************************************************
+double Projector::getMeshMaxError() const throw()
+{
+  return meshgrid ? meshgrid->getMaxError() : 0.0;
+}
+
 //**************************************************************
 unsigned int Projector::getCacheSize() const throw()
 {
   return cachesize;
 }
 
+//**************************************************************
+int Projector::getCachePolicy() const throw()
+{
+  return cachepolicy;
+}
+
+//**************************************************************
+RowCacheStats Projector::getCacheStats() const throw()
+{
+  return cachestats;
+}
+
 //**************************************************************
 void Projector::setPackBits(const bool & inpackbits) throw()
 {
@@ -206,14 +329,15 @@ bool Projector::getPackBits() const throw()
 void Projector::project(BaseProgress * progress)
 throw(ProjectorException)
 {
-  double x, y;                                 //temp variables
-  long int _x, _y;                             //for world to pixel translation
-  tdata_t scanline = NULL;                     //output scanline
-  tdata_t inscanline = NULL;                   //input scanline
-  const unsigned char * cachescanline = NULL;  //scanline from cache
-  int sppcounter;                              //for colored images
+  unsigned char * buffer = NULL;               //output scanlines
+  InputRows * rows = NULL;                     //input scanlines
   PmeshLib::ProjectionMesh * pmesh = NULL;     //projection mesh
-  long int xcounter, ycounter;                 //counters for each direction
+  RowTransform * transform = NULL;             //row transform
+  Footprint * footprint = NULL;                //input outline
+  ChunkProjector * chunker = NULL;             //reprojects the lines
+  long int starty, endy, ycounter;             //counters for the rows
+  long int lines;                              //lines done at a time
+  const long int pixelbytes = spp*(bps/8);     //bytes per pixel
   try
   {
     if (!fromprojection || !toprojection)      //check for projections
@@ -226,22 +350,50 @@ throw(ProjectorException)
     
     setupOutput(outfile);                      //setup the output file
       
-    if (pmesh)                                 //check for existing pmesh
+    if (openWarpPlan())                        //a saved plan needs no mesh
     {
-      delete pmesh;                             
-      pmesh = setupReversePmesh();             //setup the reverse mesh
+      delete pmesh;
+      pmesh = NULL;
     }
-    
-    if (!(scanline = new (std::nothrow) unsigned char [newwidth*spp*(bps/8)]))
-      throw std::bad_alloc();
-            
-    if (!cache)
+    else
     {
-      if (!(inscanline = new (std::nothrow) 
-            unsigned char[oldwidth*spp*(bps/8)]))
-        throw std::bad_alloc();
+      if (pmesh)                               //check for existing pmesh
+      {
+        delete pmesh;                             
+        pmesh = setupReversePmesh();           //setup the reverse mesh
+      }
+
+      setupShiftGrid();                        //setup the datum shift
+      setupMeshGrid();                         //setup the adaptive mesh
     }
 
+    if (!(footprint = setupFootprint(pixelbytes, pmesh)))
+      throw std::bad_alloc();
+
+    buildWarpPlan(pmesh, footprint);           //save it for next time
+
+    //with tiles a band of lines a tile high is done at a time
+    lines = (tilesize > 0) ? tilesize : 1;
+    
+    if (!(buffer = new (std::nothrow) unsigned char 
+          [lines*newwidth*pixelbytes]))
+      throw std::bad_alloc();
+
+    if (!(transform = setupRowTransform(pmesh)))
+      throw std::bad_alloc();
+
+    if (!(rows = setupInputRows(static_cast<long int>(cachesize)*1048576L)))
+      throw std::bad_alloc();
+
+    if (!(chunker = new (std::nothrow) ChunkProjector
+          (transform, footprint, rows, getResampleFunc(bps, spp),
+           newwidth, oldwidth, oldheight, spp, pixelbytes, lines,
+           tilesize, (fixedpoint || warpplan) ?
+           getIndexResampleFunc(bps, spp) : NULL)))
+      throw std::bad_alloc();
+    transform = NULL;                          //owned by the chunker now
+    rows = NULL;
+
     //init the status progress
     if (progress)
     {
@@ -258,108 +410,36 @@ throw(ProjectorException)
     }
 
                                                //now start adding pixels
-    for (ycounter =0; ycounter < newheight; ycounter++)
+    for (starty = 0; starty < newheight; starty += lines)
     {
-      if (progress && !(ycounter % 29))     //check for output status func
-        progress->update(ycounter);
-      
-      
-      for (xcounter = 0; xcounter < newwidth; xcounter++)
-      {   
-                                               //get the new x and y pixel
-        x = outRect.left + newscale.x * xcounter;
-        y = outRect.top  - newscale.y * ycounter;
-        
-        
-        if (pmesh)                             //now get the old pixel
-          pmesh->projectPoint(x, y);
-        else
-        {
-          toprojection->projectToGeo(x, y, y, x);
-          fromprojection->projectFromGeo(y, x, x, y);
-        }
-        
-        _x = static_cast<long int>((x - inRect.left) / 
-                                   (oldscale.x) + 0.5);
-        _y = static_cast<long int>((inRect.top - y) / 
-                                   (oldscale.y) + 0.5);
-        /*if (_x >= oldwidth)
-          _x = _x - 1;
-          else
-          if (_x < 0)
-          _x = 0;
-          if (_y >= oldheight)
-          _y = _y -1;
-          else
-          if (_y < 0)
-          _y = 0;*/
-        if ((_x >= oldwidth) || (_x < 0) || (_y >= oldheight) 
-            || (_y < 0))
-        {
-          if (bps != 16) //8bits per sample
-          {
-            for (sppcounter = 0; sppcounter < spp; sppcounter++)
-              reinterpret_cast<unsigned char *>(scanline)
-                [xcounter*spp + sppcounter] = 0; //out of bounds pixel
-          }
-          else//16 bits per sample
-          {
-             for (sppcounter = 0; sppcounter < spp; sppcounter++)
-              reinterpret_cast<uint16 *>(scanline)
-                [xcounter*spp + sppcounter] = 0; //out of bounds pixel
-          }
-        }
-        else
-        {
-          if (cache) //8bits per sample
-          {
-            cachescanline = cache->getRawScanline(_y); //get a pointer to cache
-            for (sppcounter = 0; sppcounter < spp; sppcounter++)
-              reinterpret_cast<unsigned char *>(scanline)
-                [xcounter*spp + sppcounter ] = 
-                cachescanline[_x*spp + sppcounter];       //copy pixels
-          }
-          else//no cache
-          {
-            if (bps == 16)
-            {
-              dynamic_cast<USGSImageLib::TIFFImageIFile*>(infile)
-                ->getRawScanline(_y, inscanline);
-              for (sppcounter = 0; sppcounter < spp; sppcounter++)
-                reinterpret_cast<uint16*>(scanline)
-                  [xcounter*spp + sppcounter] = 
-                  reinterpret_cast<uint16 *>(inscanline)
-                  [_x*spp + sppcounter];
-            }
-            else
-            {
-              infile->
-                getRawScanline(_y, reinterpret_cast<unsigned char *>
-                               (inscanline));
-              for (sppcounter = 0; sppcounter < spp; sppcounter++)
-                reinterpret_cast<unsigned char *>(scanline)
-                  [xcounter*spp + sppcounter ] = 
-                  reinterpret_cast<unsigned char*>(inscanline)
-                  [_x*spp + sppcounter];       //copy pixels
-            }
-          }
-            
-        }
-        
+      endy = starty + lines - 1;
+      if (endy >= newheight)
+        endy = newheight - 1;
+
+      chunker->project(starty, endy, buffer);     //get the new pixels
+
+      for (ycounter = starty; ycounter <= endy; ++ycounter)
+      {
+        if (progress && !(ycounter % 29))   //check for output status func
+          progress->update(ycounter);
+
+        out->putRawScanline(ycounter, &(buffer[newwidth*pixelbytes*
+                                               (ycounter - starty)]));
       }
-      out->putRawScanline(ycounter, scanline);       //write out scanlines
     }
     
     //finsh the progress
     if (progress)
       progress->done();
 
+    if (cache)                                       //how the cache did
+      cachestats = cache->getStats();
 
     writer.removeImage(0);                           //flush the output file
     out = NULL;
-    delete [] reinterpret_cast<unsigned char *>(scanline);  
-    delete [] reinterpret_cast<unsigned char *>(inscanline);
-    //delete the scanline
+    delete [] buffer;                                //delete the scanlines
+    delete chunker;
+    delete footprint;
     delete pmesh;                                    //delete the pmesh
   }
   catch(ProjectorException & temp)
@@ -368,9 +448,11 @@ throw(ProjectorException)
   }
   catch(...)
   {
-    delete [] reinterpret_cast<unsigned char *>(scanline);
-                             //delete the scanline
-    delete [] reinterpret_cast<unsigned char *>(inscanline);
+    delete [] buffer;                                //delete the scanlines
+    delete chunker;
+    delete rows;
+    delete transform;
+    delete footprint;
     delete pmesh;                                    //delete the pmesh
     writer.removeImage(0);                           //flush output file
     throw ProjectorException(PROJECTOR_ERROR_UNKOWN);
@@ -465,41 +547,18 @@ void Projector::setupInput(std::string & ininfile) throw(ProjectorException)
     infile->getBitsPerSample(bps);
     infile->getPhotometric(photo);    
     
-    //check for preexisting cache
-    if (cache)
-      delete cache;
-    cache = NULL;
-    
-  
-    if ((bps == 8) && cachesize) //check for 16 bit tiffs that can't use cache
+    //uncompressed inputs are used in place instead of through the cache
+    delete mapped;
+    mapped = NULL;
+    if (!(mapped = new (std::nothrow) MappedInput))
+      throw std::bad_alloc();
+    if (!mapped->open(ininfile, oldwidth, oldheight, spp, bps))
     {
-      /*
-      //figure out the number lines to cache
-      nlines = static_cast<unsigned int>((static_cast<double>(cachesize))/
-        (static_cast<double>(bps*spp*oldwidth)/8388608.0));
-      //check to see if the cache is larger than image size
-      if (nlines > static_cast<unsigned int>(oldheight))
-        nlines = oldheight;
-
+      delete mapped;
+      mapped = NULL;
+    }
 
-      //check to see if the cache is now zero (really big image!) 
-      if (nlines != 0)
-      {
-        //create the cache for the file
-        if (!(cache = new(std::nothrow) USGSImageLib::CacheManager
-              (infile, nlines/2, true)))
-          throw std::bad_alloc();
-        if (!cache->good())
-        {
-          //can't open the cache so delete it and set default cache
-          delete cache;
-          cache = NULL; //set it to NULL
-        }
-        }*/
-      if (!(cache = new (std::nothrow) USGSImageLib::LRUCacheManager
-            (infile, 1000)))
-        throw std::bad_alloc();
-    } 
+    setupCache();                     //size the cache for the input
       
     //set the dimensions
     inRect.right = inRect.left + oldscale.x * oldwidth;
@@ -510,10 +569,31 @@ void Projector::setupInput(std::string & ininfile) throw(ProjectorException)
   {
     delete infile;                  //delete stuff and rethrow        
     delete cache;
+    cache = NULL;
+    delete mapped;
+    mapped = NULL;
     throw ProjectorException(PROJECTOR_UNABLE_INPUT_SETUP);
   }
 }
 
+//**********************************************************
+void Projector::setupCache() throw(std::bad_alloc)
+{
+  delete cache;                                //get rid of the old one
+  cache = NULL;
+
+  if (mapped || !cachesize)
+    return;
+
+  if (!(cache = new (std::nothrow) RowCache(infile, bps,
+                                            oldwidth*spp*(bps/8),
+                                            oldheight,
+                                            static_cast<long int>
+                                            (cachesize)*1048576L,
+                                            cachepolicy)))
+    throw std::bad_alloc();
+}
+
 //***********************************************************************
 void Projector::setupOutput(std::string & inoutfile) throw(ProjectorException)
 {
@@ -578,7 +658,9 @@ PmeshLib::ProjectionMesh * Projector::setupForwardPmesh() throw()
   
   try
   {
-    if (pmeshname != 0)
+    //no mesh is needed when the mapping is affine
+    if (pmeshname != 0 && pmeshname != PMESH_ADAPTIVE &&
+        !isAffinePair(fromprojection, toprojection) && !isShifted())
     {
       if(!(ret = new (std::nothrow) PmeshLib::ProjectionMesh))
         throw std::bad_alloc();
@@ -608,7 +690,10 @@ PmeshLib::ProjectionMesh * Projector::setupReversePmesh() throw()
   
   try
   {
-    if (pmeshname != 0)
+    //no mesh is needed when the mapping is affine or separable
+    if (pmeshname != 0 && pmeshname != PMESH_ADAPTIVE &&
+        !isAffinePair(fromprojection, toprojection) &&
+        !isSeparablePair(fromprojection, toprojection) && !isShifted())
     {
       if(!(ret = new (std::nothrow) PmeshLib::ProjectionMesh))
         throw std::bad_alloc();
@@ -633,12 +718,423 @@ PmeshLib::ProjectionMesh * Projector::setupReversePmesh() throw()
 }
 
 
+//*********************************************************************
+void Projector::setupMeshGrid() throw(std::bad_alloc)
+{
+  delete meshgrid;                                //get rid of the old one
+  meshgrid = NULL;
+
+  //the affine and separable transforms are better than any mesh.  A
+  //pmesh would leave out the datum shift so this is used instead.
+  if (!pmeshname || ((pmeshname != PMESH_ADAPTIVE) && !isShifted()) ||
+      isAffinePair(fromprojection, toprojection) ||
+      isSeparablePair(fromprojection, toprojection))
+    return;
+
+  if (pmeshname != PMESH_ADAPTIVE)
+    std::cerr << "Warning: a pmesh can't shift between datums so the "
+              << "adaptive mesh is used instead." << std::endl;
+
+  ExactRowTransform exact(outRect, newscale, inRect, oldscale,
+                          toprojection, fromprojection,
+                          getShift(toprojection, fromprojection), shiftgrid);
+
+  if (!(meshgrid = new (std::nothrow) MeshGrid))
+    throw std::bad_alloc();
+
+  try
+  {
+    meshgrid->calculate(exact, newwidth, newheight,
+                        (maxerror > 0.0) ? maxerror : ADAPTIVE_TOLERANCE);
+  }
+  catch(...)
+  {
+    delete meshgrid;
+    meshgrid = NULL;
+    throw std::bad_alloc();
+  }
+}
+
+//*********************************************************************
+bool Projector::isShifted() const throw()
+{
+  return getShift(toprojection, fromprojection).good();
+}
+
+//*********************************************************************
+DatumShift Projector::getShift(ProjLib::Projection * from,
+                               ProjLib::Projection * to) const throw()
+{
+  if (!shiftdatums)
+    return DatumShift();
+  return DatumShift(from->getDatum(), to->getDatum());
+}
+
+//*********************************************************************
+void Projector::setupShiftGrid() throw(std::bad_alloc)
+{
+  const DatumShift shift = getShift(toprojection, fromprojection);
+
+  delete shiftgrid;                               //get rid of the old one
+  shiftgrid = NULL;
+
+  if (!shift.good())
+    return;
+
+  if (!(shiftgrid = new (std::nothrow) DatumShiftGrid))
+    throw std::bad_alloc();
+
+  try
+  {
+    shiftgrid->calculate(toprojection, shift, outRect, newscale,
+                         newwidth, newheight);
+  }
+  catch(...)
+  {
+    delete shiftgrid;
+    shiftgrid = NULL;
+    throw std::bad_alloc();
+  }
+}
+
+//*********************************************************************
+static unsigned long long int hashParams(ProjLib::Projection * proj,
+                                         unsigned long long int key)
+  throw(ProjectorException)
+{
+  ProjectionParams params;
+
+  //getParams doesn't do geographic, which only has these anyway
+  if (proj && (proj->getProjectionSystem() == ProjLib::GEO))
+  {
+    params.projtype = proj->getProjectionSystem();
+    params.datum = proj->getDatum();
+    params.unit = proj->getUnit();
+  }
+  else
+    params = getParams(proj);
+
+  const int types[3] = {params.projtype, params.datum, params.unit};
+  const double values[18] = {params.StdParallel1, params.StdParallel2,
+                             params.NatOriginLong, params.NatOriginLat,
+                             params.FalseOriginLong, params.FalseOriginLat,
+                             params.FalseOriginEasting,
+                             params.FalseOriginNorthing,
+                             params.CenterLong, params.CenterLat,
+                             params.CenterEasting, params.CenterNorthing,
+                             params.ScaleAtNatOrigin, params.AzimuthAngle,
+                             params.StraightVertPoleLong,
+                             params.FalseEasting, params.FalseNorthing,
+                             static_cast<double>(params.zone)};
+
+  key = WarpPlan::hash(types, sizeof(types), key);
+  return WarpPlan::hash(values, sizeof(values), key);
+}
+
+//*********************************************************************
+unsigned long long int Projector::getWarpPlanKey()
+  throw(ProjectorException)
+{
+  const long int sizes[5] = {WARPPLAN_VERSION, oldwidth, oldheight,
+                             newwidth, newheight};
+  const double grids[12] = {inRect.left, inRect.top, inRect.right,
+                            inRect.bottom, oldscale.x, oldscale.y,
+                            outRect.left, outRect.top, outRect.right,
+                            outRect.bottom, newscale.x, newscale.y};
+  //the mesh and datum settings change the mapping too
+  const int meshes[3] = {pmeshname, pmeshsize, shiftdatums ? 1 : 0};
+  unsigned long long int key(WarpPlan::hash(0, 0, 0));
+
+  key = hashParams(fromprojection, key);
+  key = hashParams(toprojection, key);
+  key = WarpPlan::hash(sizes, sizeof(sizes), key);
+  key = WarpPlan::hash(grids, sizeof(grids), key);
+  key = WarpPlan::hash(meshes, sizeof(meshes), key);
+  return WarpPlan::hash(&maxerror, sizeof(maxerror), key);
+}
+
+//*********************************************************************
+bool Projector::openWarpPlan() throw()
+{
+  unsigned long long int key;
+  char name[20];                                  //the key in hex
+
+  delete warpplan;                                //close the old one
+  warpplan = NULL;
+
+  if (plandir.empty())
+    return false;
+
+  try
+  {
+    key = getWarpPlanKey();
+    std::sprintf(name, "%016llx", key);
+
+    if (!(warpplan = new (std::nothrow) WarpPlan))
+      throw std::bad_alloc();
+
+    if (!warpplan->open(plandir + "/" + name + WARPPLAN_EXT, key,
+                        newwidth, newheight, oldwidth, oldheight))
+      throw std::bad_alloc();
+
+    return true;
+  }
+  catch(...)
+  {
+    delete warpplan;
+    warpplan = NULL;
+    return false;
+  }
+}
+
+//*********************************************************************
+void Projector::buildWarpPlan(PmeshLib::ProjectionMesh * pmesh,
+                              Footprint * footprint) throw()
+{
+  RowTransform * transform = NULL;                //the mapping
+  Footprint * ownfootprint = NULL;                //made here
+  const long int pixelbytes = spp*(bps/8);        //bytes per pixel
+  unsigned long long int key;
+  char name[20];                                  //the key in hex
+
+  if (plandir.empty() || warpplan)
+    return;
+
+  try
+  {
+    key = getWarpPlanKey();
+    std::sprintf(name, "%016llx", key);
+
+    if (!footprint &&
+        !(footprint = ownfootprint = setupFootprint(pixelbytes, pmesh)))
+      throw std::bad_alloc();
+
+    if (!(transform = setupRowTransform(pmesh)))
+      throw std::bad_alloc();
+
+    if (WarpPlan::build(plandir + "/" + name + WARPPLAN_EXT, key,
+                        *transform, *footprint, newwidth, newheight,
+                        oldwidth, oldheight, pixelbytes,
+                        getMappingError(pmesh)))
+      openWarpPlan();
+
+    delete transform;
+    delete ownfootprint;
+  }
+  catch(...)
+  {
+    //just go on without a plan
+    delete transform;
+    delete ownfootprint;
+  }
+}
+
+//*********************************************************************
+RowTransform * Projector::setupRowTransform(PmeshLib::ProjectionMesh * pmesh,
+                                            ProjLib::Projection * to,
+                                            ProjLib::Projection * from)
+  throw()
+{
+  RowTransform * ret = NULL;                      //return transform
+  RowTransform * exact = NULL;                    //exact transform
+  AffineRowTransform * affine = NULL;             //affine transform
+  SeparableRowTransform * separable = NULL;       //separable transform
+
+  if (!to)
+    to = toprojection;
+  if (!from)
+    from = fromprojection;
+
+  //a saved plan already has the whole mapping
+  if (warpplan)
+    return new (std::nothrow) PlanRowTransform(outRect, newscale,
+                                               inRect, oldscale, warpplan);
+
+  //projections that only differ by units don't need to be projected
+  if (isAffinePair(from, to))
+  {
+    affine = new (std::nothrow) AffineRowTransform(outRect, newscale,
+                                                   inRect, oldscale,
+                                                   to, from);
+    if (affine && affine->good())
+      return affine;
+    delete affine;
+  }
+
+  //projections with separate axes are done from a table for each
+  if (isSeparablePair(from, to))
+  {
+    try
+    {
+      separable = new (std::nothrow) SeparableRowTransform
+        (outRect, newscale, inRect, oldscale, newwidth, newheight, to, from);
+    }
+    catch(...)
+    {
+      separable = NULL;
+    }
+    if (separable && separable->good())
+      return separable;
+    delete separable;
+  }
+
+  if (meshgrid)
+    return new (std::nothrow) GridRowTransform(outRect, newscale,
+                                               inRect, oldscale, meshgrid);
+
+  if (pmesh)
+    return new (std::nothrow) MeshRowTransform(outRect, newscale,
+                                               inRect, oldscale, pmesh);
+
+  if (!(exact = new (std::nothrow) ExactRowTransform(outRect, newscale,
+                                                     inRect, oldscale,
+                                                     to, from,
+                                                     getShift(to, from),
+                                                     shiftgrid)))
+    return NULL;
+
+  if (maxerror <= 0.0)
+    return exact;
+
+  //wrap the exact transform in the approximating one
+  if (!(ret = new (std::nothrow) ApproxRowTransform(outRect, newscale,
+                                                    inRect, oldscale,
+                                                    exact, maxerror)))
+    delete exact;
+  return ret;
+}
+
+
+//*********************************************************************
+Footprint * Projector::setupFootprint(long int pixelbytes,
+                                      PmeshLib::ProjectionMesh * pmesh)
+  throw()
+{
+  Footprint * ret = NULL;                         //return footprint
+
+  try
+  {
+    if (!(ret = new (std::nothrow) Footprint(inRect, oldscale,
+                                             oldwidth, oldheight,
+                                             outRect, newscale,
+                                             newwidth, newheight,
+                                             pixelbytes)))
+      throw std::bad_alloc();
+
+    //if the outline can't be found the rows just aren't clipped
+    ret->calculate(fromprojection, toprojection,
+                   getShift(fromprojection, toprojection),
+                   getMappingError(pmesh));
+    return ret;
+  }
+  catch(...)
+  {
+    delete ret;
+    ret = NULL;
+    return ret;
+  }
+}
+
+//*********************************************************************
+double Projector::getMappingError(PmeshLib::ProjectionMesh * pmesh) throw()
+{
+  const double tolerance = (maxerror > 0.0) ? maxerror
+    : ADAPTIVE_TOLERANCE;
+  const double dwidth = static_cast<double>(oldwidth);
+  const double dheight = static_cast<double>(oldheight);
+  double meshx, meshy, exactx, exacty;            //one point both ways
+  double ret(0.0);                                //most error found
+  long int xcounter, ycounter;
+
+  if (warpplan)
+    return warpplan->getError();
+
+  if (isAffinePair(fromprojection, toprojection) ||
+      isSeparablePair(fromprojection, toprojection))
+    return 0.0;
+
+  //the adaptive mesh keeps to its tolerance except in the smallest
+  //cells
+  if (meshgrid)
+    return (meshgrid->getMaxError() > tolerance) ? meshgrid->getMaxError()
+      : tolerance;
+
+  if (!pmesh)
+    return maxerror;
+
+  //a pmesh has no bound so it is compared to the exact projection on
+  //a grid over the output (just where both land on the input)
+  try
+  {
+    MeshRowTransform mesh(outRect, newscale, inRect, oldscale, pmesh);
+    ExactRowTransform exact(outRect, newscale, inRect, oldscale,
+                            toprojection, fromprojection,
+                            getShift(toprojection, fromprojection),
+                            shiftgrid);
+
+    for (ycounter = 0; ycounter <= PROJECTOR_ERRORSAMPLES; ++ycounter)
+      for (xcounter = 0; xcounter <= PROJECTOR_ERRORSAMPLES; ++xcounter)
+      {
+        mesh.projectRow((newheight - 1)*ycounter/PROJECTOR_ERRORSAMPLES,
+                        (newwidth - 1)*xcounter/PROJECTOR_ERRORSAMPLES,
+                        1, &meshx, &meshy);
+        exact.projectRow((newheight - 1)*ycounter/PROJECTOR_ERRORSAMPLES,
+                         (newwidth - 1)*xcounter/PROJECTOR_ERRORSAMPLES,
+                         1, &exactx, &exacty);
+
+        if (!(exactx > -1.0) || !(exactx < dwidth) ||
+            !(exacty > -1.0) || !(exacty < dheight) ||
+            !(std::fabs(meshx) < 1e9) || !(std::fabs(meshy) < 1e9))
+          continue;
+
+        if (std::fabs(meshx - exactx) > ret)
+          ret = std::fabs(meshx - exactx);
+        if (std::fabs(meshy - exacty) > ret)
+          ret = std::fabs(meshy - exacty);
+      }
+  }
+  catch(...)
+  {
+    return tolerance;
+  }
+
+  return ret;
+}
+
+//*********************************************************************
+InputRows * Projector::setupInputRows(long int pinbytes) throw()
+{
+  InputRows * ret = NULL;                         //return rows
+  const long int rowbytes = oldwidth*spp*(bps/8); //bytes in an input row
+
+  try
+  {
+    if (mapped)
+    {
+      if (!(ret = new (std::nothrow) MappedInputRows(mapped, rowbytes)))
+        throw std::bad_alloc();
+    }
+    else if (!(ret = new (std::nothrow) InputRows(infile, cache, bps,
+                                                   rowbytes, oldheight,
+                                                   pinbytes)))
+      throw std::bad_alloc();
+
+    return ret;
+  }
+  catch(...)
+  {
+    delete ret;
+    ret = NULL;
+    return ret;
+  }
+}
+
 
 //**********************************************************************
 void Projector::getExtents(PmeshLib::ProjectionMesh * pmesh) throw(ProjectorException)
 {
-  std::vector<double> xarr, yarr;     //vectors for sorting
-  long int xcounter(0), ycounter(0);  //counters for loops
+  EdgeBounds bounds;                  //running min and max
+  long int counter(0);                //counter for loops
   double tempx(0), tempy(0);          //temp-o-vars
 
   try
@@ -650,89 +1146,41 @@ void Projector::getExtents(PmeshLib::ProjectionMesh * pmesh) throw(ProjectorExce
     if (!toprojection || !fromprojection)
       throw ProjectorException(PROJECTOR_PROJECTION);
     
-    //make room in the vector for the edges
-    xarr.resize(2*(oldwidth+oldheight));
-    yarr.resize(2*(oldheight + oldwidth));
-    
-    //now we should be good to go
-    for (xcounter = 0; xcounter < oldwidth; xcounter++)
+    if (!pmesh && isAffinePair(fromprojection, toprojection))
     {
-      //reproject the top line
-      tempx = inRect.left + oldscale.x*xcounter;
-      tempy = inRect.top;
-      if (pmesh)
-        pmesh->projectPoint(tempx, tempy);
-      else
-      {
-        fromprojection->projectToGeo(tempx, tempy, tempy, tempx);
-        toprojection->projectFromGeo(tempy, tempx, tempx, tempy);
-      }
-      xarr[xcounter] = tempx;
-      yarr[xcounter] = tempy;
-      
-      //reproject the bottom line
-      tempx = inRect.left + oldscale.x*xcounter;
-      tempy = inRect.bottom;
-      if (pmesh)
-        pmesh->projectPoint(tempx, tempy);
-      else
+      //the edges stay straight lines so only their ends are needed
+      const double lastx = inRect.left + oldscale.x*(oldwidth - 1);
+      const double lasty = inRect.top - oldscale.y*(oldheight - 1);
+      const double endx[8] = {inRect.left, lastx, inRect.left, lastx,
+                              inRect.left, inRect.left,
+                              inRect.right, inRect.right};
+      const double endy[8] = {inRect.top, inRect.top,
+                              inRect.bottom, inRect.bottom,
+                              inRect.top, lasty, inRect.top, lasty};
+
+      for (counter = 0; counter < 8; counter++)
       {
+        tempx = endx[counter];
+        tempy = endy[counter];
         fromprojection->projectToGeo(tempx, tempy, tempy, tempx);
         toprojection->projectFromGeo(tempy, tempx, tempx, tempy);
+        bounds.add(tempx, tempy);
       }
-      xarr[xcounter + oldwidth] = tempx;
-      yarr[xcounter + oldwidth] = tempy;
     }
-    
-    //now do the height
-    for (ycounter = 0; ycounter < oldheight; ycounter++)
+    else
     {
-      //reproject the left line
-      tempy = inRect.top - oldscale.y * ycounter;
-      tempx = inRect.left;
-      if (pmesh)
-        pmesh->projectPoint(tempx, tempy);
-      else
-      {
-        fromprojection->projectToGeo(tempx, tempy, tempy, tempx);
-        toprojection->projectFromGeo(tempy, tempx, tempx, tempy);
-      }
-      xarr[ycounter + 2*oldwidth] = tempx;
-      yarr[ycounter + 2*oldwidth] = tempy;
-      
-      //reproject the right line
-      tempy = inRect.top - oldscale.y * ycounter;
-      tempx = inRect.right;
-      if (pmesh)
-        pmesh->projectPoint(tempx, tempy);
-      else
+      ExtentSampler sampler(inRect, oldscale, oldwidth, oldheight);
+
+      if (pmesh || !sampler.sample(fromprojection, toprojection,
+                                   getShift(fromprojection, toprojection),
+                                   bounds))
       {
-        fromprojection->projectToGeo(tempx, tempy, tempy, tempx);
-        toprojection->projectFromGeo(tempy, tempx, tempx, tempy);
+        bounds = EdgeBounds();
+        walkEdges(pmesh, bounds);
       }
-      xarr[ycounter + 2*oldwidth + oldheight] = tempx;
-      yarr[ycounter + 2*oldwidth + oldheight] = tempy;
     }
-    
-    
-    //get the min and max of the coordinates
-    getMinMax(xarr, outRect.left, outRect.right);
-    getMinMax(yarr, outRect.bottom, outRect.top);
-    
-    
-    if (samescale)
-      newscale = getSameScale(oldscale, fromprojection, toprojection);
-    
-    //get the new scale
-    if (!newscale.x || !newscale.y)
-      newscale = GetConvertedScale(oldwidth,oldheight,outRect);
-    
-    //get the new pixel width and height
-    newwidth  = static_cast<long int>
-      ((outRect.right - outRect.left)/(newscale.x) + 0.5);
-    newheight = static_cast<long int>
-      ((outRect.top - outRect.bottom)/(newscale.y) + 0.5);
 
+    setExtents(bounds);
   }
   catch(ProjectorException & temp)
   {
@@ -744,6 +1192,88 @@ void Projector::getExtents(PmeshLib::ProjectionMesh * pmesh) throw(ProjectorExce
   }
 }
 
+//**********************************************************************
+void Projector::walkEdges(PmeshLib::ProjectionMesh * pmesh,
+                          EdgeBounds & bounds) throw(ProjectorException)
+{
+  projectEdges(pmesh, fromprojection, toprojection, 0,
+               2*(oldwidth + oldheight), bounds);
+}
+
+//**********************************************************************
+void Projector::projectEdges(PmeshLib::ProjectionMesh * pmesh,
+                             ProjLib::Projection * from,
+                             ProjLib::Projection * to,
+                             long int first, long int last,
+                             EdgeBounds & bounds) const throw()
+{
+  const DatumShift shift = getShift(from, to);
+  long int counter, offset;           //the edge pixel and where it is
+  double tempx, tempy;
+
+  for (counter = first; counter < last; ++counter)
+  {
+    if (counter < 2*oldwidth)         //top then bottom row
+    {
+      offset = counter % oldwidth;
+      tempx = inRect.left + oldscale.x*offset;
+      tempy = (counter < oldwidth) ? inRect.top : inRect.bottom;
+    }
+    else                              //left then right column
+    {
+      offset = (counter - 2*oldwidth) % oldheight;
+      tempy = inRect.top - oldscale.y*offset;
+      tempx = (counter < 2*oldwidth + oldheight) ? inRect.left
+        : inRect.right;
+    }
+
+    if (pmesh)
+      pmesh->projectPoint(tempx, tempy);
+    else
+    {
+      from->projectToGeo(tempx, tempy, tempy, tempx);
+      shift.shift(tempx, tempy);
+      to->projectFromGeo(tempy, tempx, tempx, tempy);
+    }
+    bounds.add(tempx, tempy);
+  }
+}
+
+//**********************************************************************
+void Projector::setExtents(const EdgeBounds & bounds)
+  throw(ProjectorException)
+{
+  if (!bounds.count)                  //nothing on the edge projected
+    throw ProjectorException(PROJECTOR_UNABLE_OUTPUT_SETUP);
+
+  outRect.left = bounds.minx;
+  outRect.right = bounds.maxx;
+  outRect.bottom = bounds.miny;
+  outRect.top = bounds.maxy;
+
+  if (samescale)
+  {
+    try
+    {
+      newscale = getSameScale(oldscale, fromprojection, toprojection);
+    }
+    catch(...)
+    {
+      throw ProjectorException(PROJECTOR_UNABLE_OUTPUT_SETUP);
+    }
+  }
+    
+  //get the new scale
+  if (!newscale.x || !newscale.y)
+    newscale = GetConvertedScale(oldwidth,oldheight,outRect);
+    
+  //get the new pixel width and height
+  newwidth  = static_cast<long int>
+    ((outRect.right - outRect.left)/(newscale.x) + 0.5);
+  newheight = static_cast<long int>
+    ((outRect.top - outRect.bottom)/(newscale.y) + 0.5);
+}
+
 #endif
 
 
@@ -15,7 +15,6 @@
 #include "ImageLib/DOQImageIFile.h"
 #include "ImageLib/GeoTIFFImageOFile.h"
 #include "ImageLib/GeoTIFFImageIFile.h"
-#include "ImageLib/LRUCacheManager.h"
 #include "ProjectionIO/ProjectionReader.h"
 #include "ProjectionIO/ProjectionWriter.h"
 #include "ProjectionMesh/ProjectionMesh.h"
@@ -23,10 +22,20 @@
 #include "ProjectorException.h"
 #include "ProjectionParams.h"
 #include "BaseProgress.h"
+#include "RowTransform.h"
+#include "ResampleKernel.h"
+#include "Footprint.h"
+#include "WarpPlan.h"
+#include "DatumShift.h"
+#include "InputRows.h"
 
 
 #define CACHESIZE 100    //default is to try to cache 100 mbs of memory
 
+#define PMESH_ADAPTIVE 20         //pmeshname for the adaptive mesh
+#define ADAPTIVE_TOLERANCE 0.125  //default adaptive mesh error in pixels
+#define PROJECTOR_ERRORSAMPLES 32 //grid a pmesh's error is measured on
+
 
 //Reprojection object, converts one file to another
 class Projector
@@ -53,6 +62,37 @@ public:
   void setOutputFileName(const std::string& inoutfile) throw();
   void setPmeshName(const int & inpmeshname) throw();
   void setPmeshSize(const long int & inpmeshsize) throw();
+
+  //This function sets the maximum error (in input pixels) allowed when
+  //no pmesh is used.  If it is greater than zero then only a few
+  //points on each scanline are projected exactly and the rest are
+  //linearly interpolated.  Default is 0 (project every pixel).
+  //With the adaptive pmesh (PMESH_ADAPTIVE) it is the error the mesh
+  //is refined to (0 uses ADAPTIVE_TOLERANCE).
+  void setMaxError(const double & inmaxerror) throw();
+
+  //This function sets the size of the square output tiles the pixels
+  //are resampled in.  Tiles keep rotated or skewed output on a few
+  //input rows at a time.  Default is 0 (a scanline at a time).
+  void setTileSize(const int & intilesize) throw();
+
+  //This function turns on fixed point stepping for the adaptive pmesh.
+  //Pixels are found with integer adds and shifts instead of doubles;
+  //see MeshGrid.h for how far off that can be.  Default is false.
+  void setFixedPoint(bool infixedpoint) throw();
+
+  //This function sets the directory warp plans are saved in.  A job
+  //with the same projections, input and output grids and pmesh
+  //settings as one saved there reads its mapping from the plan instead
+  //of projecting.  Default is "" (no plans).
+  void setWarpPlanDir(const std::string & inplandir) throw();
+
+  //This function turns on shifting between datums (NAD27, NAD83, WGS 72
+  //and WGS 84, see DatumShift.h) when the input and output are on
+  //different ones.  The projection library doesn't shift so without it
+  //only the spheroids differ.  A pmesh can't shift so the adaptive
+  //pmesh is used in its place.  Default is false.
+  void setShiftDatums(bool inshiftdatums) throw();
   void setOutputScale(const MathLib::Point & innewscale) throw(); 
   
   //This function allows the user to set the cache size
@@ -60,6 +100,12 @@ public:
   //add 3/6/01 by Chris Bilderback
   void setCacheSize(const unsigned int & incachesize) throw();
 
+  //This function sets how the cache picks a row to throw out when it
+  //is full (ROWCACHE_LRU or ROWCACHE_WINDOW, see RowCache.h).  The
+  //slaves share one cache per node with ROWCACHE_SHARED.
+  //Default is ROWCACHE_LRU.
+  void setCachePolicy(int incachepolicy) throw();
+
   //This function allows the user to specify that the output tiff
   //should be compressed with packbits compression.
   //Default is false.
@@ -78,7 +124,22 @@ public:
   ProjectionParams getOutputProjectionParams() const throw();
   int getPmeshName() const throw();
   int getPmeshSize() const throw();
+  double getMaxError() const throw();
+  int getTileSize() const throw();
+  bool getFixedPoint() const throw();
+  std::string getWarpPlanDir() const throw();
+  bool getShiftDatums() const throw();
+
+  //These return the points projected for and the largest error of the
+  //adaptive pmesh from the last projection (0 if there wasn't one)
+  long int getMeshNodeCount() const throw();
+  double getMeshMaxError() const throw();
   unsigned int getCacheSize() const throw();
+  int getCachePolicy() const throw();
+
+  //This returns the input cache hits, misses and evictions of the last
+  //projection (added up over the slaves)
+  RowCacheStats getCacheStats() const throw();
   bool getPackBits() const throw();
 
   //main function which runs the projection
@@ -93,20 +154,100 @@ protected:
   //setup the output file
   void setupOutput(std::string & inoutfile) throw(ProjectorException);
 
-  //setup the pmesh 
+  //setup the input cache for the open input (and delete any old one).
+  //Mapped inputs and a cachesize of 0 get no cache.
+  void setupCache() throw(std::bad_alloc);
+
+  //setup the pmesh.  A pmesh can't shift datums so there is none when
+  //the projections are on different ones.
   PmeshLib::ProjectionMesh * setupForwardPmesh() throw();
   PmeshLib::ProjectionMesh * setupReversePmesh() throw();
 
-  //getExtents function gets the new bounding rectangle for the new image
+  //setup the adaptive mesh if it is being used (and delete any old one).
+  //It stands in for a pmesh that is asked for when datums are shifted.
+  void setupMeshGrid() throw(std::bad_alloc);
+
+  //isShifted returns true if datums are shifted and the projections
+  //are on different ones
+  bool isShifted() const throw();
+
+  //getShift returns the shift from the datum of from to the datum of
+  //to, which doesn't shift unless datums are shifted
+  DatumShift getShift(ProjLib::Projection * from,
+                      ProjLib::Projection * to) const throw();
+
+  //setup the datum shift grid if the projections are on different
+  //datums (and delete any old one).  Has to be before anything that
+  //projects exactly from the output.
+  void setupShiftGrid() throw(std::bad_alloc);
+
+  //openWarpPlan maps the saved plan for this job if there is one (and
+  //closes any old one).  Returns true if it did.
+  bool openWarpPlan() throw();
+
+  //buildWarpPlan saves a plan for this job and opens it, if plans are
+  //on and there isn't one open.  pmesh is the reverse mesh (or NULL)
+  //and footprint can be NULL to use a new one.
+  void buildWarpPlan(PmeshLib::ProjectionMesh * pmesh,
+                     Footprint * footprint) throw();
+
+  //getWarpPlanKey hashes everything the mapping depends on
+  unsigned long long int getWarpPlanKey() throw(ProjectorException);
+
+  //setup the row transform used by the reprojection loops. If pmesh is
+  //not NULL it must be the reverse mesh (it is not owned by the transform)
+  //The output and input projections default to the projector's own.
+  RowTransform * setupRowTransform(PmeshLib::ProjectionMesh * pmesh,
+                                   ProjLib::Projection * to = NULL,
+                                   ProjLib::Projection * from = NULL)
+    throw();
+
+  //setup the outline of the input in the output image used to clip the
+  //scanlines.  pixelbytes is the size of an output pixel and pmesh is
+  //the reverse mesh (or NULL) the rows will be mapped with.
+  Footprint * setupFootprint(long int pixelbytes,
+                             PmeshLib::ProjectionMesh * pmesh = NULL)
+    throw();
+
+  //getMappingError returns the most (in input pixels) the transform
+  //setupRowTransform gives for pmesh can be off from the exact one.  A
+  //pmesh is measured against the exact projection.
+  double getMappingError(PmeshLib::ProjectionMesh * pmesh) throw();
+
+  //setup the input rows used by the reprojection loops.  A mapped input
+  //is used in place, anything else is read through the cache with up
+  //to pinbytes of its rows pinned.
+  InputRows * setupInputRows(long int pinbytes) throw();
+
+  //getExtents function gets the new bounding rectangle for the new image.
+  //The input perimeter is sampled (see ExtentSampler) and only walked a
+  //pixel at a time with a pmesh or if the sampling fails.
   void getExtents(PmeshLib::ProjectionMesh * pmesh) throw(ProjectorException);
 
+  //walkEdges projects every edge pixel of the input into bounds
+  virtual void walkEdges(PmeshLib::ProjectionMesh * pmesh,
+                         EdgeBounds & bounds) throw(ProjectorException);
+
+  //projectEdges projects edge pixels first to last - 1 of the input (the
+  //top row, the bottom row, the left column then the right column) with
+  //pmesh or the given projections and adds them to bounds
+  void projectEdges(PmeshLib::ProjectionMesh * pmesh,
+                    ProjLib::Projection * from, ProjLib::Projection * to,
+                    long int first, long int last, EdgeBounds & bounds)
+    const throw();
+
+  //setExtents sets the output rectangle, scale and size from the
+  //projected edges
+  void setExtents(const EdgeBounds & bounds) throw(ProjectorException);
+
 
   ProjIOLib::ProjectionReader reader;
   ProjIOLib::ProjectionWriter writer;
   Projection * fromprojection, * toprojection;
   USGSImageLib::ImageIFile * infile;
   USGSImageLib::ImageOFile* out;                //the output file
-  USGSImageLib::CacheManager* cache;            //cache
+  RowCache * cache;                             //cache
+  MappedInput * mapped;                         //mapped input or NULL
 
     
   //metrics
@@ -115,11 +256,21 @@ protected:
   MathLib::Point oldscale, newscale;
   int pmeshsize;                                //pmesh metrics
   int pmeshname;
+  double maxerror;                              //approximation error
+  int tilesize;                                 //resampling tile size
+  MeshGrid * meshgrid;                          //the adaptive mesh
+  bool fixedpoint;                              //fixed point mesh stepping
+  std::string plandir;                          //where plans are saved
+  WarpPlan * warpplan;                          //the open plan (or NULL)
+  bool shiftdatums;                             //shift between datums
+  DatumShiftGrid * shiftgrid;                   //output to input shift
   int photo, spp, bps;
   std::string outfile;                          //outputfilename
   ProjectionParams Params;
   bool samescale;
   unsigned int cachesize;                       //the cache size in mb
+  int cachepolicy;                              //cache replacement policy
+  RowCacheStats cachestats;                     //what the cache did
   bool packbits;                                //whether to use packbits  
 };
 
@@ -0,0 +1,169 @@
+/**
+ * Implementation file for ReadAhead
+ **/
+
+#ifndef READAHEAD_CPP_
+#define READAHEAD_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "ReadAhead.h"
+
+//****************************************************************
+void * readahead_start(void * readahead)
+{
+  //run the reader
+  reinterpret_cast<ReadAhead *>(readahead)->run();
+  return 0;
+}
+
+//****************************************************************
+ReadAhead::ReadAhead(RowCache * incache, long int inheight) throw()
+  : cache(incache), height(inheight), lock(), statemutex(),
+    statecond(statemutex), bandcount(0), generation(0), running(false),
+    stopping(false)
+{}
+
+//****************************************************************
+ReadAhead::~ReadAhead()
+{
+  stop();
+}
+
+//****************************************************************
+bool ReadAhead::start() throw()
+{
+  if (running)
+    return true;
+
+  stopping = false;
+  bandcount = 0;
+  if (ACE_Thread::spawn((ACE_THR_FUNC)readahead_start,
+                        reinterpret_cast<void *>(this),
+                        THR_NEW_LWP | THR_JOINABLE, &threadid) == -1)
+    return false;
+
+  running = true;
+  return true;
+}
+
+//****************************************************************
+void ReadAhead::stop() throw()
+{
+  if (!running)
+    return;
+
+  statemutex.acquire();
+  stopping = true;
+  ++generation;                           //drop the band being read
+  statecond.signal();
+  statemutex.release();
+
+  ACE_Thread::join(threadid);
+  running = false;
+}
+
+//****************************************************************
+void ReadAhead::request(long int first, long int last,
+                        long int nextfirst, long int nextlast) throw()
+{
+  long int room(cache->getCapacity());    //rows that can be read
+
+  statemutex.acquire();
+  ++generation;
+  bandcount = 0;
+  room -= addBand(first, last, room);
+  addBand(nextfirst, nextlast, room);
+  statecond.signal();
+  statemutex.release();
+}
+
+//****************************************************************
+long int ReadAhead::addBand(long int first, long int last, long int room)
+  throw()
+{
+  if (first < 0)
+    first = 0;
+  if (last >= height)
+    last = height - 1;
+  if (last - first + 1 > room)
+    last = first + room - 1;              //don't push out what it read
+  if (last < first)
+    return 0;
+
+  bands[bandcount++] = first;
+  bands[bandcount++] = last;
+  return last - first + 1;
+}
+
+//****************************************************************
+ACE_Thread_Mutex & ReadAhead::getLock() throw()
+{
+  return lock;
+}
+
+//****************************************************************
+void ReadAhead::run() throw()
+{
+  long int first, last, mygeneration;     //the band to read
+
+  statemutex.acquire();
+  while (!stopping)
+  {
+    if (!bandcount)
+    {
+      statecond.wait();
+      continue;
+    }
+
+    //take the first band left
+    first = bands[0];
+    last = bands[1];
+    bands[0] = bands[2];
+    bands[1] = bands[3];
+    bandcount -= 2;
+    mygeneration = generation;
+
+    statemutex.release();
+    readBand(first, last, mygeneration);
+    statemutex.acquire();
+  }
+  statemutex.release();
+}
+
+//****************************************************************
+void ReadAhead::readBand(long int first, long int last,
+                         long int ingeneration) throw()
+{
+  long int y, count;                      //the row and rows in the run
+  bool current;                           //the request still stands
+
+  for (y = first; y <= last; )
+  {
+    statemutex.acquire();
+    current = (generation == ingeneration);
+    statemutex.release();
+    if (!current)
+      return;
+
+    //read the next run of rows that aren't cached.  The cached ones are
+    //touched so reading the next band doesn't push them out first.
+    lock.acquire();
+    for (count = 0; (y <= last) && (count < READAHEAD_RUN); ++y)
+    {
+      if (!cache->touchRow(y))
+      {
+        cache->getRawScanline(y);
+        ++count;
+      }
+      else if (count)
+        break;                            //the run ended
+    }
+    lock.release();
+  }
+}
+
+#endif
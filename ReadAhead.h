@@ -0,0 +1,95 @@
+/**
+ * ReadAhead reads input rows into the cache on a thread of its own so
+ * a slave isn't left waiting on the file system between chunks.  The
+ * slave asks for the band of rows a chunk needs as soon as it gets the
+ * chunk (they are read while the chunk is being projected) along with
+ * the band of the chunk it will likely get next.
+ *
+ * Only the rows of a band that aren't cached are read, in runs of
+ * consecutive rows taken in order under a single hold of the lock, so
+ * the file is read front to back in large pieces.  The rows that are
+ * cached are touched so reading the next band evicts older rows rather
+ * than the ones the current chunk is about to use.  A new request drops
+ * whatever is left of the last one.
+ *
+ * The lock guards the file and the cache; anything else using them
+ * while the thread runs has to hold it (see LockedInputRows).
+ **/
+
+#ifndef READAHEAD_H_
+#define READAHEAD_H_
+
+#include <new>
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Thread.h>
+#include "RowCache.h"
+
+#define READAHEAD_RUN 64    //most rows read under one hold of the lock
+
+
+class ReadAhead
+{
+ public:
+  /**
+   * Main constructor.  The cache is not owned and holds inheight rows.
+   **/
+  ReadAhead(RowCache * incache, long int inheight) throw();
+
+  /**
+   * Destructor stops the thread.
+   **/
+  ~ReadAhead();
+
+  /**
+   * start starts the thread.  Returns false if it couldn't be.
+   **/
+  bool start() throw();
+
+  /**
+   * stop waits for the thread to finish the run it is on and stop.
+   **/
+  void stop() throw();
+
+  /**
+   * request replaces anything left to read with rows first to last and
+   * then nextfirst to nextlast.  Either band can be empty (last less
+   * than first).  The first band is cut down to what the cache holds
+   * and the next band to the room left after it.
+   **/
+  void request(long int first, long int last,
+               long int nextfirst, long int nextlast) throw();
+
+  /**
+   * getLock returns the lock for the file and cache.
+   **/
+  ACE_Thread_Mutex & getLock() throw();
+
+  /**
+   * run is the thread.
+   **/
+  void run() throw();
+
+ protected:
+  //addBand queues rows first to last, up to room rows.  Returns the
+  //rows queued.
+  long int addBand(long int first, long int last, long int room) throw();
+
+  //readBand reads the rows of a band that aren't cached.  Stops early
+  //if a new request comes in.
+  void readBand(long int first, long int last, long int ingeneration)
+    throw();
+
+  RowCache * cache;                       //the cache to fill
+  long int height;                        //rows in the input
+  ACE_Thread_Mutex lock;                  //lock for the file and cache
+  ACE_Thread_Mutex statemutex;            //lock for everything below
+  ACE_Condition<ACE_Thread_Mutex> statecond;  //signaled on a request
+  long int bands[4];                      //the bands left to read
+  int bandcount;                          //entries of bands in use
+  long int generation;                    //bumped on every request
+  bool running, stopping;                 //thread state
+  ACE_thread_t threadid;                  //the thread
+};
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * Implementation file for the resampling kernel selection
+ **/
+
+#ifndef RESAMPLEKERNEL_CPP_
+#define RESAMPLEKERNEL_CPP_
+
+#include "ResampleKernel.h"
+
+//**********************************************************************
+ResampleFunc getResampleFunc(int bps, int spp) throw()
+{
+  ResampleFunc simd;
+
+  if ((simd = getSimdResampleFunc(bps, spp)))
+    return simd;
+
+  if (bps == 16)
+  {
+    switch(spp)
+    {
+    case 1:
+      return &ResampleKernel<uint16, 1>::resampleRow;
+    case 3:
+      return &ResampleKernel<uint16, 3>::resampleRow;
+    case 4:
+      return &ResampleKernel<uint16, 4>::resampleRow;
+    default:
+      return &GenericResampleKernel<uint16>::resampleRow;
+    }
+  }
+
+  switch(spp)                                //8 bits per sample
+  {
+  case 1:
+    return &ResampleKernel<unsigned char, 1>::resampleRow;
+  case 3:
+    return &ResampleKernel<unsigned char, 3>::resampleRow;
+  case 4:
+    return &ResampleKernel<unsigned char, 4>::resampleRow;
+  default:
+    return &GenericResampleKernel<unsigned char>::resampleRow;
+  }
+}
+
+//**********************************************************************
+IndexResampleFunc getIndexResampleFunc(int bps, int spp) throw()
+{
+  if (bps == 16)
+  {
+    switch(spp)
+    {
+    case 1:
+      return &ResampleKernel<uint16, 1>::resampleIndices;
+    case 3:
+      return &ResampleKernel<uint16, 3>::resampleIndices;
+    case 4:
+      return &ResampleKernel<uint16, 4>::resampleIndices;
+    default:
+      return &GenericResampleKernel<uint16>::resampleIndices;
+    }
+  }
+
+  switch(spp)                                //8 bits per sample
+  {
+  case 1:
+    return &ResampleKernel<unsigned char, 1>::resampleIndices;
+  case 3:
+    return &ResampleKernel<unsigned char, 3>::resampleIndices;
+  case 4:
+    return &ResampleKernel<unsigned char, 4>::resampleIndices;
+  default:
+    return &GenericResampleKernel<unsigned char>::resampleIndices;
+  }
+}
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * ResampleKernel holds the nearest neighbour kernels that copy input
+ * pixels into an output scanline.  The kernels are instantiated for each
+ * sample type and samples per pixel so the per pixel copy is a fixed
+ * width move.  getResampleFunc picks the kernel once per job and
+ * prefers the SIMD kernels in SimdResampleKernel.cpp when the cpu has them.
+ **/
+
+#ifndef RESAMPLEKERNEL_H_
+#define RESAMPLEKERNEL_H_
+
+#include "InputRows.h"
+
+
+//The signature that all of the kernels share.  xarr and yarr are
+//the input pixel coordinates (from a RowTransform) of count output
+//pixels, width and height are the input image dimensions and spp is
+//only looked at by the generic kernel.
+typedef void (*ResampleFunc)(const double * xarr, const double * yarr,
+                             long int count, long int width,
+                             long int height, int spp,
+                             InputRows & rows,
+                             unsigned char * scanline);
+
+//The signature of the kernels that take whole input pixel numbers
+//(from RowTransform::projectRowIndices) instead of coordinates.  Any
+//index outside of 0 to width-1 or 0 to height-1 is out of bounds.
+typedef void (*IndexResampleFunc)(const long int * xidx,
+                                  const long int * yidx,
+                                  long int count, long int width,
+                                  long int height, int spp,
+                                  InputRows & rows,
+                                  unsigned char * scanline);
+
+//getResampleFunc returns the kernel for the bits per sample and samples
+//per pixel.  Falls back to a generic kernel for other spp values.
+ResampleFunc getResampleFunc(int bps, int spp) throw();
+
+//getSimdResampleFunc returns a SIMD kernel if the cpu has one for the
+//bits per sample and samples per pixel, otherwise NULL.
+ResampleFunc getSimdResampleFunc(int bps, int spp) throw();
+
+//getIndexResampleFunc returns the index kernel for the bits per sample
+//and samples per pixel.
+IndexResampleFunc getIndexResampleFunc(int bps, int spp) throw();
+
+
+//copyPixel and zeroPixel are the fixed width pixel moves the kernels use
+template <class T, int SPP>
+inline void copyPixel(T * out, const T * in) throw()
+{
+  for (int sppcounter = 0; sppcounter < SPP; ++sppcounter)
+    out[sppcounter] = in[sppcounter];
+}
+
+template <class T, int SPP>
+inline void zeroPixel(T * out) throw()
+{
+  for (int sppcounter = 0; sppcounter < SPP; ++sppcounter)
+    out[sppcounter] = 0;
+}
+
+
+//Kernel with the samples per pixel known at compile time
+template <class T, int SPP>
+class ResampleKernel
+{
+ public:
+  static void resampleRow(const double * xarr, const double * yarr,
+                          long int count, long int width,
+                          long int height, int spp,
+                          InputRows & rows,
+                          unsigned char * scanline);
+
+  static void resampleIndices(const long int * xidx,
+                              const long int * yidx,
+                              long int count, long int width,
+                              long int height, int spp,
+                              InputRows & rows,
+                              unsigned char * scanline);
+};
+
+
+//Kernel with the samples per pixel only known at run time
+template <class T>
+class GenericResampleKernel
+{
+ public:
+  static void resampleRow(const double * xarr, const double * yarr,
+                          long int count, long int width,
+                          long int height, int spp,
+                          InputRows & rows,
+                          unsigned char * scanline);
+
+  static void resampleIndices(const long int * xidx,
+                              const long int * yidx,
+                              long int count, long int width,
+                              long int height, int spp,
+                              InputRows & rows,
+                              unsigned char * scanline);
+};
+
+
+//template functions
+
+//**********************************************************************
+template <class T, int SPP>
+void ResampleKernel<T, SPP>::resampleRow(const double * xarr,
+                                         const double * yarr,
+                                         long int count, long int width,
+                                         long int height, int,
+                                         InputRows & rows,
+                                         unsigned char * scanline)
+{
+  T * out = reinterpret_cast<T *>(scanline);  //output pixel
+  const T * in;                               //input pixel
+  const double dwidth = static_cast<double>(width);
+  const double dheight = static_cast<double>(height);
+  double tx, ty;
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter, out += SPP)
+  {
+    tx = xarr[counter] + 0.5;
+    ty = yarr[counter] + 0.5;
+
+    //same as rounding with a cast and checking the bounds but NaNs and
+    //huge values fall out here as well
+    if (!((tx > -1.0) && (tx < dwidth) && (ty > -1.0) && (ty < dheight)))
+      zeroPixel<T, SPP>(out);                 //out of bounds pixel
+    else
+    {
+      in = reinterpret_cast<const T *>
+        (rows.getRow(static_cast<long int>(ty)))
+        + static_cast<long int>(tx) * SPP;
+      copyPixel<T, SPP>(out, in);             //copy pixels
+    }
+  }
+}
+
+//**********************************************************************
+template <class T, int SPP>
+void ResampleKernel<T, SPP>::resampleIndices(const long int * xidx,
+                                             const long int * yidx,
+                                             long int count,
+                                             long int width,
+                                             long int height, int,
+                                             InputRows & rows,
+                                             unsigned char * scanline)
+{
+  T * out = reinterpret_cast<T *>(scanline);  //output pixel
+  const T * in;                               //input pixel
+  const unsigned long int uwidth = static_cast<unsigned long int>(width);
+  const unsigned long int uheight = static_cast<unsigned long int>(height);
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter, out += SPP)
+  {
+    //negative indices wrap around to huge ones so one compare does
+    if ((static_cast<unsigned long int>(xidx[counter]) < uwidth) &&
+        (static_cast<unsigned long int>(yidx[counter]) < uheight))
+    {
+      in = reinterpret_cast<const T *>(rows.getRow(yidx[counter]))
+        + xidx[counter] * SPP;
+      copyPixel<T, SPP>(out, in);             //copy pixels
+    }
+    else
+      zeroPixel<T, SPP>(out);                 //out of bounds pixel
+  }
+}
+
+//**********************************************************************
+template <class T>
+void GenericResampleKernel<T>::resampleRow(const double * xarr,
+                                           const double * yarr,
+                                           long int count, long int width,
+                                           long int height, int spp,
+                                           InputRows & rows,
+                                           unsigned char * scanline)
+{
+  T * out = reinterpret_cast<T *>(scanline);  //output pixel
+  const T * in;                               //input pixel
+  const double dwidth = static_cast<double>(width);
+  const double dheight = static_cast<double>(height);
+  double tx, ty;
+  long int counter;
+  int sppcounter;
+
+  for (counter = 0; counter < count; ++counter, out += spp)
+  {
+    tx = xarr[counter] + 0.5;
+    ty = yarr[counter] + 0.5;
+
+    if (!((tx > -1.0) && (tx < dwidth) && (ty > -1.0) && (ty < dheight)))
+    {
+      for (sppcounter = 0; sppcounter < spp; ++sppcounter)
+        out[sppcounter] = 0;                  //out of bounds pixel
+    }
+    else
+    {
+      in = reinterpret_cast<const T *>
+        (rows.getRow(static_cast<long int>(ty)))
+        + static_cast<long int>(tx) * spp;
+      for (sppcounter = 0; sppcounter < spp; ++sppcounter)
+        out[sppcounter] = in[sppcounter];     //copy pixels
+    }
+  }
+}
+
+//**********************************************************************
+template <class T>
+void GenericResampleKernel<T>::resampleIndices(const long int * xidx,
+                                               const long int * yidx,
+                                               long int count,
+                                               long int width,
+                                               long int height, int spp,
+                                               InputRows & rows,
+                                               unsigned char * scanline)
+{
+  T * out = reinterpret_cast<T *>(scanline);  //output pixel
+  const T * in;                               //input pixel
+  const unsigned long int uwidth = static_cast<unsigned long int>(width);
+  const unsigned long int uheight = static_cast<unsigned long int>(height);
+  long int counter;
+  int sppcounter;
+
+  for (counter = 0; counter < count; ++counter, out += spp)
+  {
+    if ((static_cast<unsigned long int>(xidx[counter]) < uwidth) &&
+        (static_cast<unsigned long int>(yidx[counter]) < uheight))
+    {
+      in = reinterpret_cast<const T *>(rows.getRow(yidx[counter]))
+        + xidx[counter] * spp;
+      for (sppcounter = 0; sppcounter < spp; ++sppcounter)
+        out[sppcounter] = in[sppcounter];     //copy pixels
+    }
+    else
+    {
+      for (sppcounter = 0; sppcounter < spp; ++sppcounter)
+        out[sppcounter] = 0;                  //out of bounds pixel
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,280 @@
+/**
+ * Implementation file for RowCache
+ **/
+
+#ifndef ROWCACHE_CPP_
+#define ROWCACHE_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "RowCache.h"
+
+//****************************************************************
+RowCacheStats::RowCacheStats() : hits(0), misses(0), evictions(0)
+{}
+
+//****************************************************************
+void RowCacheStats::add(const RowCacheStats & other) throw()
+{
+  hits += other.hits;
+  misses += other.misses;
+  evictions += other.evictions;
+}
+
+
+//****************************************************************
+RowCache::RowCache(USGSImageLib::ImageIFile * ininfile, int inbps,
+                   long int inrowbytes, long int inheight,
+                   long int inbudget, int inpolicy)
+  throw(std::bad_alloc)
+  : infile(ininfile), bps(inbps), rowbytes(inrowbytes), capacity(1),
+    policy(inpolicy), pinned(0), head(-1), tail(-1), uses(0), windowfirst(0),
+    windowlast(-1)
+{
+  if (rowbytes > 0)
+    capacity = inbudget/rowbytes;
+  if (capacity > inheight)
+    capacity = inheight;
+  if (capacity < 1)
+    capacity = 1;
+
+  try
+  {
+    rowslots.assign(inheight, -1);
+    buffers.reserve(capacity);
+    slotrows.reserve(capacity);
+    pins.reserve(capacity);
+    prev.reserve(capacity);
+    next.reserve(capacity);
+    lastuse.reserve(capacity);
+  }
+  catch(...)
+  {
+    throw std::bad_alloc();
+  }
+}
+
+//****************************************************************
+RowCache::~RowCache()
+{
+  unsigned long int counter;
+
+  for (counter = 0; counter < buffers.size(); ++counter)
+    delete [] buffers[counter];
+}
+
+//****************************************************************
+const unsigned char * RowCache::getRawScanline(long int y) throw()
+{
+  long int slot;
+  unsigned char * buffer;
+
+  if (touchRow(y))
+  {
+    ++stats.hits;
+    return buffers[rowslots[y]];
+  }
+
+  ++stats.misses;
+
+  //the victim is picked before the new row is in the window index
+  if ((static_cast<long int>(buffers.size()) >= capacity) &&
+      ((slot = getVictim()) < 0))
+    return NULL;                              //everything is pinned
+
+  if (policy == ROWCACHE_WINDOW)
+  {
+    try
+    {
+      held.insert(y);
+    }
+    catch(...)
+    {
+      return NULL;
+    }
+  }
+
+  if (static_cast<long int>(buffers.size()) < capacity)
+  {
+    //still room for another row
+    if (!(buffer = new (std::nothrow) unsigned char[rowbytes]))
+    {
+      held.erase(y);
+      return NULL;
+    }
+    slot = buffers.size();
+    buffers.push_back(buffer);                //reserved so these can't fail
+    slotrows.push_back(-1);
+    pins.push_back(0);
+    prev.push_back(-1);
+    next.push_back(-1);
+    lastuse.push_back(0);
+  }
+  else
+  {
+    rowslots[slotrows[slot]] = -1;
+    held.erase(slotrows[slot]);
+    unlink(slot);
+    ++stats.evictions;
+  }
+
+  if (bps == 16)
+    dynamic_cast<USGSImageLib::TIFFImageIFile*>(infile)
+      ->getRawScanline(y, static_cast<tdata_t>(buffers[slot]));
+  else
+    infile->getRawScanline(y, buffers[slot]);
+
+  slotrows[slot] = y;
+  rowslots[y] = slot;
+  lastuse[slot] = ++uses;
+  pushFront(slot);
+  return buffers[slot];
+}
+
+//****************************************************************
+bool RowCache::touchRow(long int y) throw()
+{
+  long int slot = rowslots[y];
+
+  if (slot < 0)
+    return false;
+
+  lastuse[slot] = ++uses;
+  if (!pins[slot] && (slot != head))          //pinned rows aren't listed
+  {
+    unlink(slot);
+    pushFront(slot);
+  }
+  return true;
+}
+
+//****************************************************************
+const unsigned char * RowCache::pinRow(long int y) throw()
+{
+  const unsigned char * ret = getRawScanline(y);
+  long int slot;
+
+  if (!ret)
+    return NULL;
+
+  //take it off the recency list and out of the window index so it
+  //can't be picked to be evicted
+  slot = rowslots[y];
+  if (!pins[slot]++)
+  {
+    unlink(slot);
+    held.erase(y);
+    ++pinned;
+  }
+  return ret;
+}
+
+//****************************************************************
+void RowCache::unpinRow(long int y) throw()
+{
+  long int slot = rowslots[y];
+
+  if ((slot < 0) || !pins[slot] || --pins[slot])
+    return;
+
+  --pinned;
+  pushFront(slot);
+  if (policy == ROWCACHE_WINDOW)
+  {
+    try
+    {
+      held.insert(y);
+    }
+    catch(...)
+    {}                                        //it can still go as the lru
+  }
+}
+
+//****************************************************************
+void RowCache::setWindow(long int first, long int last) throw()
+{
+  windowfirst = first;
+  windowlast = last;
+}
+
+//****************************************************************
+RowCacheStats RowCache::getStats() const throw()
+{
+  return stats;
+}
+
+//****************************************************************
+long int RowCache::getCapacity() const throw()
+{
+  return capacity;
+}
+
+//****************************************************************
+int RowCache::getPolicy() const throw()
+{
+  return policy;
+}
+
+//****************************************************************
+long int RowCache::getPinned() const throw()
+{
+  return pinned;
+}
+
+//****************************************************************
+long int RowCache::getVictim() const throw()
+{
+  long int low, high, lowdistance, highdistance;
+
+  if ((policy != ROWCACHE_WINDOW) || held.empty())
+    return tail;
+
+  //the farthest row is the lowest or the highest one held
+  low = *(held.begin());
+  high = *(held.rbegin());
+  lowdistance = (low < windowfirst) ? windowfirst - low : 0;
+  highdistance = (high > windowlast) ? high - windowlast : 0;
+
+  //everything is in the window so just take the least recent
+  if (!lowdistance && !highdistance)
+    return tail;
+
+  if ((lowdistance > highdistance) ||
+      ((lowdistance == highdistance) &&
+       (lastuse[rowslots[low]] < lastuse[rowslots[high]])))
+    return rowslots[low];
+  return rowslots[high];
+}
+
+//****************************************************************
+void RowCache::unlink(long int slot) throw()
+{
+  if (prev[slot] >= 0)
+    next[prev[slot]] = next[slot];
+  else
+    head = next[slot];
+
+  if (next[slot] >= 0)
+    prev[next[slot]] = prev[slot];
+  else
+    tail = prev[slot];
+
+  prev[slot] = next[slot] = -1;
+}
+
+//****************************************************************
+void RowCache::pushFront(long int slot) throw()
+{
+  prev[slot] = -1;
+  next[slot] = head;
+  if (head >= 0)
+    prev[head] = slot;
+  head = slot;
+  if (tail < 0)
+    tail = slot;
+}
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * RowCache keeps input scanlines in memory up to a budget of bytes.
+ * How many rows that is depends on the row size, so wide RGB inputs
+ * hold fewer rows and narrow ones don't tie up memory they can't use.
+ * Row buffers are only allocated as rows are read.
+ *
+ * When it is full a row is evicted by the replacement policy.
+ * ROWCACHE_LRU evicts the row used least recently.  ROWCACHE_WINDOW
+ * evicts the row farthest from the window of rows the current chunk
+ * needs (set with setWindow), the least recently used of those that
+ * are equally far.
+ *
+ * Rows can be pinned while a chunk uses them.  A pinned row is out of
+ * the running for eviction so pointers to it stay good until it is
+ * unpinned.
+ *
+ * The hits, misses and evictions are counted so they can be reported.
+ **/
+
+#ifndef ROWCACHE_H_
+#define ROWCACHE_H_
+
+#include <new>
+#include <vector>
+#include <set>
+#include "ImageLib/TIFFImageIFile.h"
+
+#define ROWCACHE_LRU    0   //evict the least recently used row
+#define ROWCACHE_WINDOW 1   //evict the row farthest from the window
+#define ROWCACHE_SHARED 2   //slaves share a SharedRowCache (else LRU)
+
+
+//What a cache did
+struct RowCacheStats
+{
+  RowCacheStats();
+
+  //add adds in the counts of another cache
+  void add(const RowCacheStats & other) throw();
+
+  long int hits;                          //rows found in the cache
+  long int misses;                        //rows read from the file
+  long int evictions;                     //rows thrown out for others
+};
+
+
+class RowCache
+{
+ public:
+  /**
+   * Main constructor.  infile is not owned.  inbps is the bits per
+   * sample, inrowbytes the bytes in a row and inheight the number of
+   * rows.  inbudget is the most bytes of rows kept (at least one row
+   * always is) and inpolicy the replacement policy.
+   **/
+  RowCache(USGSImageLib::ImageIFile * ininfile, int inbps,
+           long int inrowbytes, long int inheight, long int inbudget,
+           int inpolicy = ROWCACHE_LRU) throw(std::bad_alloc);
+
+  /**
+   * Destructor
+   **/
+  ~RowCache();
+
+  /**
+   * getRawScanline returns a pointer to row y, reading it if it isn't
+   * in the cache.  The pointer is only good until the next call.
+   * Returns NULL if the row couldn't be held.
+   **/
+  const unsigned char * getRawScanline(long int y) throw();
+
+  /**
+   * pinRow returns a pointer to row y like getRawScanline but the row
+   * isn't evicted until unpinRow has been called as many times as
+   * pinRow, so the pointer is good until then.  Returns NULL if the row
+   * couldn't be held.
+   **/
+  const unsigned char * pinRow(long int y) throw();
+  void unpinRow(long int y) throw();
+
+  /**
+   * hasRow returns true if row y is in the cache.
+   **/
+  inline bool hasRow(long int y) const throw();
+
+  /**
+   * touchRow counts row y as just used if it is in the cache (without
+   * counting a hit).  Returns true if it is in the cache.
+   **/
+  bool touchRow(long int y) throw();
+
+  /**
+   * setWindow sets the rows first to last that are about to be used
+   * for ROWCACHE_WINDOW.
+   **/
+  void setWindow(long int first, long int last) throw();
+
+  /**
+   * getStats returns what the cache has done so far.
+   **/
+  RowCacheStats getStats() const throw();
+
+  /**
+   * getCapacity returns the most rows the cache holds and getPolicy
+   * the replacement policy.
+   **/
+  long int getCapacity() const throw();
+  int getPolicy() const throw();
+
+  /**
+   * getPinned returns the number of rows pinned.
+   **/
+  long int getPinned() const throw();
+
+ protected:
+  //getVictim returns the slot to evict (-1 if every row is pinned)
+  long int getVictim() const throw();
+
+  //unlink and pushFront take a slot out of and put it at the front of
+  //the recency list
+  void unlink(long int slot) throw();
+  void pushFront(long int slot) throw();
+
+  USGSImageLib::ImageIFile * infile;      //the input file
+  int bps;                                //bits per sample
+  long int rowbytes;                      //bytes in a row
+  long int capacity;                      //most rows held
+  int policy;                             //replacement policy
+  std::vector<long int> rowslots;         //slot of each row or -1
+  std::vector<unsigned char *> buffers;   //the row in each slot
+  std::vector<long int> slotrows;         //row in each slot
+  std::vector<long int> pins;             //pins on each slot
+  long int pinned;                        //slots pinned
+  std::vector<long int> prev, next;       //recency list of unpinned,
+  long int head, tail;                    //most recent first
+  std::vector<unsigned long int> lastuse; //when each slot was used
+  unsigned long int uses;                 //uses so far
+  std::set<long int> held;                //unpinned rows for the window
+  long int windowfirst, windowlast;       //rows the chunk needs
+  RowCacheStats stats;                    //what the cache did
+};
+
+
+//inline functions
+
+//****************************************************************
+inline bool RowCache::hasRow(long int y) const throw()
+{
+  return rowslots[y] >= 0;
+}
+
+#endif
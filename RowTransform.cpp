@@ -0,0 +1,545 @@
+/**
+ * Implementation file for the row transforms.
+ **/
+
+#ifndef ROWTRANSFORM_CPP_
+#define ROWTRANSFORM_CPP_
+
+#include "RowTransform.h"
+#include "WarpPlan.h"
+#include "BatchProjection.h"
+#include <cmath>
+#include <limits>
+
+#define AFFINE_SPAN 1024        //output pixels between the fit points
+#define AFFINE_TOLERANCE 1e-4   //input pixels the fit can be off by
+#define AFFINE_EDGE 1e-6        //how close a row copy can get to rounding
+#define SEPARABLE_TOLERANCE 1e-4 //input pixels the tables can be off by
+
+//*******************************************************************
+RowTransform::RowTransform(const DRect & inoutRect,
+                           const MathLib::Point & innewscale,
+                           const DRect & ininRect,
+                           const MathLib::Point & inoldscale)
+  : outRect(inoutRect), inRect(ininRect), newscale(innewscale),
+    oldscale(inoldscale)
+{
+  //calcuate the inversers to do multiplaction instead of division
+  xscaleinv = 1.0/oldscale.x;
+  yscaleinv = 1.0/oldscale.y;
+}
+
+//*******************************************************************
+RowTransform::~RowTransform()
+{}
+
+//*******************************************************************
+bool RowTransform::copyRow(long int, long int, long int, long int &,
+                           long int &) throw()
+{
+  return false;
+}
+
+//*******************************************************************
+bool RowTransform::projectRowIndices(long int, long int, long int,
+                                     long int *, long int *) throw()
+{
+  return false;
+}
+
+//*******************************************************************
+ExactRowTransform::ExactRowTransform(const DRect & inoutRect,
+                                     const MathLib::Point & innewscale,
+                                     const DRect & ininRect,
+                                     const MathLib::Point & inoldscale,
+                                     ProjLib::Projection * inout,
+                                     ProjLib::Projection * inin,
+                                     const DatumShift & inshift,
+                                     const DatumShiftGrid * inshiftgrid)
+  : RowTransform(inoutRect, innewscale, ininRect, inoldscale),
+    toprojection(inout), fromprojection(inin), tobatch(NULL),
+    frombatch(NULL), datumshift(inshift), shiftgrid(inshiftgrid)
+{
+  //either side can be done in batches on its own
+  tobatch = createBatchProjection(toprojection);
+  frombatch = createBatchProjection(fromprojection);
+}
+
+//*******************************************************************
+ExactRowTransform::~ExactRowTransform()
+{
+  delete tobatch;
+  delete frombatch;
+}
+
+//*******************************************************************
+void ExactRowTransform::projectRow(long int ycounter, long int startx,
+                                   long int count,
+                                   double * xarr, double * yarr) throw()
+{
+  double x, y;                                 //temp variables
+  const double rowy = outRect.top - newscale.y * ycounter;
+  long int counter;
+
+  if (!tobatch && !frombatch && !datumshift.good())
+  {
+    for (counter = 0; counter < count; ++counter)
+    {
+      x = outRect.left + newscale.x * (startx + counter);
+      y = rowy;
+
+      toprojection->projectToGeo(x, y, y, x);
+      fromprojection->projectFromGeo(y, x, x, y);
+
+      xarr[counter] = (x - inRect.left) * xscaleinv;
+      yarr[counter] = (inRect.top - y) * yscaleinv;
+    }
+    return;
+  }
+
+  //the row goes through each side in place, longitude in xarr and
+  //latitude in yarr in between
+  for (counter = 0; counter < count; ++counter)
+  {
+    xarr[counter] = outRect.left + newscale.x * (startx + counter);
+    yarr[counter] = rowy;
+  }
+
+  if (tobatch)
+    tobatch->toGeo(xarr, yarr, count);
+  else
+  {
+    for (counter = 0; counter < count; ++counter)
+      toprojection->projectToGeo(xarr[counter], yarr[counter],
+                                 yarr[counter], xarr[counter]);
+  }
+
+  if (shiftgrid)
+    shiftgrid->shiftRow(ycounter, startx, count, xarr, yarr);
+  else if (datumshift.good())
+  {
+    for (counter = 0; counter < count; ++counter)
+      datumshift.shift(xarr[counter], yarr[counter]);
+  }
+
+  if (frombatch)
+    frombatch->fromGeo(xarr, yarr, count);
+  else
+  {
+    for (counter = 0; counter < count; ++counter)
+      fromprojection->projectFromGeo(yarr[counter], xarr[counter],
+                                     xarr[counter], yarr[counter]);
+  }
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    xarr[counter] = (xarr[counter] - inRect.left) * xscaleinv;
+    yarr[counter] = (inRect.top - yarr[counter]) * yscaleinv;
+  }
+}
+
+//*******************************************************************
+MeshRowTransform::MeshRowTransform(const DRect & inoutRect,
+                                   const MathLib::Point & innewscale,
+                                   const DRect & ininRect,
+                                   const MathLib::Point & inoldscale,
+                                   PmeshLib::ProjectionMesh * inpmesh)
+  : RowTransform(inoutRect, innewscale, ininRect, inoldscale),
+    pmesh(inpmesh)
+{}
+
+//*******************************************************************
+MeshRowTransform::~MeshRowTransform()
+{}
+
+//*******************************************************************
+void MeshRowTransform::projectRow(long int ycounter, long int startx,
+                                  long int count,
+                                  double * xarr, double * yarr) throw()
+{
+  double x, y;                                 //temp variables
+  const double rowy = outRect.top - newscale.y * ycounter;
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    x = outRect.left + newscale.x * (startx + counter);
+    y = rowy;
+
+    pmesh->projectPoint(x, y);
+
+    xarr[counter] = (x - inRect.left) * xscaleinv;
+    yarr[counter] = (inRect.top - y) * yscaleinv;
+  }
+}
+
+//*******************************************************************
+GridRowTransform::GridRowTransform(const DRect & inoutRect,
+                                   const MathLib::Point & innewscale,
+                                   const DRect & ininRect,
+                                   const MathLib::Point & inoldscale,
+                                   const MeshGrid * ingrid)
+  : RowTransform(inoutRect, innewscale, ininRect, inoldscale),
+    grid(ingrid)
+{}
+
+//*******************************************************************
+GridRowTransform::~GridRowTransform()
+{}
+
+//*******************************************************************
+void GridRowTransform::projectRow(long int ycounter, long int startx,
+                                  long int count,
+                                  double * xarr, double * yarr) throw()
+{
+  //the grid is already in input pixels
+  grid->projectRow(ycounter, startx, count, xarr, yarr);
+}
+
+//*******************************************************************
+bool GridRowTransform::projectRowIndices(long int ycounter,
+                                         long int startx, long int count,
+                                         long int * xidx,
+                                         long int * yidx) throw()
+{
+  grid->projectRowIndices(ycounter, startx, count, xidx, yidx);
+  return true;
+}
+
+//*******************************************************************
+PlanRowTransform::PlanRowTransform(const DRect & inoutRect,
+                                   const MathLib::Point & innewscale,
+                                   const DRect & ininRect,
+                                   const MathLib::Point & inoldscale,
+                                   const WarpPlan * inplan)
+  : RowTransform(inoutRect, innewscale, ininRect, inoldscale),
+    plan(inplan)
+{}
+
+//*******************************************************************
+PlanRowTransform::~PlanRowTransform()
+{}
+
+//*******************************************************************
+void PlanRowTransform::projectRow(long int ycounter, long int startx,
+                                  long int count,
+                                  double * xarr, double * yarr) throw()
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  long int counter;
+
+  //the kernels use projectRowIndices; this is for the estimates of the
+  //input rows (ChunkProjector::estimateInputRows, which ReadAhead and
+  //the ChunkScheduler go through)
+  try
+  {
+    if (static_cast<long int>(xrow.size()) < count)
+    {
+      xrow.resize(count);
+      yrow.resize(count);
+    }
+  }
+  catch(...)
+  {
+    for (counter = 0; counter < count; ++counter)
+      xarr[counter] = yarr[counter] = nan;
+    return;
+  }
+
+  plan->projectRowIndices(ycounter, startx, count, &(xrow[0]),
+                          &(yrow[0]));
+  for (counter = 0; counter < count; ++counter)
+  {
+    //off the input isn't anywhere on it, so the estimates skip it like
+    //a point that couldn't be projected (and the kernels drop it)
+    xarr[counter] = (xrow[counter] < 0) ? nan : xrow[counter];
+    yarr[counter] = (yrow[counter] < 0) ? nan : yrow[counter];
+  }
+}
+
+//*******************************************************************
+bool PlanRowTransform::projectRowIndices(long int ycounter,
+                                         long int startx, long int count,
+                                         long int * xidx,
+                                         long int * yidx) throw()
+{
+  plan->projectRowIndices(ycounter, startx, count, xidx, yidx);
+  return true;
+}
+
+//*******************************************************************
+AffineRowTransform::AffineRowTransform(const DRect & inoutRect,
+                                       const MathLib::Point & innewscale,
+                                       const DRect & ininRect,
+                                       const MathLib::Point & inoldscale,
+                                       ProjLib::Projection * inout,
+                                       ProjLib::Projection * inin)
+  : RowTransform(inoutRect, innewscale, ininRect, inoldscale),
+    x0(0.0), y0(0.0), xx(0.0), xy(0.0), yx(0.0), yy(0.0),
+    affine(false), onetoone(false)
+{
+  ExactRowTransform exact(inoutRect, innewscale, ininRect, inoldscale,
+                          inout, inin);
+  double x[3], y[3];                           //the exact points
+  double checkx, checky;                       //a point to check
+  int counter;
+
+  //fit the mapping from the origin and a step along each axis
+  exact.projectRow(0, 0, 1, &(x[0]), &(y[0]));
+  exact.projectRow(0, AFFINE_SPAN, 1, &(x[1]), &(y[1]));
+  exact.projectRow(AFFINE_SPAN, 0, 1, &(x[2]), &(y[2]));
+  for (counter = 0; counter < 3; ++counter)
+  {
+    if (!(std::fabs(x[counter]) < 1e9) || !(std::fabs(y[counter]) < 1e9))
+      return;                                  //projection failed
+  }
+
+  x0 = x[0];
+  y0 = y[0];
+  xx = (x[1] - x[0])/AFFINE_SPAN;
+  yx = (y[1] - y[0])/AFFINE_SPAN;
+  xy = (x[2] - x[0])/AFFINE_SPAN;
+  yy = (y[2] - y[0])/AFFINE_SPAN;
+
+  //check the far corner and a point off the diagonal
+  affine = true;
+  exact.projectRow(AFFINE_SPAN, AFFINE_SPAN, 1, &checkx, &checky);
+  if (!(std::fabs(x0 + (xx + xy)*AFFINE_SPAN - checkx) < AFFINE_TOLERANCE) ||
+      !(std::fabs(y0 + (yx + yy)*AFFINE_SPAN - checky) < AFFINE_TOLERANCE))
+    affine = false;
+  exact.projectRow(AFFINE_SPAN/3, AFFINE_SPAN/2, 1, &checkx, &checky);
+  if (!(std::fabs(x0 + xx*(AFFINE_SPAN/2) + xy*(AFFINE_SPAN/3) - checkx)
+        < AFFINE_TOLERANCE) ||
+      !(std::fabs(y0 + yx*(AFFINE_SPAN/2) + yy*(AFFINE_SPAN/3) - checky)
+        < AFFINE_TOLERANCE))
+    affine = false;
+
+  //rows are straight copies when the scales match
+  onetoone = (std::fabs(xx - 1.0)*AFFINE_SPAN < AFFINE_TOLERANCE &&
+              std::fabs(yy - 1.0)*AFFINE_SPAN < AFFINE_TOLERANCE &&
+              std::fabs(xy)*AFFINE_SPAN < AFFINE_TOLERANCE &&
+              std::fabs(yx)*AFFINE_SPAN < AFFINE_TOLERANCE);
+}
+
+//*******************************************************************
+AffineRowTransform::~AffineRowTransform()
+{}
+
+//*******************************************************************
+bool AffineRowTransform::good() const throw()
+{
+  return affine;
+}
+
+//*******************************************************************
+void AffineRowTransform::projectRow(long int ycounter, long int startx,
+                                    long int count,
+                                    double * xarr, double * yarr) throw()
+{
+  const double rowx = x0 + xx*startx + xy*ycounter;
+  const double rowy = y0 + yx*startx + yy*ycounter;
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    xarr[counter] = rowx + xx*counter;
+    yarr[counter] = rowy + yx*counter;
+  }
+}
+
+//*******************************************************************
+bool AffineRowTransform::copyRow(long int ycounter, long int startx,
+                                 long int count,
+                                 long int & inx, long int & iny) throw()
+{
+  double tx, ty;                               //start with rounding added
+
+  if (!onetoone)
+    return false;
+
+  tx = x0 + xx*startx + xy*ycounter + 0.5;
+  ty = y0 + yx*startx + yy*ycounter + 0.5;
+
+  //the run has to be well clear of the rounding edges so every pixel
+  //rounds the same way the kernels would
+  if ((std::fabs(xx - 1.0)*count > AFFINE_EDGE) ||
+      (std::fabs(yx)*count > AFFINE_EDGE) ||
+      (tx - std::floor(tx) < AFFINE_EDGE) ||
+      (std::floor(tx) + 1.0 - tx < AFFINE_EDGE) ||
+      (ty - std::floor(ty) < AFFINE_EDGE) ||
+      (std::floor(ty) + 1.0 - ty < AFFINE_EDGE) ||
+      !(std::fabs(tx) < 1e9) || !(std::fabs(ty) < 1e9))
+    return false;
+
+  inx = static_cast<long int>(std::floor(tx));
+  iny = static_cast<long int>(std::floor(ty));
+  return true;
+}
+
+//*******************************************************************
+SeparableRowTransform::SeparableRowTransform
+(const DRect & inoutRect, const MathLib::Point & innewscale,
+ const DRect & ininRect, const MathLib::Point & inoldscale,
+ long int innewwidth, long int innewheight,
+ ProjLib::Projection * inout, ProjLib::Projection * inin)
+  throw(std::bad_alloc)
+  : RowTransform(inoutRect, innewscale, ininRect, inoldscale),
+    newwidth(innewwidth), newheight(innewheight), xtable(NULL),
+    ytable(NULL), separable(false)
+{
+  ExactRowTransform exact(inoutRect, innewscale, ininRect, inoldscale,
+                          inout, inin);
+  double * temp = NULL;                        //the unused coordinate
+  double checkx, checky;                       //a point to check
+  long int counter, x, y;
+
+  if ((newwidth <= 0) || (newheight <= 0))
+    return;
+
+  try
+  {
+    if (!(xtable = new (std::nothrow) double[newwidth]))
+      throw std::bad_alloc();
+    if (!(ytable = new (std::nothrow) double[newheight]))
+      throw std::bad_alloc();
+    if (!(temp = new (std::nothrow) double[newwidth]))
+      throw std::bad_alloc();
+
+    //project the middle row for the columns and the middle column for
+    //the rows
+    exact.projectRow(newheight/2, 0, newwidth, xtable, temp);
+    for (counter = 0; counter < newheight; ++counter)
+      exact.projectRow(counter, newwidth/2, 1, temp, &(ytable[counter]));
+    delete [] temp;
+    temp = NULL;
+
+    //check a few points off the middle
+    separable = true;
+    for (counter = 0; counter < 4; ++counter)
+    {
+      x = (counter & 1) ? newwidth/4 : (3*newwidth)/4;
+      y = (counter & 2) ? newheight/4 : (3*newheight)/4;
+      exact.projectRow(y, x, 1, &checkx, &checky);
+      if (!(std::fabs(xtable[x] - checkx) < SEPARABLE_TOLERANCE) ||
+          !(std::fabs(ytable[y] - checky) < SEPARABLE_TOLERANCE))
+        separable = false;
+    }
+  }
+  catch(...)
+  {
+    delete [] xtable;
+    delete [] ytable;
+    delete [] temp;
+    throw std::bad_alloc();
+  }
+}
+
+//*******************************************************************
+SeparableRowTransform::~SeparableRowTransform()
+{
+  delete [] xtable;
+  delete [] ytable;
+}
+
+//*******************************************************************
+bool SeparableRowTransform::good() const throw()
+{
+  return separable;
+}
+
+//*******************************************************************
+void SeparableRowTransform::projectRow(long int ycounter, long int startx,
+                                       long int count,
+                                       double * xarr, double * yarr) throw()
+{
+  const double rowy = ytable[ycounter];
+  long int counter;
+
+  for (counter = 0; counter < count; ++counter)
+  {
+    xarr[counter] = xtable[startx + counter];
+    yarr[counter] = rowy;
+  }
+}
+
+//*******************************************************************
+ApproxRowTransform::ApproxRowTransform(const DRect & inoutRect,
+                                       const MathLib::Point & innewscale,
+                                       const DRect & ininRect,
+                                       const MathLib::Point & inoldscale,
+                                       RowTransform * inexact,
+                                       double inmaxerror)
+  : RowTransform(inoutRect, innewscale, ininRect, inoldscale),
+    exact(inexact), maxerror(inmaxerror)
+{}
+
+//*******************************************************************
+ApproxRowTransform::~ApproxRowTransform()
+{
+  delete exact;
+}
+
+//*******************************************************************
+void ApproxRowTransform::projectRow(long int ycounter, long int startx,
+                                    long int count,
+                                    double * xarr, double * yarr) throw()
+{
+  //not worth approximating
+  if (count < 3)
+  {
+    exact->projectRow(ycounter, startx, count, xarr, yarr);
+    return;
+  }
+
+  //project the ends exactly and fill in the middle
+  exact->projectRow(ycounter, startx, 1, xarr, yarr);
+  exact->projectRow(ycounter, startx + count - 1, 1,
+                    &(xarr[count - 1]), &(yarr[count - 1]));
+  approximate(ycounter, startx, 0, count - 1, xarr, yarr);
+}
+
+//*******************************************************************
+void ApproxRowTransform::approximate(long int ycounter, long int startx,
+                                     long int first, long int last,
+                                     double * xarr, double * yarr) throw()
+{
+  long int mid, counter;
+  double t, xstep, ystep;
+
+  if (last - first < 2)                      //nothing in between
+    return;
+
+  //project the middle exactly
+  mid = first + (last - first)/2;
+  exact->projectRow(ycounter, startx + mid, 1, &(xarr[mid]), &(yarr[mid]));
+
+  xstep = (xarr[last] - xarr[first])/(last - first);
+  ystep = (yarr[last] - yarr[first])/(last - first);
+  t = static_cast<double>(mid - first);
+
+  //a point that didn't project (NaN or off in space) can't be
+  //interpolated to or from, so split until it is done exactly too
+  if (!(std::fabs(xarr[first]) < 1e9) || !(std::fabs(yarr[first]) < 1e9) ||
+      !(std::fabs(xarr[last]) < 1e9) || !(std::fabs(yarr[last]) < 1e9) ||
+      !(std::fabs(xarr[mid]) < 1e9) || !(std::fabs(yarr[mid]) < 1e9) ||
+      (std::fabs(xarr[first] + xstep*t - xarr[mid]) > maxerror) ||
+      (std::fabs(yarr[first] + ystep*t - yarr[mid]) > maxerror))
+  {
+    //to far off so split the segment
+    approximate(ycounter, startx, first, mid, xarr, yarr);
+    approximate(ycounter, startx, mid, last, xarr, yarr);
+    return;
+  }
+
+  //close enough so interpolate everything but the exact middle
+  for (counter = first + 1; counter < last; ++counter)
+  {
+    if (counter == mid)
+      continue;
+    t = static_cast<double>(counter - first);
+    xarr[counter] = xarr[first] + xstep*t;
+    yarr[counter] = yarr[first] + ystep*t;
+  }
+}
+
+#endif
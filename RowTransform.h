@@ -0,0 +1,309 @@
+/**
+ * RowTransform maps a run of output pixels on a single output scanline
+ * back into input pixel coordinates in one call so that the reprojection
+ * loops do not have to go through the projection objects pixel by pixel.
+ **/
+
+#ifndef ROWTRANSFORM_H_
+#define ROWTRANSFORM_H_
+
+#include <new>
+#include <vector>
+#include "ProjectionMesh/ProjectionMesh.h"
+#include "MathLib/Point.h"
+#include "DRect.h"
+#include "MeshGrid.h"
+#include "DatumShift.h"
+
+class WarpPlan;
+class BatchProjection;
+
+
+//Base class for all of the row transforms.
+class RowTransform
+{
+ public:
+  /**
+   * Main constructor takes the output grid (bounding rectangle and
+   * scale) and the input grid that the coordinates are returned in.
+   **/
+  RowTransform(const DRect & inoutRect, const MathLib::Point & innewscale,
+               const DRect & ininRect, const MathLib::Point & inoldscale);
+
+  /**
+   * Destructor
+   **/
+  virtual ~RowTransform();
+
+  /**
+   * projectRow fills xarr and yarr with the (fractional) input pixel
+   * coordinates of count output pixels starting at pixel startx on
+   * output scanline ycounter.  The arrays must hold count entries.
+   * Rounding to an actual input pixel is left up to the caller.
+   **/
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw() = 0;
+
+  /**
+   * copyRow returns true if count output pixels starting at startx on
+   * scanline ycounter land one to one on a run of input pixels (so the
+   * row can be copied instead of resampled).  inx and iny are set to
+   * the input pixel the first one rounds to.  Default is false.
+   **/
+  virtual bool copyRow(long int ycounter, long int startx, long int count,
+                       long int & inx, long int & iny) throw();
+
+  /**
+   * projectRowIndices is like projectRow but fills xidx and yidx with
+   * the input pixels the coordinates round to (for an IndexResampleFunc)
+   * using fixed point stepping.  Returns false if the transform can't,
+   * in which case projectRow has to be used.  Default is false.
+   **/
+  virtual bool projectRowIndices(long int ycounter, long int startx,
+                                 long int count, long int * xidx,
+                                 long int * yidx) throw();
+
+ protected:
+  DRect outRect, inRect;               //output and input bounds
+  MathLib::Point newscale, oldscale;   //output and input scales
+  double xscaleinv, yscaleinv;         //inverse of the input scale
+};
+
+
+//ExactRowTransform runs every pixel through the projection library, a
+//row at a time through a BatchProjection when there is one for it.
+//A datum shift, if one is given, is done in between.
+class ExactRowTransform : public RowTransform
+{
+ public:
+  /**
+   * The projections are not owned by the transform.
+   * inout is the output projection and inin is the input projection.
+   * inshift is the shift from the output datum to the input one (the
+   * default doesn't shift).  inshiftgrid is that shift cached over the
+   * output image; without one the shift is done exactly.  It is not
+   * owned either.
+   **/
+  ExactRowTransform(const DRect & inoutRect,
+                    const MathLib::Point & innewscale,
+                    const DRect & ininRect,
+                    const MathLib::Point & inoldscale,
+                    ProjLib::Projection * inout,
+                    ProjLib::Projection * inin,
+                    const DatumShift & inshift = DatumShift(),
+                    const DatumShiftGrid * inshiftgrid = NULL);
+  virtual ~ExactRowTransform();
+
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw();
+
+ protected:
+  ProjLib::Projection * toprojection;   //output projection
+  ProjLib::Projection * fromprojection; //input projection
+  BatchProjection * tobatch;            //batch output projection or NULL
+  BatchProjection * frombatch;          //batch input projection or NULL
+  DatumShift datumshift;                //output to input datum shift
+  const DatumShiftGrid * shiftgrid;     //cached shift or NULL
+};
+
+
+//MeshRowTransform uses a reverse projection mesh
+class MeshRowTransform : public RowTransform
+{
+ public:
+  /**
+   * The mesh is not owned by the transform and must be a reverse
+   * (output to input) mesh.
+   **/
+  MeshRowTransform(const DRect & inoutRect,
+                   const MathLib::Point & innewscale,
+                   const DRect & ininRect,
+                   const MathLib::Point & inoldscale,
+                   PmeshLib::ProjectionMesh * inpmesh);
+  virtual ~MeshRowTransform();
+
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw();
+
+ protected:
+  PmeshLib::ProjectionMesh * pmesh;     //the reverse mesh
+};
+
+
+
+//GridRowTransform interpolates from an adaptive MeshGrid
+class GridRowTransform : public RowTransform
+{
+ public:
+  /**
+   * The grid is not owned by the transform and must already be
+   * calculated for the output image.
+   **/
+  GridRowTransform(const DRect & inoutRect,
+                   const MathLib::Point & innewscale,
+                   const DRect & ininRect,
+                   const MathLib::Point & inoldscale,
+                   const MeshGrid * ingrid);
+  virtual ~GridRowTransform();
+
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw();
+
+  virtual bool projectRowIndices(long int ycounter, long int startx,
+                                 long int count, long int * xidx,
+                                 long int * yidx) throw();
+
+ protected:
+  const MeshGrid * grid;                //the mesh
+};
+
+
+//PlanRowTransform reads a saved WarpPlan.  projectRow gives the middle
+//of the input pixel the plan has for each output pixel, or NaN for the
+//ones off the input.
+class PlanRowTransform : public RowTransform
+{
+ public:
+  /**
+   * The plan is not owned by the transform and must be open.
+   **/
+  PlanRowTransform(const DRect & inoutRect,
+                   const MathLib::Point & innewscale,
+                   const DRect & ininRect,
+                   const MathLib::Point & inoldscale,
+                   const WarpPlan * inplan);
+  virtual ~PlanRowTransform();
+
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw();
+
+  virtual bool projectRowIndices(long int ycounter, long int startx,
+                                 long int count, long int * xidx,
+                                 long int * yidx) throw();
+
+ protected:
+  const WarpPlan * plan;                //the plan
+  std::vector<long int> xrow, yrow;     //indices for projectRow
+};
+
+
+//AffineRowTransform is for projections that only differ by units so
+//the output to input mapping is a straight scale and offset.  The
+//mapping is fit from three exactly projected points and checked at a
+//couple of others; good() is false if it doesn't hold.
+class AffineRowTransform : public RowTransform
+{
+ public:
+  /**
+   * The projections are only used in the constructor.
+   * inout is the output projection and inin is the input projection.
+   **/
+  AffineRowTransform(const DRect & inoutRect,
+                     const MathLib::Point & innewscale,
+                     const DRect & ininRect,
+                     const MathLib::Point & inoldscale,
+                     ProjLib::Projection * inout,
+                     ProjLib::Projection * inin);
+  virtual ~AffineRowTransform();
+
+  //good returns true if the mapping is affine
+  bool good() const throw();
+
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw();
+
+  virtual bool copyRow(long int ycounter, long int startx, long int count,
+                       long int & inx, long int & iny) throw();
+
+ protected:
+  double x0, y0;                        //input pixel of output pixel 0,0
+  double xx, xy;                        //input x step per output x and y
+  double yx, yy;                        //input y step per output x and y
+  bool affine;                          //whether the fit held
+  bool onetoone;                        //same scale and no rotation
+};
+
+
+
+//SeparableRowTransform is for projections where the input x only
+//depends on the output x and the input y on the output y.  A table of
+//input x for each output column and input y for each output row is
+//projected up front so a row is just a copy out of the tables.
+//good() is false if the tables don't match the projections.
+class SeparableRowTransform : public RowTransform
+{
+ public:
+  /**
+   * The projections are only used in the constructor.
+   * inout is the output projection and inin is the input projection.
+   * innewwidth and innewheight are the size of the output image and
+   * rows can only be projected inside of it.
+   **/
+  SeparableRowTransform(const DRect & inoutRect,
+                        const MathLib::Point & innewscale,
+                        const DRect & ininRect,
+                        const MathLib::Point & inoldscale,
+                        long int innewwidth, long int innewheight,
+                        ProjLib::Projection * inout,
+                        ProjLib::Projection * inin)
+    throw(std::bad_alloc);
+  virtual ~SeparableRowTransform();
+
+  //good returns true if the mapping is separable
+  bool good() const throw();
+
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw();
+
+ protected:
+  long int newwidth, newheight;         //size of the tables
+  double * xtable;                      //input x of each output column
+  double * ytable;                      //input y of each output row
+  bool separable;                       //whether the tables held
+};
+
+
+
+//ApproxRowTransform only projects exactly at the ends and middle of a
+//segment and linearly interpolates the rest when the middle is within
+//maxerror input pixels of the line between the ends.  Segments that
+//are not are split in half and tried again.
+class ApproxRowTransform : public RowTransform
+{
+ public:
+  /**
+   * inexact is the transform used for the exact points and is owned
+   * (deleted) by the approximating transform.
+   * inmaxerror is the allowed error in input pixels.
+   **/
+  ApproxRowTransform(const DRect & inoutRect,
+                     const MathLib::Point & innewscale,
+                     const DRect & ininRect,
+                     const MathLib::Point & inoldscale,
+                     RowTransform * inexact,
+                     double inmaxerror);
+  virtual ~ApproxRowTransform();
+
+  virtual void projectRow(long int ycounter, long int startx,
+                          long int count,
+                          double * xarr, double * yarr) throw();
+
+ protected:
+  //approximate fills in the points between first and last (which must
+  //already be projected), subdividing until the error is acceptable
+  void approximate(long int ycounter, long int startx,
+                   long int first, long int last,
+                   double * xarr, double * yarr) throw();
+
+  RowTransform * exact;                 //the exact transform
+  double maxerror;                      //the maximum error in pixels
+};
+
+#endif
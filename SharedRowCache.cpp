@@ -0,0 +1,502 @@
+/**
+ * Implementation file for SharedRowCache
+ **/
+
+#ifndef SHAREDROWCACHE_CPP_
+#define SHAREDROWCACHE_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "SharedRowCache.h"
+#include <cstdio>
+#include <cstring>
+
+#define SHAREDROWCACHE_MAGIC   0x52524332L //set last by the one setting up
+#define SHAREDROWCACHE_EMPTY   -1L         //row slot when not cached
+#define SHAREDROWCACHE_LOADING -2L         //row slot while being read
+#define SHAREDROWCACHE_TRIES   3           //opens before giving up
+
+SharedRowCache * SharedRowCache::opened = NULL;
+bool SharedRowCache::handlers = false;
+
+//****************************************************************
+SharedRowCache::SharedRowCache(USGSImageLib::ImageIFile * ininfile,
+                               int inbps, long int inrowbytes,
+                               long int inheight)
+  throw(std::bad_alloc)
+  : infile(ininfile), bps(inbps), rowbytes(inrowbytes), height(inheight),
+    rowbuffer(NULL), fd(-1), segment(NULL), segmentsize(0), header(NULL),
+    rowslots(NULL), slotrows(NULL), versions(NULL), referenced(NULL),
+    slots(NULL), nextopen(NULL)
+{
+  if (!(rowbuffer = new (std::nothrow) unsigned char[rowbytes]))
+    throw std::bad_alloc();
+}
+
+//****************************************************************
+SharedRowCache::~SharedRowCache()
+{
+  close();
+  delete [] rowbuffer;
+}
+
+//****************************************************************
+RowCacheStats SharedRowCache::getStats() const throw()
+{
+  return stats;
+}
+
+//****************************************************************
+long int SharedRowCache::getCapacity() const throw()
+{
+  return header ? header->capacity : 0;
+}
+
+//****************************************************************
+void SharedRowCache::closeAll() throw()
+{
+  while (opened)
+    opened->close();
+}
+
+#ifdef _WIN32
+
+//no POSIX shared memory so everything is cached privately
+
+//****************************************************************
+bool SharedRowCache::open(const std::string & filename, long int inbudget)
+  throw()
+{
+  return false;
+}
+
+//****************************************************************
+void SharedRowCache::close() throw()
+{}
+
+//****************************************************************
+const unsigned char * SharedRowCache::getRawScanline(long int y) throw()
+{
+  return NULL;
+}
+
+#else
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//****************************************************************
+static void sharedrowcache_exit()
+{
+  SharedRowCache::closeAll();
+}
+
+//****************************************************************
+bool SharedRowCache::open(const std::string & filename, long int inbudget)
+  throw()
+{
+  const int sigs[3] = {SIGTERM, SIGINT, SIGHUP};
+  struct sigaction action;
+  long int capacity, tries;
+  int counter;
+
+  close();
+
+  try
+  {
+    if ((name = getName(filename)).empty())
+      return false;
+  }
+  catch(...)
+  {
+    return false;
+  }
+
+  //as many slots as fit after the row table
+  capacity = (inbudget - layout(0))/(layout(1) - layout(0));
+  if (capacity > height)
+    capacity = height;
+  if (capacity < 1)
+    return false;
+
+  //make sure a killed job doesn't leave it behind
+  if (!handlers)
+  {
+    handlers = true;
+    std::atexit(sharedrowcache_exit);
+    for (counter = 0; counter < 3; ++counter)
+    {
+      //leave alone anything someone else handles
+      if (!sigaction(sigs[counter], NULL, &action) &&
+          (action.sa_handler == SIG_DFL))
+        std::signal(sigs[counter], handleSignal);
+    }
+  }
+
+  for (tries = 0; tries < SHAREDROWCACHE_TRIES; ++tries)
+  {
+    if ((fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600)) < 0)
+      return false;
+
+    if (setLock(F_WRLCK, false))
+    {
+      //nobody else is using it (it is new or was left behind) so set it
+      //up and let the others in
+      if (!setup(capacity) || !setLock(F_RDLCK, false))
+      {
+        shm_unlink(name.c_str());
+        detach();
+        return false;
+      }
+      addOpen();
+      return true;
+    }
+
+    //wait for whoever has it to finish setting it up
+    if (setLock(F_RDLCK, true) && attach())
+    {
+      addOpen();
+      return true;
+    }
+
+    //it died setting it up or was just removed so start over
+    detach();
+  }
+
+  return false;
+}
+
+//****************************************************************
+void SharedRowCache::close() throw()
+{
+  if (fd < 0)
+    return;
+
+  removeOpen();
+
+  //the last one out (nobody else holds a lock) removes it.  Clearing
+  //ready sends anyone about to attach off to make a new one.
+  if (setLock(F_WRLCK, false))
+  {
+    if (header)
+      header->ready = 0;
+    shm_unlink(name.c_str());
+  }
+
+  detach();
+}
+
+//****************************************************************
+void SharedRowCache::handleSignal(int sig)
+{
+  closeAll();
+  std::signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+//****************************************************************
+bool SharedRowCache::setLock(short int type, bool wait) throw()
+{
+  struct flock lock;
+
+  std::memset(&lock, 0, sizeof(lock));
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  lock.l_start = 0;
+  lock.l_len = 0;                         //the whole segment
+
+  while (fcntl(fd, wait ? F_SETLKW : F_SETLK, &lock) == -1)
+  {
+    if (!wait || (errno != EINTR))
+      return false;
+  }
+  return true;
+}
+
+//****************************************************************
+bool SharedRowCache::attach() throw()
+{
+  struct stat info;
+
+  if (fstat(fd, &info) || (info.st_size < layout(0)))
+    return false;
+
+  segment = static_cast<unsigned char *>
+    (mmap(0, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+  if (segment == reinterpret_cast<unsigned char *>(MAP_FAILED))
+  {
+    segment = NULL;
+    return false;
+  }
+  segmentsize = info.st_size;
+  header = reinterpret_cast<SharedRowCacheHeader *>(segment);
+
+  __sync_synchronize();
+  return (header->ready == SHAREDROWCACHE_MAGIC) &&
+    (header->rowbytes == rowbytes) && (header->height == height) &&
+    (header->capacity > 0) && (layout(header->capacity) <= segmentsize);
+}
+
+//****************************************************************
+bool SharedRowCache::setup(long int incapacity) throw()
+{
+  const long int size = layout(incapacity);
+  long int slot, y;
+
+  //start from nothing in case it was left behind part way through
+  if (ftruncate(fd, 0) || ftruncate(fd, size))
+    return false;
+
+  segment = static_cast<unsigned char *>
+    (mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+  if (segment == reinterpret_cast<unsigned char *>(MAP_FAILED))
+  {
+    segment = NULL;
+    return false;
+  }
+  segmentsize = size;
+  header = reinterpret_cast<SharedRowCacheHeader *>(segment);
+
+  header->rowbytes = rowbytes;
+  header->height = height;
+  header->capacity = incapacity;
+  header->hand = 0;
+  layout(incapacity);
+  for (y = 0; y < height; ++y)
+    rowslots[y] = SHAREDROWCACHE_EMPTY;
+  for (slot = 0; slot < incapacity; ++slot)
+  {
+    slotrows[slot] = -1;
+    versions[slot] = 0;
+    referenced[slot] = 0;
+  }
+  __sync_synchronize();
+  header->ready = SHAREDROWCACHE_MAGIC;
+  return true;
+}
+
+//****************************************************************
+void SharedRowCache::detach() throw()
+{
+  if (segment)
+    munmap(segment, segmentsize);
+  if (fd >= 0)
+    ::close(fd);                          //drops the lock
+
+  segment = NULL;
+  segmentsize = 0;
+  header = NULL;
+  fd = -1;
+}
+
+//****************************************************************
+void SharedRowCache::addOpen() throw()
+{
+  nextopen = opened;
+  opened = this;
+}
+
+//****************************************************************
+void SharedRowCache::removeOpen() throw()
+{
+  SharedRowCache ** link;
+
+  for (link = &opened; *link; link = &((*link)->nextopen))
+  {
+    if (*link == this)
+    {
+      *link = nextopen;
+      break;
+    }
+  }
+  nextopen = NULL;
+}
+
+//****************************************************************
+const unsigned char * SharedRowCache::getRawScanline(long int y) throw()
+{
+  long int slot, tries;
+
+  if (!segment)
+    return NULL;
+
+  for (tries = 0; ; ++tries)
+  {
+    slot = rowslots[y];
+
+    if (slot >= 0)
+    {
+      if (copySlot(slot, y))
+      {
+        ++stats.hits;
+        return rowbuffer;
+      }
+    }
+    else if (slot == SHAREDROWCACHE_EMPTY)
+    {
+      //the first one to miss reads it
+      if (__sync_bool_compare_and_swap(&rowslots[y], SHAREDROWCACHE_EMPTY,
+                                       SHAREDROWCACHE_LOADING))
+      {
+        readRow(y);
+        storeRow(y);
+        ++stats.misses;
+        return rowbuffer;
+      }
+      continue;
+    }
+
+    //someone else is reading it or replacing the slot
+    if (tries > SHAREDROWCACHE_SPINS)
+    {
+      //they are slow (or died) so read it here
+      readRow(y);
+      storeRow(y);
+      ++stats.misses;
+      return rowbuffer;
+    }
+    sched_yield();
+  }
+}
+
+//****************************************************************
+std::string SharedRowCache::getName(const std::string & filename) const
+  throw(std::bad_alloc)
+{
+  unsigned long int hash(2166136261UL);   //FNV-1a of what has to match
+  unsigned long int values[5];
+  const unsigned char * bytes;
+  unsigned long int counter;
+  struct stat info;
+  char buf[64];
+
+  if (stat(filename.c_str(), &info))
+    return std::string();
+
+  values[0] = static_cast<unsigned long int>(info.st_size);
+  values[1] = static_cast<unsigned long int>(info.st_mtime);
+  values[2] = static_cast<unsigned long int>(rowbytes);
+  values[3] = static_cast<unsigned long int>(height);
+  values[4] = static_cast<unsigned long int>(getuid());
+
+  for (counter = 0; counter < filename.size(); ++counter)
+    hash = (hash ^ static_cast<unsigned char>(filename[counter]))
+      * 16777619UL;
+  bytes = reinterpret_cast<const unsigned char *>(values);
+  for (counter = 0; counter < sizeof(values); ++counter)
+    hash = (hash ^ bytes[counter]) * 16777619UL;
+
+  std::sprintf(buf, "/reprojector-%lx", hash);
+  return std::string(buf);
+}
+
+//****************************************************************
+long int SharedRowCache::layout(long int incapacity) throw()
+{
+  long int offset(sizeof(SharedRowCacheHeader));
+
+  if (segment && incapacity)
+  {
+    rowslots = reinterpret_cast<volatile long int *>(segment + offset);
+    offset += height*sizeof(long int);
+    slotrows = reinterpret_cast<volatile long int *>(segment + offset);
+    offset += incapacity*sizeof(long int);
+    versions = reinterpret_cast<volatile unsigned long int *>
+      (segment + offset);
+    offset += incapacity*sizeof(unsigned long int);
+    referenced = reinterpret_cast<volatile long int *>(segment + offset);
+    offset += incapacity*sizeof(long int);
+    slots = segment + offset;
+    return offset + incapacity*rowbytes;
+  }
+
+  return offset + height*sizeof(long int)
+    + incapacity*(2*sizeof(long int) + sizeof(unsigned long int) + rowbytes);
+}
+
+//****************************************************************
+bool SharedRowCache::copySlot(long int slot, long int y) throw()
+{
+  const unsigned long int version = versions[slot];
+
+  if (version & 1)
+    return false;                         //being written
+  __sync_synchronize();
+  if (slotrows[slot] != y)
+    return false;                         //replaced since the lookup
+
+  std::memcpy(rowbuffer, slots + slot*rowbytes, rowbytes);
+  __sync_synchronize();
+  if (versions[slot] != version)
+    return false;                         //replaced while copying
+
+  if (!referenced[slot])
+    referenced[slot] = 1;
+  return true;
+}
+
+//****************************************************************
+void SharedRowCache::readRow(long int y) throw()
+{
+  if (bps == 16)
+    dynamic_cast<USGSImageLib::TIFFImageIFile*>(infile)
+      ->getRawScanline(y, static_cast<tdata_t>(rowbuffer));
+  else
+    infile->getRawScanline(y, rowbuffer);
+}
+
+//****************************************************************
+void SharedRowCache::storeRow(long int y) throw()
+{
+  const long int capacity = header->capacity;
+  unsigned long int version;
+  long int slot, old, steps;
+
+  //go around the clock twice at most so every slot gets a second chance
+  for (steps = 0; steps < 2*capacity + 1; ++steps)
+  {
+    slot = __sync_fetch_and_add(&header->hand, 1) % capacity;
+    if (referenced[slot])
+    {
+      referenced[slot] = 0;
+      continue;
+    }
+
+    //take the slot by making its version odd
+    version = versions[slot];
+    if ((version & 1) ||
+        !__sync_bool_compare_and_swap(&versions[slot], version, version + 1))
+      continue;
+
+    if (((old = slotrows[slot]) >= 0) &&
+        __sync_bool_compare_and_swap(&rowslots[old], slot,
+                                     SHAREDROWCACHE_EMPTY))
+      ++stats.evictions;
+
+    std::memcpy(slots + slot*rowbytes, rowbuffer, rowbytes);
+    slotrows[slot] = y;
+    __sync_synchronize();
+    versions[slot] = version + 2;
+    __sync_synchronize();
+    rowslots[y] = slot;                   //publish it
+    return;
+  }
+
+  //everything was busy so leave it for the next one to miss
+  __sync_bool_compare_and_swap(&rowslots[y], SHAREDROWCACHE_LOADING,
+                               SHAREDROWCACHE_EMPTY);
+}
+
+#endif
+
+#endif
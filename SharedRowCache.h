@@ -0,0 +1,172 @@
+/**
+ * SharedRowCache keeps input scanlines in a POSIX shared memory segment
+ * so all the slaves on a node use one cache instead of each keeping its
+ * own copy of the same rows.  The segment is named after the input file
+ * (its name, size and modification time) and the row layout, so every
+ * process reading the same input attaches to the same one.
+ *
+ * Every process attached holds a read lock on the segment, which the
+ * system drops if the process dies.  Whoever gets the write lock has
+ * the segment to itself, so it sets it up from scratch; a segment left
+ * behind by processes that were killed is reset by the next one to open
+ * it.  The last process to detach (the one that can get the write lock)
+ * removes it.  SIGTERM, SIGINT and SIGHUP (how MPI_Abort stops a job)
+ * and exit detach everything still open so nothing is left behind.
+ *
+ * The segment holds a header, the slot of each row (or empty or being
+ * loaded), the row in each slot with a version and reference flag, and
+ * then the slots themselves.  Lookups take no lock: a reader copies the
+ * slot out and checks the version didn't change while it did.  The
+ * first process to miss a row claims it with a compare and swap, reads
+ * it from the file and publishes it; the others wait for it and reuse
+ * it (or read it themselves if it takes too long).  Full slots are
+ * replaced by the clock algorithm, which skips slots used since the
+ * hand last passed.
+ *
+ * Rows are copied out so the pointer returned is private to the caller.
+ *
+ * The segment needs POSIX shared memory; on _WIN32 open always fails
+ * and the rows are cached privately.
+ **/
+
+#ifndef SHAREDROWCACHE_H_
+#define SHAREDROWCACHE_H_
+
+#include <new>
+#include <string>
+#include "ImageLib/TIFFImageIFile.h"
+#include "RowCache.h"
+
+#define SHAREDROWCACHE_SPINS 100000 //waits on another loader before
+                                    //reading the row here
+
+
+//The start of the segment
+struct SharedRowCacheHeader
+{
+  volatile long int ready;                //the magic number once set up
+  long int rowbytes;                      //bytes in a row
+  long int height;                        //rows in the input
+  long int capacity;                      //number of slots
+  volatile unsigned long int hand;        //the clock hand
+};
+
+
+class SharedRowCache
+{
+ public:
+  /**
+   * Main constructor.  infile is not owned.  inbps is the bits per
+   * sample, inrowbytes the bytes in a row and inheight the number of
+   * rows.  Nothing is attached until open is called.
+   **/
+  SharedRowCache(USGSImageLib::ImageIFile * ininfile, int inbps,
+                 long int inrowbytes, long int inheight)
+    throw(std::bad_alloc);
+
+  /**
+   * Destructor detaches from the segment.
+   **/
+  ~SharedRowCache();
+
+  /**
+   * open creates or attaches to the segment for filename with room for
+   * inbudget bytes of segment.  Returns false if it couldn't be (the
+   * rows then have to be cached privately).
+   **/
+  bool open(const std::string & filename, long int inbudget) throw();
+
+  /**
+   * close detaches from the segment and removes it if this was the
+   * last process using it.
+   **/
+  void close() throw();
+
+  /**
+   * closeAll closes every SharedRowCache open in this process.  It is
+   * called on exit and from the signal handlers.
+   **/
+  static void closeAll() throw();
+
+  /**
+   * getRawScanline returns a pointer to a copy of row y, reading it if
+   * no process has it cached.  The pointer is only good until the next
+   * call.  Returns NULL if it isn't open.
+   **/
+  const unsigned char * getRawScanline(long int y) throw();
+
+  /**
+   * getStats returns what this process got out of the cache.  Evictions
+   * are the rows this process threw out for others.
+   **/
+  RowCacheStats getStats() const throw();
+
+  /**
+   * getCapacity returns the number of rows the segment holds.
+   **/
+  long int getCapacity() const throw();
+
+ protected:
+  //getName returns the segment name for filename
+  std::string getName(const std::string & filename) const
+    throw(std::bad_alloc);
+
+  //setLock sets a lock of type (F_RDLCK, F_WRLCK or F_UNLCK) on the
+  //segment, waiting for it if wait is true.  Returns true if it did.
+  bool setLock(short int type, bool wait) throw();
+
+  //attach maps the segment and checks it was set up for this input
+  bool attach() throw();
+
+  //setup sizes, maps and sets up the segment for incapacity slots.  The
+  //write lock has to be held.
+  bool setup(long int incapacity) throw();
+
+  //detach unmaps the segment and closes it (dropping the lock)
+  void detach() throw();
+
+  //addOpen and removeOpen keep the list of open caches for closeAll
+  void addOpen() throw();
+  void removeOpen() throw();
+
+  //handleSignal closes everything and dies of the signal
+  static void handleSignal(int sig);
+
+  //layout points the tables into the segment (if it is mapped) for
+  //incapacity slots and returns the bytes the segment needs
+  long int layout(long int incapacity) throw();
+
+  //copySlot copies slot into the row buffer.  Returns false if the slot
+  //doesn't hold row y or changed while it was copied.
+  bool copySlot(long int slot, long int y) throw();
+
+  //readRow reads row y from the file into the row buffer
+  void readRow(long int y) throw();
+
+  //storeRow puts the row buffer in a slot as row y, which this process
+  //has claimed, and publishes it
+  void storeRow(long int y) throw();
+
+  USGSImageLib::ImageIFile * infile;      //the input file
+  int bps;                                //bits per sample
+  long int rowbytes;                      //bytes in a row
+  long int height;                        //rows in the input
+  unsigned char * rowbuffer;              //this process's copy of a row
+  std::string name;                       //segment name
+  int fd;                                 //the segment or -1
+  unsigned char * segment;                //the mapped segment or NULL
+  long int segmentsize;                   //bytes mapped
+  SharedRowCacheHeader * header;          //the segment header
+  volatile long int * rowslots;           //slot of each row
+  volatile long int * slotrows;           //row in each slot or -1
+  volatile unsigned long int * versions;  //odd while a slot is written
+  volatile long int * referenced;         //slot used since the hand
+  unsigned char * slots;                  //the rows
+  RowCacheStats stats;                    //what this process got
+  SharedRowCache * nextopen;              //next in the list of open ones
+
+  static SharedRowCache * opened;         //caches open in this process
+  static bool handlers;                   //exit and signals are handled
+};
+
+#endif
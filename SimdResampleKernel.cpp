@@ -0,0 +1,371 @@
+/**
+ * SIMD versions of the nearest neighbour resampling kernels.
+ *
+ * Both versions do the index math (round, convert to int and bounds
+ * test) on vectors of coordinates and turn the bounds test into a mask.
+ * The AVX2 kernels then use the hardware gather when all of the pixels
+ * in a vector are in bounds and come from the same input row, which is
+ * by far the common case.  Anything else drops back to fixed width
+ * scalar copies for that vector.  The SSE2 kernels only vectorize the
+ * index math since there is no gather instruction before AVX2.
+ *
+ * The kernels are compiled with the gcc target pragmas so the rest of
+ * the program does not need to be built for AVX2, and getSimdResampleFunc
+ * checks the cpu at run time.  Define PROJECTOR_NO_SIMD to leave them out.
+ **/
+
+#ifndef SIMDRESAMPLEKERNEL_CPP_
+#define SIMDRESAMPLEKERNEL_CPP_
+
+#include "ResampleKernel.h"
+
+#if !defined(PROJECTOR_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define PROJECTOR_SIMD
+#endif
+
+#ifndef PROJECTOR_SIMD
+
+//**********************************************************************
+ResampleFunc getSimdResampleFunc(int, int) throw()
+{
+  return NULL;                               //no simd kernels built
+}
+
+#else
+
+#include <immintrin.h>
+
+
+//GatherTraits describes how many bytes the AVX2 kernel loads for each
+//pixel.  Pixels closer than that to the end of the row are done with
+//scalar copies so the gather never reads past the row.
+template <class T, int SPP>
+struct GatherTraits
+{
+  enum { loadbytes = (SPP*sizeof(T) <= 4) ? 4 : 8 };
+};
+
+
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+//**********************************************************************
+//gatherRow8 copies 8 pixels that all live on input row inrow.
+//xv holds the input pixel numbers.
+template <class T, int SPP>
+static inline void gatherRow8(const T * inrow, __m256i xv, T * out);
+
+//**********************************************************************
+template <>
+inline void gatherRow8<unsigned char, 1>(const unsigned char * inrow,
+                                         __m256i xv, unsigned char * out)
+{
+  const __m256i pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1,
+                                        -1, -1, -1, -1, -1, -1, -1, -1,
+                                        0, 4, 8, 12, -1, -1, -1, -1,
+                                        -1, -1, -1, -1, -1, -1, -1, -1);
+  __m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int *>(inrow),
+                                     xv, 1);
+  g = _mm256_shuffle_epi8(g, pick);
+  g = _mm256_permutevar8x32_epi32(g, _mm256_setr_epi32(0, 4, 1, 1,
+                                                       1, 1, 1, 1));
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(out),
+                   _mm256_castsi256_si128(g));
+}
+
+//**********************************************************************
+template <>
+inline void gatherRow8<unsigned char, 3>(const unsigned char * inrow,
+                                         __m256i xv, unsigned char * out)
+{
+  const __m256i pick = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                                        10, 12, 13, 14, -1, -1, -1, -1,
+                                        0, 1, 2, 4, 5, 6, 8, 9,
+                                        10, 12, 13, 14, -1, -1, -1, -1);
+  __m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int *>(inrow),
+                                     _mm256_add_epi32
+                                     (xv, _mm256_slli_epi32(xv, 1)), 1);
+  g = _mm256_shuffle_epi8(g, pick);
+  g = _mm256_permutevar8x32_epi32(g, _mm256_setr_epi32(0, 1, 2, 4,
+                                                       5, 6, 6, 6));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                   _mm256_castsi256_si128(g));
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(out + 16),
+                   _mm256_extracti128_si256(g, 1));
+}
+
+//**********************************************************************
+template <>
+inline void gatherRow8<unsigned char, 4>(const unsigned char * inrow,
+                                         __m256i xv, unsigned char * out)
+{
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                      _mm256_i32gather_epi32
+                      (reinterpret_cast<const int *>(inrow), xv, 4));
+}
+
+//**********************************************************************
+template <>
+inline void gatherRow8<uint16, 1>(const uint16 * inrow,
+                                  __m256i xv, uint16 * out)
+{
+  const __m256i pick = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13,
+                                        -1, -1, -1, -1, -1, -1, -1, -1,
+                                        0, 1, 4, 5, 8, 9, 12, 13,
+                                        -1, -1, -1, -1, -1, -1, -1, -1);
+  __m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int *>(inrow),
+                                     xv, 2);
+  g = _mm256_shuffle_epi8(g, pick);
+  g = _mm256_permute4x64_epi64(g, 0x08);     //qwords 0 and 2
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                   _mm256_castsi256_si128(g));
+}
+
+//**********************************************************************
+template <>
+inline void gatherRow8<uint16, 3>(const uint16 * inrow,
+                                  __m256i xv, uint16 * out)
+{
+  const __m256i pick = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9,
+                                        10, 11, 12, 13, -1, -1, -1, -1,
+                                        0, 1, 2, 3, 4, 5, 8, 9,
+                                        10, 11, 12, 13, -1, -1, -1, -1);
+  const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 6, 6);
+  const long long int * base = reinterpret_cast<const long long int *>
+    (inrow);
+  __m256i off, g;
+  unsigned char * bout = reinterpret_cast<unsigned char *>(out);
+  int half;
+
+  off = _mm256_mullo_epi32(xv, _mm256_set1_epi32(6));
+  for (half = 0; half < 2; ++half)
+  {
+    g = _mm256_i32gather_epi64(base, half ? _mm256_extracti128_si256(off, 1)
+                               : _mm256_castsi256_si128(off), 1);
+    g = _mm256_shuffle_epi8(g, pick);
+    g = _mm256_permutevar8x32_epi32(g, perm);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(bout + 24*half),
+                     _mm256_castsi256_si128(g));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(bout + 24*half + 16),
+                     _mm256_extracti128_si256(g, 1));
+  }
+}
+
+//**********************************************************************
+template <>
+inline void gatherRow8<uint16, 4>(const uint16 * inrow,
+                                  __m256i xv, uint16 * out)
+{
+  const long long int * base = reinterpret_cast<const long long int *>
+    (inrow);
+
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                      _mm256_i32gather_epi64
+                      (base, _mm256_castsi256_si128(xv), 8));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 16),
+                      _mm256_i32gather_epi64
+                      (base, _mm256_extracti128_si256(xv, 1), 8));
+}
+
+//**********************************************************************
+template <class T, int SPP>
+class Avx2ResampleKernel
+{
+ public:
+  static void resampleRow(const double * xarr, const double * yarr,
+                          long int count, long int width,
+                          long int height, int spp,
+                          InputRows & rows,
+                          unsigned char * scanline)
+  {
+    T * out = reinterpret_cast<T *>(scanline);  //output pixel
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d low = _mm256_set1_pd(-1.0);
+    const __m256d dwidth = _mm256_set1_pd(static_cast<double>(width));
+    const __m256d dheight = _mm256_set1_pd(static_cast<double>(height));
+    //the last pixel the gather can load without going past the row
+    const long int pixelbytes = SPP*static_cast<long int>(sizeof(T));
+    const __m256i safex = _mm256_set1_epi32
+      (static_cast<int>((width*pixelbytes
+                         - static_cast<long int>
+                         (GatherTraits<T, SPP>::loadbytes)) / pixelbytes));
+    __m256d x0, x1, y0, y1;
+    __m256i xv, yv;
+    int mask, y, counter2;
+    int xi[8], yi[8];
+    long int counter(0);
+
+    for (; counter + 8 <= count; counter += 8, out += 8*SPP)
+    {
+      x0 = _mm256_add_pd(_mm256_loadu_pd(xarr + counter), half);
+      x1 = _mm256_add_pd(_mm256_loadu_pd(xarr + counter + 4), half);
+      y0 = _mm256_add_pd(_mm256_loadu_pd(yarr + counter), half);
+      y1 = _mm256_add_pd(_mm256_loadu_pd(yarr + counter + 4), half);
+
+      //bounds test as a mask (NaNs compare false)
+      mask = _mm256_movemask_pd
+        (_mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(x0, low, _CMP_GT_OQ),
+                                     _mm256_cmp_pd(x0, dwidth, _CMP_LT_OQ)),
+                       _mm256_and_pd(_mm256_cmp_pd(y0, low, _CMP_GT_OQ),
+                                     _mm256_cmp_pd(y0, dheight,
+                                                   _CMP_LT_OQ))))
+        | (_mm256_movemask_pd
+           (_mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(x1, low, _CMP_GT_OQ),
+                                        _mm256_cmp_pd(x1, dwidth,
+                                                      _CMP_LT_OQ)),
+                          _mm256_and_pd(_mm256_cmp_pd(y1, low, _CMP_GT_OQ),
+                                        _mm256_cmp_pd(y1, dheight,
+                                                      _CMP_LT_OQ)))) << 4);
+
+      xv = _mm256_inserti128_si256
+        (_mm256_castsi128_si256(_mm256_cvttpd_epi32(x0)),
+         _mm256_cvttpd_epi32(x1), 1);
+      yv = _mm256_inserti128_si256
+        (_mm256_castsi128_si256(_mm256_cvttpd_epi32(y0)),
+         _mm256_cvttpd_epi32(y1), 1);
+
+      if (mask == 0xff)
+      {
+        y = _mm_cvtsi128_si32(_mm256_castsi256_si128(yv));
+        if ((_mm256_movemask_epi8(_mm256_cmpeq_epi32
+                                  (yv, _mm256_set1_epi32(y))) == -1)
+            && !_mm256_movemask_epi8(_mm256_cmpgt_epi32(xv, safex)))
+        {
+          gatherRow8<T, SPP>(reinterpret_cast<const T *>(rows.getRow(y)),
+                             xv, out);
+          continue;
+        }
+      }
+
+      //mixed rows or out of bounds pixels so copy one at a time
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(xi), xv);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(yi), yv);
+      for (counter2 = 0; counter2 < 8; ++counter2)
+      {
+        if (mask & (1 << counter2))
+          copyPixel<T, SPP>(out + counter2*SPP,
+                            reinterpret_cast<const T *>
+                            (rows.getRow(yi[counter2]))
+                            + xi[counter2]*SPP);
+        else
+          zeroPixel<T, SPP>(out + counter2*SPP);
+      }
+    }
+
+    //finish the row
+    ResampleKernel<T, SPP>::resampleRow(xarr + counter, yarr + counter,
+                                        count - counter, width, height,
+                                        spp, rows,
+                                        reinterpret_cast<unsigned char *>
+                                        (out));
+  }
+};
+
+#pragma GCC pop_options
+
+
+//**********************************************************************
+template <class T, int SPP>
+class Sse2ResampleKernel
+{
+ public:
+  static void resampleRow(const double * xarr, const double * yarr,
+                          long int count, long int width,
+                          long int height, int spp,
+                          InputRows & rows,
+                          unsigned char * scanline)
+  {
+    T * out = reinterpret_cast<T *>(scanline);  //output pixel
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d low = _mm_set1_pd(-1.0);
+    const __m128d dwidth = _mm_set1_pd(static_cast<double>(width));
+    const __m128d dheight = _mm_set1_pd(static_cast<double>(height));
+    __m128d x, y;
+    int mask, counter2;
+    int xi[4], yi[4];
+    long int counter(0);
+
+    for (; counter + 2 <= count; counter += 2, out += 2*SPP)
+    {
+      x = _mm_add_pd(_mm_loadu_pd(xarr + counter), half);
+      y = _mm_add_pd(_mm_loadu_pd(yarr + counter), half);
+
+      mask = _mm_movemask_pd
+        (_mm_and_pd(_mm_and_pd(_mm_cmpgt_pd(x, low), _mm_cmplt_pd(x, dwidth)),
+                    _mm_and_pd(_mm_cmpgt_pd(y, low),
+                               _mm_cmplt_pd(y, dheight))));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(xi), _mm_cvttpd_epi32(x));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(yi), _mm_cvttpd_epi32(y));
+      for (counter2 = 0; counter2 < 2; ++counter2)
+      {
+        if (mask & (1 << counter2))
+          copyPixel<T, SPP>(out + counter2*SPP,
+                            reinterpret_cast<const T *>
+                            (rows.getRow(yi[counter2]))
+                            + xi[counter2]*SPP);
+        else
+          zeroPixel<T, SPP>(out + counter2*SPP);
+      }
+    }
+
+    //finish the row
+    ResampleKernel<T, SPP>::resampleRow(xarr + counter, yarr + counter,
+                                        count - counter, width, height,
+                                        spp, rows,
+                                        reinterpret_cast<unsigned char *>
+                                        (out));
+  }
+};
+
+
+//**********************************************************************
+template <template <class, int> class K>
+static ResampleFunc pickKernel(int bps, int spp) throw()
+{
+  if (bps == 16)
+  {
+    switch(spp)
+    {
+    case 1:
+      return &K<uint16, 1>::resampleRow;
+    case 3:
+      return &K<uint16, 3>::resampleRow;
+    case 4:
+      return &K<uint16, 4>::resampleRow;
+    default:
+      return NULL;
+    }
+  }
+
+  switch(spp)                                //8 bits per sample
+  {
+  case 1:
+    return &K<unsigned char, 1>::resampleRow;
+  case 3:
+    return &K<unsigned char, 3>::resampleRow;
+  case 4:
+    return &K<unsigned char, 4>::resampleRow;
+  default:
+    return NULL;
+  }
+}
+
+//**********************************************************************
+ResampleFunc getSimdResampleFunc(int bps, int spp) throw()
+{
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    return pickKernel<Avx2ResampleKernel>(bps, spp);
+
+  if (__builtin_cpu_supports("sse2"))
+    return pickKernel<Sse2ResampleKernel>(bps, spp);
+
+  return NULL;
+}
+
+#endif
+
+#endif
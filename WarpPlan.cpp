@@ -0,0 +1,381 @@
+/**
+ * Implementation file for WarpPlan
+ **/
+
+#ifndef WARPPLAN_CPP_
+#define WARPPLAN_CPP_
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+#include "WarpPlan.h"
+#include <fstream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//Longs in the file header: magic, key, newwidth, newheight, oldwidth,
+//oldheight, run count and the error in millionths of an input pixel
+#define WARPPLAN_HEADER 8
+
+//The magic is "WPLN" and the version
+#define WARPPLAN_MAGIC (0x4e4c5057LL | (static_cast<long long int> \
+                                        (WARPPLAN_VERSION) << 32))
+
+//****************************************************************
+WarpPlan::WarpPlan() : map(NULL), mapsize(0), height(0), error(0.0),
+                       rowstart(NULL), runs(NULL)
+{}
+
+//****************************************************************
+WarpPlan::~WarpPlan()
+{
+  close();
+}
+
+//****************************************************************
+unsigned long long int WarpPlan::hash(const void * data, long int size,
+                                      unsigned long long int key) throw()
+{
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  long int counter;
+
+  if (!data)
+    return 14695981039346656037ULL;          //the FNV offset basis
+
+  for (counter = 0; counter < size; ++counter)
+  {
+    key ^= bytes[counter];
+    key *= 1099511628211ULL;                 //the FNV prime
+  }
+
+  return key;
+}
+
+//****************************************************************
+bool WarpPlan::build(const std::string & filename,
+                     unsigned long long int key,
+                     RowTransform & transform, const Footprint & footprint,
+                     long int newwidth, long int newheight,
+                     long int oldwidth, long int oldheight,
+                     long int pixelbytes, double inerror) throw()
+{
+  //written to a temporary and renamed so no one maps half a plan.  It
+  //is named for the host and process so jobs building the same plan
+  //(maybe on other nodes sharing the directory) don't write over it.
+  std::string tempname;
+  char host[256];                            //this node
+  char id[300];                              //the host and process
+  const double dwidth = static_cast<double>(oldwidth);
+  const double dheight = static_cast<double>(oldheight);
+  std::ofstream outfile;
+  std::vector<WarpRun> runs;                 //runs of a row
+  std::vector<long long int> rowstart(newheight + 1);
+  long long int header[WARPPLAN_HEADER];
+  double * xarr(0), * yarr(0);               //a projected row
+  long int * xidx(0), * yidx(0);             //the row as input pixels
+  unsigned char * scanline(0);               //for clipRow
+  long int ycounter, startx, count, counter;
+  long long int total(0);                    //runs so far
+  double tx, ty;
+
+  try
+  {
+    if (!(xarr = new (std::nothrow) double[newwidth + 1]))
+      throw std::bad_alloc();
+    if (!(yarr = new (std::nothrow) double[newwidth + 1]))
+      throw std::bad_alloc();
+    if (!(xidx = new (std::nothrow) long int[newwidth + 1]))
+      throw std::bad_alloc();
+    if (!(yidx = new (std::nothrow) long int[newwidth + 1]))
+      throw std::bad_alloc();
+    if (!(scanline = new (std::nothrow) unsigned char
+          [newwidth*pixelbytes + 1]))
+      throw std::bad_alloc();
+
+    if (gethostname(host, sizeof(host)))
+      std::strcpy(host, "localhost");
+    host[sizeof(host) - 1] = 0;
+    std::sprintf(id, ".%s.%ld.tmp", host, static_cast<long int>(getpid()));
+    tempname = filename + id;
+
+    outfile.open(tempname.c_str(), std::ios::out | std::ios::binary);
+    if (!outfile)
+      throw std::bad_alloc();
+
+    //the header and row starts are filled in at the end
+    outfile.write(reinterpret_cast<const char *>(header), sizeof(header));
+    outfile.write(reinterpret_cast<const char *>(&(rowstart[0])),
+                  (newheight + 1)*sizeof(long long int));
+
+    for (ycounter = 0; ycounter < newheight; ++ycounter)
+    {
+      rowstart[ycounter] = total;
+      footprint.clipRow(ycounter, scanline, startx, count);
+      if (!count)
+        continue;
+
+      transform.projectRow(ycounter, startx, count, xarr, yarr);
+
+      //round the same way as the kernels
+      for (counter = 0; counter < count; ++counter)
+      {
+        tx = xarr[counter] + 0.5;
+        ty = yarr[counter] + 0.5;
+        if ((tx > -1.0) && (tx < dwidth) && (ty > -1.0) && (ty < dheight))
+        {
+          xidx[counter] = static_cast<long int>(tx);
+          yidx[counter] = static_cast<long int>(ty);
+        }
+        else
+          xidx[counter] = yidx[counter] = -1;
+      }
+
+      runs.clear();
+      addRuns(xidx, yidx, startx, count, runs);
+      outfile.write(reinterpret_cast<const char *>(&(runs[0])),
+                    runs.size()*sizeof(WarpRun));
+      total += runs.size();
+    }
+    rowstart[newheight] = total;
+
+    header[0] = WARPPLAN_MAGIC;
+    header[1] = static_cast<long long int>(key);
+    header[2] = newwidth;
+    header[3] = newheight;
+    header[4] = oldwidth;
+    header[5] = oldheight;
+    header[6] = total;
+    header[7] = static_cast<long long int>(std::ceil(inerror*1e6));
+    outfile.seekp(0);
+    outfile.write(reinterpret_cast<const char *>(header), sizeof(header));
+    outfile.write(reinterpret_cast<const char *>(&(rowstart[0])),
+                  (newheight + 1)*sizeof(long long int));
+    outfile.close();
+    if (!outfile || std::rename(tempname.c_str(), filename.c_str()))
+      throw std::bad_alloc();
+
+    delete [] xarr;
+    delete [] yarr;
+    delete [] xidx;
+    delete [] yidx;
+    delete [] scanline;
+    return true;
+  }
+  catch(...)
+  {
+    if (outfile.is_open())
+      outfile.close();
+    if (!tempname.empty())
+      std::remove(tempname.c_str());
+    delete [] xarr;
+    delete [] yarr;
+    delete [] xidx;
+    delete [] yidx;
+    delete [] scanline;
+    return false;
+  }
+}
+
+//****************************************************************
+void WarpPlan::addRuns(const long int * xidx, const long int * yidx,
+                       long int startx, long int count,
+                       std::vector<WarpRun> & runs) throw(std::bad_alloc)
+{
+  const double one = 4294967296.0;           //1.0 in 32.32
+  WarpRun run;
+  long int first(0), length, counter;
+  long long int fixed;
+  double low, high, newlow, newhigh;
+
+  run.pad = 0;
+  while (first < count)
+  {
+    run.startx = startx + first;
+    run.iny = yidx[first];
+
+    if (run.iny < 0)                          //off the input
+    {
+      for (length = 1; (first + length < count) &&
+             (yidx[first + length] < 0); ++length);
+      run.fixed = run.step = 0;
+      run.count = length;
+      runs.push_back(run);
+      first += length;
+      continue;
+    }
+
+    //narrow the steps that put every pixel so far in its column when
+    //starting from the middle of the first one
+    low = -1e30;
+    high = 1e30;
+    for (length = 1; (first + length < count) &&
+           (yidx[first + length] == run.iny); ++length)
+    {
+      newlow = (xidx[first + length] - xidx[first] - 0.5)/length;
+      newhigh = (xidx[first + length] - xidx[first] + 0.5)/length;
+      if (newlow < low)
+        newlow = low;
+      if (newhigh > high)
+        newhigh = high;
+      if (newlow >= newhigh)
+        break;
+      low = newlow;
+      high = newhigh;
+    }
+
+    run.fixed = (static_cast<long long int>(xidx[first]) << 32)
+      + (1LL << 31);
+    run.step = (length > 1) ?
+      static_cast<long long int>((low + high)*0.5*one) : 0;
+
+    //the step is rounded so check it
+    fixed = run.fixed;
+    for (counter = 0; counter < length; ++counter, fixed += run.step)
+    {
+      if ((fixed >> 32) != xidx[first + counter])
+        break;
+    }
+
+    run.count = counter;
+    runs.push_back(run);
+    first += counter;
+  }
+}
+
+//****************************************************************
+bool WarpPlan::open(const std::string & filename,
+                    unsigned long long int key,
+                    long int newwidth, long int newheight,
+                    long int oldwidth, long int oldheight) throw()
+{
+  const long long int * header;
+  struct stat info;
+  int fd;
+
+  close();
+
+  if ((fd = ::open(filename.c_str(), O_RDONLY)) < 0)
+    return false;
+
+  if (fstat(fd, &info) ||
+      (info.st_size < static_cast<off_t>(WARPPLAN_HEADER
+                                          *sizeof(long long int))))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  mapsize = info.st_size;
+  map = mmap(NULL, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);                                //the map keeps the file
+  if (map == MAP_FAILED)
+  {
+    map = NULL;
+    return false;
+  }
+
+  header = static_cast<const long long int *>(map);
+  height = newheight;
+  rowstart = header + WARPPLAN_HEADER;
+  runs = reinterpret_cast<const WarpRun *>(rowstart + newheight + 1);
+
+  if ((header[0] != WARPPLAN_MAGIC) ||
+      (header[1] != static_cast<long long int>(key)) ||
+      (header[2] != newwidth) || (header[3] != newheight) ||
+      (header[4] != oldwidth) || (header[5] != oldheight) ||
+      (mapsize != static_cast<long int>
+       ((WARPPLAN_HEADER + newheight + 1)*sizeof(long long int)
+        + header[6]*sizeof(WarpRun))))
+  {
+    close();
+    return false;
+  }
+
+  error = header[7]/1e6;
+  return true;
+}
+
+//****************************************************************
+void WarpPlan::close() throw()
+{
+  if (map)
+    munmap(map, mapsize);
+  map = NULL;
+  mapsize = 0;
+  height = 0;
+  error = 0.0;
+  rowstart = NULL;
+  runs = NULL;
+}
+
+//****************************************************************
+void WarpPlan::projectRowIndices(long int ycounter, long int startx,
+                                 long int count, long int * xidx,
+                                 long int * yidx) const throw()
+{
+  const WarpRun * run = runs + rowstart[ycounter];
+  const WarpRun * end = runs + rowstart[ycounter + 1];
+  const WarpRun * middle;
+  long int x(startx), stop(startx + count), runstop;
+  long long int fixed;
+
+  //find the first run that doesn't end before startx
+  while (run < end)
+  {
+    middle = run + (end - run)/2;
+    if (middle->startx + middle->count <= startx)
+      run = middle + 1;
+    else
+      end = middle;
+  }
+  end = runs + rowstart[ycounter + 1];
+
+  for (; (x < stop) && (run < end); ++run)
+  {
+    for (; (x < run->startx) && (x < stop); ++x, ++xidx, ++yidx)
+      *xidx = *yidx = -1;                    //not in the plan
+
+    runstop = run->startx + run->count;
+    if (runstop > stop)
+      runstop = stop;
+
+    if (run->iny < 0)
+    {
+      for (; x < runstop; ++x, ++xidx, ++yidx)
+        *xidx = *yidx = -1;
+      continue;
+    }
+
+    fixed = run->fixed + (x - run->startx)*run->step;
+    for (; x < runstop; ++x, ++xidx, ++yidx, fixed += run->step)
+    {
+      *xidx = static_cast<long int>(fixed >> 32);
+      *yidx = run->iny;
+    }
+  }
+
+  for (; x < stop; ++x, ++xidx, ++yidx)
+    *xidx = *yidx = -1;
+}
+
+//****************************************************************
+long int WarpPlan::getRunCount() const throw()
+{
+  return runs ? static_cast<long int>(rowstart[height]) : 0;
+}
+
+//****************************************************************
+double WarpPlan::getError() const throw()
+{
+  return error;
+}
+
+#endif
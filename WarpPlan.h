@@ -0,0 +1,123 @@
+/**
+ * WarpPlan is the output to input mapping of a whole job compiled down
+ * to runs of output pixels.  A run is a stretch of an output row that
+ * lands on a single input row with the input column stepping by a
+ * constant (32.32 fixed point) amount, or a stretch that is off the
+ * input.  The plan is built once from a RowTransform, saved to a file
+ * named after a key of everything the mapping depends on and memory
+ * mapped by later runs (or the slaves) so they don't project anything.
+ *
+ * The pixels a plan gives are the ones the double kernels would round
+ * to, so a job run from a plan comes out the same as the job that
+ * built it.
+ **/
+
+#ifndef WARPPLAN_H_
+#define WARPPLAN_H_
+
+#include <new>
+#include <string>
+#include <vector>
+#include "RowTransform.h"
+#include "Footprint.h"
+
+//File name extension of saved plans
+#define WARPPLAN_EXT ".wpl"
+
+//Changed whenever the file layout or the mapping changes so old plans
+//are rebuilt
+#define WARPPLAN_VERSION 4
+
+
+//One run of a plan
+struct WarpRun
+{
+  long long int fixed;                   //input column of startx, 32.32
+  long long int step;                    //column step per pixel, 32.32
+  int startx;                            //first output pixel
+  int count;                             //number of output pixels
+  int iny;                               //input row (-1 is off the input)
+  int pad;
+};
+
+
+class WarpPlan
+{
+ public:
+  /**
+   * Constructor and Destructor
+   **/
+  WarpPlan();
+  ~WarpPlan();
+
+  /**
+   * hash adds size bytes of data to a key (64 bit FNV-1a).  Start with
+   * WarpPlan::hash(0, 0, 0).
+   **/
+  static unsigned long long int hash(const void * data, long int size,
+                                     unsigned long long int key) throw();
+
+  /**
+   * build compiles the plan for a newwidth by newheight output image
+   * from transform over the spans of footprint and saves it to
+   * filename.  oldwidth and oldheight are the input dimensions and
+   * inerror is the most transform can be off (in input pixels), which
+   * is saved for getError.  Returns false if it couldn't be built or
+   * written.
+   **/
+  static bool build(const std::string & filename,
+                    unsigned long long int key,
+                    RowTransform & transform, const Footprint & footprint,
+                    long int newwidth, long int newheight,
+                    long int oldwidth, long int oldheight,
+                    long int pixelbytes, double inerror) throw();
+
+  /**
+   * open maps a saved plan.  Returns false (and maps nothing) if the
+   * file isn't there or wasn't made for the same key and dimensions.
+   **/
+  bool open(const std::string & filename, unsigned long long int key,
+            long int newwidth, long int newheight,
+            long int oldwidth, long int oldheight) throw();
+
+  /**
+   * close unmaps the plan.
+   **/
+  void close() throw();
+
+  /**
+   * projectRowIndices fills xidx and yidx with the input pixels of
+   * count output pixels starting at startx on output row ycounter.
+   * Pixels off the input (or outside what the plan was built for) get
+   * -1.
+   **/
+  void projectRowIndices(long int ycounter, long int startx,
+                         long int count, long int * xidx,
+                         long int * yidx) const throw();
+
+  /**
+   * getRunCount returns the number of runs in the plan.
+   **/
+  long int getRunCount() const throw();
+
+  /**
+   * getError returns the error of the transform the plan was built
+   * from in input pixels.
+   **/
+  double getError() const throw();
+
+ protected:
+  //addRuns compiles the pixels of one row into runs
+  static void addRuns(const long int * xidx, const long int * yidx,
+                      long int startx, long int count,
+                      std::vector<WarpRun> & runs) throw(std::bad_alloc);
+
+  void * map;                            //the mapped file
+  long int mapsize;                      //bytes mapped
+  long int height;                       //output rows
+  double error;                          //error of the mapping
+  const long long int * rowstart;        //first run of each row
+  const WarpRun * runs;                  //the runs
+};
+
+#endif
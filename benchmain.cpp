@@ -0,0 +1,83 @@
+#ifdef _WIN32
+#define __GNU_LIBRARY__
+#endif
+
+#ifdef _WIN32
+#pragma warning( disable : 4291 ) // Disable VC warning messages for
+                                  // new(nothrow)
+#endif
+
+
+#include <iostream>
+#include <cstdlib>
+#include "PmeshBench.h"
+#include "ProjUtil.h"
+using namespace ProjLib;
+
+
+//Times the exact projection against the pmesh settings for one job.
+//bench <parameter file> <input file> [row step] [output scale]
+int main(int argc, char *argv[])
+{
+  PmeshBench bench;              //the benchmark
+  Projection * outproj = NULL;   //output projection
+  std::string infile;            //input file
+  MathLib::Point newscale;       //output scale
+
+  try
+  {
+    if (argc < 3)
+    {
+      std::cout << "Usage: " << argv[0] << " <parameter file> <input file>"
+                << " [row step] [output scale]" << std::endl;
+      return 0;
+    }
+
+    //generate the output projection based on the flat file
+    outproj = SetProjection(argv[1]);
+    if (!outproj)
+    {
+      std::cout << "Could not create the output projection!" << std::endl;
+      return 0;
+    }
+
+    bench.setOutputProjection(outproj);
+    delete outproj;
+    outproj = NULL;
+
+    if (argc > 3)
+      bench.setRowStep(std::atol(argv[3]));
+
+    if (argc > 4)
+    {
+      newscale.x = newscale.y = std::atof(argv[4]);
+      bench.setOutputScale(newscale);
+    }
+    else
+      bench.setSameScale(true);
+
+    infile = argv[2];
+    bench.setInputFile(infile);
+    bench.run(std::cout);
+  }
+  catch(ProjectorException & pe)
+  {
+    std::cout << pe.getExceptionMessage() << std::endl;
+    delete outproj;
+  }
+  catch(USGSImageLib::ImageException & ie)
+  {
+    std::string error;
+
+    ie.getString(error);
+    std::cout << error << std::endl;
+    delete outproj;
+  }
+  catch(...)
+  {
+    std::cout << "You are the weakest link. Good-bye." << std::endl;
+    delete outproj;
+  }
+
+  return 0;  //done
+}
@@ -27,12 +27,19 @@ inputparm::inputparm()
   timefile = false;
   pmeshname = 0;
   pmeshsize = 4;
+  maxerror = 0.0;
   newscale.x = 0;
   newscale.y = 0;  
   chunksize = 0;  
   storelocal = false;      
   stitcher = false; 
   numPartitions = 0;
+  numthreads = 0;
+  tilesize = 0;
+  fixedpoint = false;
+  cachesize = 100;
+  cachepolicy = 0;
+  shiftdatums = false;
 }//constructor
 
 inputparm::~inputparm()
@@ -68,6 +75,18 @@ void inputparm::getinput()
     numofslaves = std::atoi(inbuf.c_str());
   }
 
+  if (!numofslaves)
+  {
+    std::cout << "Enter the number of threads to use (0 for one per"
+              << " processor, default 0)" << std::endl;
+    std::getline(std::cin, inbuf);
+
+    if (!inbuf.size())
+      numthreads = 0;
+    else
+      numthreads = std::atoi(inbuf.c_str());
+  }
+
   std::cout << "Please enter the chunksize (1 for default)." << std::endl;
   std::getline(std::cin, inbuf);
 
@@ -80,6 +99,42 @@ void inputparm::getinput()
     chunksize = std::atoi(inbuf.c_str());;
   }
 
+  std::cout << "Enter the output tile size in pixels (0 for scanlines,"
+            << " default 0)" << std::endl;
+  std::getline(std::cin, inbuf);
+
+  if (!inbuf.size())
+    tilesize = 0;
+  else
+    tilesize = std::atoi(inbuf.c_str());
+
+  std::cout << "Enter the input cache size in megabytes (default 100)"
+            << std::endl;
+  std::getline(std::cin, inbuf);
+
+  if (!inbuf.size())
+    cachesize = 100;
+  else
+    cachesize = std::atoi(inbuf.c_str());
+
+  std::cout << "Choose the input cache replacement: 0=Least recently used"
+            << " (Default), 1=Farthest from the chunk, 2=Shared by the"
+            << " slaves on a node." << std::endl;
+  std::getline(std::cin, inbuf);
+  cachepolicy = inbuf.size() ? std::atoi(inbuf.c_str()) : 0;
+  if ((cachepolicy < 0) || (cachepolicy > 2))
+    cachepolicy = 0;
+
+  std::cout << "Enter the directory to keep warp plans in (default none)"
+            << std::endl;
+  std::getline(std::cin, inbuf);
+  plandir = inbuf;
+
+  std::cout << "Do you want to shift between datums (NAD27, NAD83, WGS 72"
+            << " and WGS 84)? {y/n} (default n)" << std::endl;
+  std::getline(std::cin, inbuf);
+  shiftdatums = (inbuf.size() && !MiscUtils::cmp_nocase(inbuf, "Y"));
+
   std::cout << "Do you want to have the slaves store data locally? (Y/N)"
             << " (default N)" << std::endl;
   std::getline(std::cin, inbuf);
@@ -187,8 +242,8 @@ void inputparm::getinput()
   }
   
   std::cout << "Choose one of the following for the Pmesh name:" << std::endl;
-  std::cout << "0=None(Default),1=LeastSqrs, 2=Bilinear, 3=bicubic." 
-            << std::endl;
+  std::cout << "0=None(Default),1=LeastSqrs, 2=Bilinear, 3=bicubic,"
+            << " 4=Adaptive." << std::endl;
   std::getline(std::cin, inbuf);
   if(inbuf.size())
   {
@@ -200,11 +255,31 @@ void inputparm::getinput()
       pmeshname = 8;
     if (!MiscUtils::cmp_nocase(inbuf, "3"))
       pmeshname = 10;
+    if (!MiscUtils::cmp_nocase(inbuf, "4"))
+      pmeshname = 20;
   }
   else
     pmeshname = 0;
 
-  if (pmeshname > 0)
+  if (pmeshname == 20)
+  {
+    //the adaptive mesh sizes itself to the error
+    pmeshsize = 4;
+
+    std::cout << "Enter the maximum pmesh error in input pixels."
+              << " (default 0.125)" << std::endl;
+    std::getline(std::cin, inbuf);
+    if (inbuf.size())
+      maxerror = std::atof(inbuf.c_str());
+    else
+      maxerror = 0.0;
+
+    std::cout << "Do you want to use fixed point stepping? {y/n}"
+              << " (default n)" << std::endl;
+    std::getline(std::cin, inbuf);
+    fixedpoint = (inbuf.size() && !MiscUtils::cmp_nocase(inbuf, "Y"));
+  }
+  else if (pmeshname > 0)
   {
     std::cout << "Enter the Pmesh Size." << std::endl;
     std::cin >> pmsh_ans;
@@ -219,8 +294,18 @@ void inputparm::getinput()
     }
   }
   else
+  {
     pmeshsize = 4;
 
+    std::cout << "Enter the maximum approximation error in input pixels."
+              << " (0 for exact, default 0)" << std::endl;
+    std::getline(std::cin, inbuf);
+    if (inbuf.size())
+      maxerror = std::atof(inbuf.c_str());
+    else
+      maxerror = 0.0;
+  }
+
 
   std::cout << "Enter the name of the input file." << std::endl;
   std::cin >> filename;
@@ -281,6 +366,14 @@ bool inputparm::write_parm_file(const std::string& outfilename)
   outfile << storelocal << std::endl;
   outfile << stitcher << std::endl;
   outfile << numPartitions << std::endl;
+  outfile << maxerror << std::endl;
+  outfile << numthreads << std::endl;
+  outfile << tilesize << std::endl;
+  outfile << fixedpoint << std::endl;
+  outfile << (plandir.size() ? plandir : std::string("none")) << std::endl;
+  outfile << cachesize << std::endl;
+  outfile << cachepolicy << std::endl;
+  outfile << shiftdatums << std::endl;
   outfile.close();
 
   return true;
@@ -322,6 +415,17 @@ bool inputparm::read_parm_file(const std::string &infilename)
   infile >> storelocal;
   infile >> stitcher;
   infile >> numPartitions;
+  infile >> maxerror;
+  infile >> numthreads;
+  infile >> tilesize;
+  infile >> fixedpoint;
+  infile >> plandir;
+  if (plandir == "none")
+    plandir = "";
+  infile >> cachesize;
+  infile >> cachepolicy;
+  if (!(infile >> shiftdatums))          //older files don't have it
+    shiftdatums = false;
   infile.close();
   
   return true;
@@ -28,6 +28,9 @@ public:
   bool timefile;
   MathLib::Point newscale;
   int pmeshsize, pmeshname;
+  double maxerror;                //approximation error in input pixels
+                                  //when no pmesh or the adaptive pmesh
+                                  //is used (default 0)
   std::string logname, filename, parameterfile, outfile_name;
   /** These were added for the updated options in the new projector program
       CBB 5/8/2001 **/ 
@@ -37,6 +40,20 @@ public:
   bool stitcher;                  //whether or not to use the stitcher on
                                   //as the master (default no)
   int numPartitions;              //the pvfs partitions
+  int numthreads;                 //threads to use with no slaves
+                                  //(default 0, one per processor)
+  int tilesize;                   //output tile size in pixels
+                                  //(default 0, scanlines)
+  bool fixedpoint;                //fixed point stepping with the adaptive
+                                  //pmesh (default no)
+  std::string plandir;            //directory for warp plans
+                                  //(default none)
+  int cachesize;                  //input cache size in mb (default 100)
+  int cachepolicy;                //input cache replacement, 0 least
+                                  //recently used, 1 farthest from the
+                                  //chunk, 2 shared by the slaves on a
+                                  //node (default 0)
+  bool shiftdatums;               //shift between datums (default no)
 
 protected:
 
@@ -81,6 +81,11 @@ int main(int argc, char *argv[])
     projector->setOutputProjection(outproj);
     projector->setPmeshName(inparms.pmeshname);
     projector->setPmeshSize(inparms.pmeshsize);
+    projector->setMaxError(inparms.maxerror);
+    projector->setTileSize(inparms.tilesize);
+    projector->setFixedPoint(inparms.fixedpoint);
+    projector->setWarpPlanDir(inparms.plandir);
+    projector->setShiftDatums(inparms.shiftdatums);
     if (inparms.chunksize > 0)
       projector->setChunkSize(inparms.chunksize);
     else
@@ -95,14 +100,30 @@ int main(int argc, char *argv[])
     else
       projector->setSameScale(true);
     
+    projector->setCacheSize(inparms.cachesize);
+    projector->setCachePolicy(inparms.cachepolicy);
     projector->setInputFile(inparms.filename);
     projector->setNumberOfSlaves(inparms.numofslaves);
+    projector->setNumberOfThreads(inparms.numthreads);
 
     if(inparms.numofslaves > 0)
       MPI_Init(&argc, &argv);           //start MPI
 
     projector->project(&progress);
 
+    //tell how the adaptive pmesh came out
+    if (projector->getMeshNodeCount())
+      std::cout << "Adaptive pmesh projected "
+                << projector->getMeshNodeCount() << " points, max error "
+                << projector->getMeshMaxError() << " pixels." << std::endl;
+
+    //and how the input cache did
+    if (projector->getCacheStats().hits + projector->getCacheStats().misses)
+      std::cout << "Input cache: " << projector->getCacheStats().hits
+                << " hits, " << projector->getCacheStats().misses
+                << " misses, " << projector->getCacheStats().evictions
+                << " evictions." << std::endl;
+
     //see if we need to write the time file
     if (inparms.timefile)
     {